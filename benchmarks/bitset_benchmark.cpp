@@ -0,0 +1,93 @@
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "custom_bitset.h"
+#include "custom_graph.h"
+#include "hierarchical_bitset.h"
+#include "parsing.h"
+
+// flat vs hierarchical on the sparse sets used by the solver:
+// few vertices (colour classes, is_processed diffs) spread over a G.size() wide set
+
+namespace {
+    constexpr std::size_t n_sets = 256;
+    constexpr std::size_t set_size = 8;
+
+    std::vector<custom_bitset> random_sparse_sets(const custom_graph& G, std::mt19937& rng) {
+        std::uniform_int_distribution<std::size_t> vertex(0, G.size()-1);
+        std::vector<custom_bitset> sets(n_sets, custom_bitset(G.size()));
+
+        for (auto& set : sets)
+            for (std::size_t i = 0; i < set_size; ++i) set.set(vertex(rng));
+
+        return sets;
+    }
+}
+
+TEMPLATE_TEST_CASE("sparse set scans", "[benchmark][bitset]", custom_bitset, hierarchical_bitset) {
+    const std::string filename = GENERATE("C250.9.clq", "wiki-Vote.mtx");
+    const auto G = parse_graph(std::string(CLISAT_EXAMPLES_DIR) + "/" + filename);
+
+    std::mt19937 rng(42);
+    const auto flat_sets = random_sparse_sets(G, rng);
+    const auto masks = random_sparse_sets(G, rng);
+
+    std::vector<TestType> sets;
+    for (const auto& set : flat_sets) sets.emplace_back(set);
+
+    // is_processed is almost full, nodes = ISs[i] \ is_processed is almost empty
+    custom_bitset is_processed(G.size());
+    for (std::size_t v = 0; v < G.size(); ++v)
+        if (v % 16) is_processed.set(v);
+    TestType nodes(G.size());
+
+    BENCHMARK("front/next " + filename) {
+        std::size_t sum = 0;
+        for (const auto& set : sets)
+            for (auto v = set.front(); v != custom_bitset::npos; v = set.next(v)) sum += v;
+        return sum;
+    };
+
+    BENCHMARK("for_each_set_bit " + filename) {
+        std::size_t sum = 0;
+        for (const auto& set : sets) set.for_each_set_bit([&](const std::size_t v) { sum += v; });
+        return sum;
+    };
+
+    std::vector<int> buffer(G.size());
+    BENCHMARK("extract " + filename) {
+        std::size_t sum = 0;
+        for (const auto& set : sets) {
+            const auto n = set.extract(std::span(buffer));
+            for (std::size_t i = 0; i < n; ++i) sum += buffer[i];
+        }
+        return sum;
+    };
+
+    BENCHMARK("back/prev " + filename) {
+        std::size_t sum = 0;
+        for (const auto& set : sets)
+            for (auto v = set.back(); v != custom_bitset::npos; v = set.prev(v)) sum += v;
+        return sum;
+    };
+
+    BENCHMARK("front_difference " + filename) {
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i < n_sets; ++i) sum += sets[i].front_difference(masks[i]);
+        return sum;
+    };
+
+    BENCHMARK("DIFF + scan " + filename) {
+        std::size_t sum = 0;
+        for (const auto& set : flat_sets) {
+            TestType::DIFF(nodes, set, is_processed);
+            for (const auto v : nodes) sum += v;
+        }
+        return sum;
+    };
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "instructions.h"
+
+// throughput of every kernel_table entry, scalar table vs the one selected for this cpu.
+// inputs come from a fixed seed mt19937_64 (same sequence on every platform) and every kernel
+// prints a checksum of its output: a cross build run under qemu-user must print the same
+// checksums of the x86 build. the program fails if a selected kernel disagrees with the scalar one.
+//
+// usage: kernel_benchmark [blocks]
+
+namespace {
+    typedef std::vector<std::uint64_t> blocks;
+
+    struct inputs {
+        blocks src1, src2, sparse;
+        std::size_t n;
+    };
+
+    // run returns the scalar result of the kernel (0 for the stores), the outputs are read
+    // back only for the checksum, so they don't slow down the timed loop
+    struct kernel_case {
+        const char* name;
+        std::size_t bytes;      // bytes touched by one call
+        std::function<std::uint64_t(const instructions::kernel_table&, const inputs&, blocks&, std::vector<std::uint32_t>&)> run;
+    };
+
+    // fnv-1a over the values
+    template <typename T>
+    std::uint64_t checksum(std::uint64_t hash, const std::vector<T>& data) {
+        for (const auto value : data) hash = (hash ^ value) * 0x100000001b3;
+        return hash;
+    }
+
+    std::uint64_t checksum(const kernel_case& kernel, const instructions::kernel_table& table, const inputs& in, blocks& dest, std::vector<std::uint32_t>& positions) {
+        std::ranges::fill(dest, 0);
+        std::ranges::fill(positions, 0);
+
+        const auto result = kernel.run(table, in, dest, positions);
+        return checksum(checksum(0xcbf29ce484222325 ^ result, dest), positions);
+    }
+
+    kernel_case store(const char* name, instructions::store_kernel instructions::kernel_table::* kernel, const std::size_t n) {
+        return {name, 3*n*sizeof(std::uint64_t), [kernel](const auto& table, const auto& in, auto& dest, auto&) -> std::uint64_t {
+            (table.*kernel)(dest.data(), in.src1.data(), in.src2.data(), in.n);
+            return 0;
+        }};
+    }
+
+    // dest is reloaded every call, otherwise xor would flip back and forth
+    kernel_case inplace(const char* name, instructions::inplace_kernel instructions::kernel_table::* kernel, const std::size_t n) {
+        return {name, 4*n*sizeof(std::uint64_t), [kernel](const auto& table, const auto& in, auto& dest, auto&) -> std::uint64_t {
+            std::ranges::copy(in.src1, dest.begin());
+            (table.*kernel)(dest.data(), in.src2.data(), in.n);
+            return 0;
+        }};
+    }
+
+    std::vector<kernel_case> kernel_cases(const std::size_t n) {
+        using table = instructions::kernel_table;
+        constexpr auto block_bytes = sizeof(std::uint64_t);
+
+        return {
+            store("and_store", &table::and_store, n),
+            store("or_store", &table::or_store, n),
+            store("xor_store", &table::xor_store, n),
+            store("nand_store", &table::nand_store, n),
+            store("nor_store", &table::nor_store, n),
+            store("nxor_store", &table::nxor_store, n),
+            store("diff_store", &table::diff_store, n),
+            inplace("and_inplace", &table::and_inplace, n),
+            inplace("or_inplace", &table::or_inplace, n),
+            inplace("diff_inplace", &table::diff_inplace, n),
+            inplace("nor_inplace", &table::nor_inplace, n),
+            {"popcount", n*block_bytes, [](const auto& t, const auto& in, auto&, auto&) -> std::uint64_t {
+                return t.popcount(in.src1.data(), in.n);
+            }},
+            {"and_count_store", 3*n*block_bytes, [](const auto& t, const auto& in, auto& dest, auto&) -> std::uint64_t {
+                return t.and_count_store(dest.data(), in.src1.data(), in.src2.data(), in.n);
+            }},
+            {"diff_count_store", 3*n*block_bytes, [](const auto& t, const auto& in, auto& dest, auto&) -> std::uint64_t {
+                return t.diff_count_store(dest.data(), in.src1.data(), in.src2.data(), in.n);
+            }},
+            {"and_count", 2*n*block_bytes, [](const auto& t, const auto& in, auto&, auto&) -> std::uint64_t {
+                return t.and_count(in.src1.data(), in.src2.data(), in.n);
+            }},
+            // the sparse set has a single nonzero block in the middle, the scans cross half of it
+            {"find_first", n/2*block_bytes, [](const auto& t, const auto& in, auto&, auto&) -> std::uint64_t {
+                return t.find_first(in.sparse.data(), in.n);
+            }},
+            {"find_last", n/2*block_bytes, [](const auto& t, const auto& in, auto&, auto&) -> std::uint64_t {
+                return t.find_last(in.sparse.data(), in.n);
+            }},
+            {"extract", n*block_bytes, [](const auto& t, const auto& in, auto&, auto& positions) -> std::uint64_t {
+                return t.extract(in.src2.data(), in.n, 0, positions.data());
+            }},
+        };
+    }
+
+    // keeps the results alive, the optimizer can't drop the calls
+    volatile std::uint64_t sink;
+
+    // calls run until at least 50ms have passed, returns GB/s
+    double throughput(const kernel_case& kernel, const instructions::kernel_table& table, const inputs& in, blocks& dest, std::vector<std::uint32_t>& positions) {
+        using clock = std::chrono::steady_clock;
+
+        std::size_t calls = 0;
+        std::uint64_t results = 0;
+        const auto start = clock::now();
+        auto elapsed = clock::duration::zero();
+        do {
+            for (int i = 0; i < 16; ++i) results += kernel.run(table, in, dest, positions);
+            calls += 16;
+            elapsed = clock::now() - start;
+        } while (elapsed < std::chrono::milliseconds(50));
+
+        sink = results;
+
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        return static_cast<double>(calls * kernel.bytes) / seconds / 1e9;
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    const std::size_t n = argc > 1 ? std::stoul(argv[1]) : 4096;
+
+    std::mt19937_64 rng(42);
+    inputs in{blocks(n), blocks(n), blocks(n), n};
+    for (std::size_t i = 0; i < n; ++i) {
+        in.src1[i] = rng();
+        // a quarter of the bits, like the neighbour sets of a sparse graph
+        in.src2[i] = rng() & rng();
+    }
+    in.sparse[n/2] = rng() | 1;
+
+    blocks dest(n);
+    std::vector<std::uint32_t> positions(n*64);
+
+    const instructions::kernel_table scalar{};
+    const auto& selected = instructions::kernels;
+
+    std::println("{} blocks, selected kernels: {}", n, selected.name);
+    std::println("{:<18} {:>12} {:>12} {:>8}  {}", "kernel", "scalar GB/s", "GB/s", "speedup", "checksum");
+
+    bool mismatch = false;
+    for (const auto& kernel : kernel_cases(n)) {
+        const auto expected = checksum(kernel, scalar, in, dest, positions);
+        const auto result = checksum(kernel, selected, in, dest, positions);
+        if (result != expected) {
+            std::println("{}: {:016x} differs from the scalar kernel {:016x}", kernel.name, result, expected);
+            mismatch = true;
+            continue;
+        }
+
+        const auto base = throughput(kernel, scalar, in, dest, positions);
+        const auto simd = throughput(kernel, selected, in, dest, positions);
+        std::println("{:<18} {:>12.2f} {:>12.2f} {:>7.2f}x  {:016x}", kernel.name, base, simd, simd / base, result);
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CliSAT.h"
+#include "custom_bitset.h"
+#include "custom_graph.h"
+#include "parsing.h"
+#include "sorting.h"
+#include "thread_pool.h"
+
+// wall time of the branch and bound on the same problem with 1, 2, 4, ... threads up to hardware_concurrency.
+// the graph is sorted with DEG_SORT and only its first vertices are roots (the maximum clique of the subgraph
+// they induce), so the single thread run takes seconds rather than the minutes of the whole C250.9.
+// every run must find a clique of the same size, the program fails otherwise.
+// the heap allocations (operator new) of every run are counted too, the search should make almost none, along with
+// the scratch resources the pool built and the most kept in the cache of a single worker.
+//
+// usage: scaling_benchmark [roots] [graph]
+
+namespace {
+    std::atomic_uint64_t allocations = 0;
+
+    struct run {
+        std::size_t clique;
+        double seconds;
+        std::uint64_t allocations;
+        std::size_t resources;
+        std::size_t cached;
+    };
+
+    run solve(const custom_graph& G, const custom_bitset& roots, const std::size_t threads) {
+        thread_pool_CliSAT<Solver> pool(G.size(), threads);
+
+        const auto before = allocations.load();
+        const auto start = std::chrono::steady_clock::now();
+        const auto clique = CliSAT_no_sorting(G, pool, roots, std::chrono::hours(24));
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        const auto cached = pool.cached_resources();
+        return {
+            clique.size(), std::chrono::duration<double>(elapsed).count(), allocations.load() - before,
+            pool.resources_created(), std::ranges::max(cached)
+        };
+    }
+}
+
+void* operator new(const std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(const int argc, char* argv[]) {
+    const std::size_t roots_count = argc > 1 ? std::stoul(argv[1]) : 190;
+    const std::string filename = argc > 2 ? argv[2] : std::string(CLISAT_EXAMPLES_DIR) + "/C250.9.clq";
+
+    auto G = parse_graph(filename);
+    G.change_order(deg_sort(G));
+
+    custom_bitset roots(G.size());
+    for (std::size_t v = 0; v < std::min(roots_count, G.size()); ++v) roots.set(v);
+
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t threads = 1; threads < cores; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(cores);
+
+    std::println("{}: first {} of {} vertices, {} cores", filename, roots.count(), G.size(), cores);
+    std::println("{:>8} {:>12} {:>8} {:>11} {:>14} {:>10} {:>7}  {}", "threads", "seconds", "speedup", "efficiency", "allocations/s", "resources", "cached", "clique");
+
+    double base = 0;
+    std::size_t expected = 0;
+    for (const auto threads : thread_counts) {
+        const auto [clique, seconds, allocated, resources, cached] = solve(G, roots, threads);
+        if (threads == 1) {
+            base = seconds;
+            expected = clique;
+        }
+        if (clique != expected) {
+            std::println("{} threads: clique of {} vertices, {} with 1 thread", threads, clique, expected);
+            return 1;
+        }
+
+        const auto speedup = base / seconds;
+        std::println("{:>8} {:>12.3f} {:>7.2f}x {:>10.1f}% {:>14.0f} {:>10} {:>7}  {}", threads, seconds, speedup, 100 * speedup / threads, allocated / seconds, resources, cached, clique);
+    }
+
+    return 0;
+}
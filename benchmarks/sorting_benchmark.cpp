@@ -0,0 +1,25 @@
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "CliSAT.h"
+#include "custom_graph.h"
+#include "parsing.h"
+#include "sorting.h"
+#include "reference_sorting.h"
+
+// bucket queue vs quadratic scan for the initial orderings, same outputs (see tests/test_sorting.cpp)
+TEST_CASE("initial sorting", "[benchmark][sorting]") {
+    const std::string filename = GENERATE("C250.9.clq", "wiki-Vote.mtx");
+    const auto G = parse_graph(std::string(CLISAT_EXAMPLES_DIR) + "/" + filename);
+
+    BENCHMARK("get_degeneracy quadratic " + filename) { return reference::get_degeneracy(G); };
+    BENCHMARK("get_degeneracy bucket queue " + filename) { return G.get_degeneracy(); };
+
+    BENCHMARK("MWSI quadratic " + filename) { return reference::MWSI(G, 5); };
+    BENCHMARK("MWSI bucket queue " + filename) { return MWSI(G, 5); };
+
+    BENCHMARK("MWSSI quadratic " + filename) { return reference::MWSSI(G, 5); };
+    BENCHMARK("MWSSI bucket queue " + filename) { return MWSSI(G, 5); };
+}
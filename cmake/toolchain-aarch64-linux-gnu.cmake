@@ -24,6 +24,8 @@ set(CMAKE_ASM_COMPILER aarch64-linux-gnu-as)
 # Set compiler flags (tune for your target if known)
 set(CMAKE_C_FLAGS_INIT "-O2 -pipe")
 set(CMAKE_CXX_FLAGS_INIT "-O2 -pipe")
+# SVE kernels (Graviton3 and newer), NEON ones are always available:
+# set(CMAKE_CXX_FLAGS_INIT "-O2 -pipe -march=armv8.2-a+sve")
 
 # Use static linking or dynamic depending on your target
 # set(CMAKE_EXE_LINKER_FLAGS "-static")
@@ -4,21 +4,58 @@
 
 #pragma once
 
+#include <bit>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <span>
 
 #include "coloring.h"
+#include "csr_graph.h"
 #include "custom_bitset.h"
 #include "custom_graph.h"
 #include "fixed_vector.h"
+#include "hierarchical_bitset.h"
+#include "huge_pages.h"
 #include "solution.h"
+#include "static_solver.h"
 #include "threadsafe_vector.h"
 #include "thread_pool.h"
 
 inline constexpr int NONE = -1;
 
+// set type of the solver scratch sets (is_processed, nodes, nodes2, nodes3).
+// they usually hold few vertices, hierarchical_bitset skips their zero blocks when iterating
+#ifdef CLISAT_HIERARCHICAL_BITSET
+using solver_set = hierarchical_bitset;
+#else
+using solver_set = custom_bitset;
+#endif
+
+// candidate sets up to static_solver_max_size vertices are re-indexed and searched with static_bitset<64/128/256/512>,
+// as long as the clique to find has at most 1/static_solver_min_ratio of their vertices.
+// bigger cliques are left to the SAT filters, they pay off there
+inline constexpr std::size_t static_solver_max_size = 512;
+inline constexpr std::size_t static_solver_min_ratio = 4;
+
+// subproblems that fit in 1/local_graph_min_ratio of the width of the graph are copied into their own
+// induced subgraph, re-indexed (widths are powers of two, at least 64), and the subtree is solved there:
+// every set operation below it works on |subproblem| bits instead of G.size(). the subtree runs on one thread,
+// so it happens only while every thread of the pool is busy. never for the roots: copying the subgraph of
+// a root that is pruned right away costs more than the root itself
+inline constexpr std::size_t local_graph_min_ratio = 2;
+
+// every time K_max grows the vertices out of its core are dropped (see shrink_to_core), the matrix is
+// rebuilt for them only when they are at least 1/core_shrink_ratio of the vertices left
+inline constexpr std::size_t core_shrink_ratio = 8;
+
+// graphs with more vertices than this never get the whole bit matrix (2 GB at 2^17 vertices):
+// MCP runs on the csr_graph (CliSAT_sparse), only the subgraphs of the roots become bit matrices
+inline constexpr std::size_t dense_max_size = std::size_t{1} << 17;
+
 enum SORTING_METHOD {
     NO_SORT,
     NEW_SORT,
@@ -31,22 +68,14 @@ class Solver {
 public:
     explicit Solver(
         const size_t G_size
-    ) : ISs_mapping(G_size),
-          ISs_size(G_size),
-          ISs_state(G_size, true),
-          ISs_involved(G_size),
-          ISs_used(G_size),
-          ISs_tested(G_size),
+    ) : _workspace(carve_workspace(G_size, nullptr), workspace_alignment),
           is_processed(G_size),
           ISs_new(G_size),
-          is_processed_new(G_size),
-          reason(G_size * 2),
           conflict_iset_stack(G_size),
           // Necessary G.size()*2 because there are also ADDED_NODES
           reduced_iset_stack(G_size * 2),
           passive_iset_stack(G_size),
           fixed_node_stack(G_size * 2),
-          reason_stack(G_size),
           unit_stack(G_size),
           unit_stack2(G_size),
           unit_stack3(G_size),
@@ -54,7 +83,13 @@ public:
           nodes2(G_size),
           nodes3(G_size),
           V_new(G_size),
-          _color_class(G_size) {}
+          _color_class(G_size),
+          _local_tmp(G_size) {
+        std::memset(_workspace.data(), 0, _workspace.size());
+        carve_workspace(G_size, _workspace.data());
+        std::ranges::fill(ISs_state, true);
+    }
+    ~Solver();
 
     void FindMaxClique(
         const custom_graph& G,  // graph
@@ -62,6 +97,7 @@ public:
         solution<int>& K_max,   // max branch
         custom_bitset& P_Bj,       // vertices set
         const custom_bitset& B,          // branching set
+        size_t active_size,         // every vertex of the subtree is < active_size (the root vertex)
         std::vector<int>& u,        // incremental upper bounds
         std::chrono::time_point<std::chrono::steady_clock> max_time,
         thread_pool_CliSAT<Solver>& pool,
@@ -73,30 +109,91 @@ public:
     );
 
 private:
-    std::vector<int> ISs_mapping;
-    std::vector<int> ISs_size;
-    std::vector<std::uint8_t> ISs_state;
-    std::vector<std::uint8_t> ISs_involved;
-    std::vector<std::uint8_t> ISs_used;
-    std::vector<std::uint8_t> ISs_tested;
-    custom_bitset is_processed;
+    static constexpr std::size_t workspace_alignment = 64;
+
+    // the per-vertex arrays live in one buffer (on 2 MB pages with huge_pages enabled)
+    huge_pages::buffer _workspace;
+    std::span<int> ISs_mapping;
+    std::span<int> ISs_size;
+    std::span<std::uint8_t> ISs_state;
+    std::span<std::uint8_t> ISs_involved;
+    std::span<std::uint8_t> ISs_used;
+    std::span<std::uint8_t> ISs_tested;
+    solver_set is_processed;
     std::vector<std::vector<int>> ISs_new;
-    std::vector<std::uint8_t> is_processed_new;
-    std::vector<int> reason;
+    std::span<std::uint8_t> is_processed_new;
+    std::span<int> reason;
     std::vector<std::vector<int>> conflict_iset_stack;
     fixed_vector<int> reduced_iset_stack;
     fixed_vector<int> passive_iset_stack;
     fixed_vector<int> fixed_node_stack;
-    fixed_vector<int> reason_stack;
+    // every identify_conflict_isets call pushes its closure, the same iset can be there many times: no G.size() bound
+    std::vector<int> reason_stack;
     fixed_vector<int> unit_stack;
     fixed_vector<int> unit_stack2;
     fixed_vector<int> unit_stack3;
-    custom_bitset nodes;
-    custom_bitset nodes2;
-    custom_bitset nodes3;
+    solver_set nodes;
+    solver_set nodes2;
+    solver_set nodes3;
     custom_bitset V_new;
     std::vector<int> _color_class;
     std::vector<custom_bitset> _ISs;
+    static_solver<64> _static_solver64;
+    static_solver<128> _static_solver128;
+    static_solver<256> _static_solver256;
+    static_solver<512> _static_solver512;
+    std::span<int> _local_index;
+    custom_bitset _local_tmp;
+    // active prefix of the current SATCOL/FiltSAT call, is_processed is meaningful only below it
+    size_t _active_size = 0;
+
+    // re-indexed subproblems, one for every width (by log2) this solver needed
+    struct local_subproblem;
+    std::vector<std::unique_ptr<local_subproblem>> _local_subproblems;
+
+    // lays the per-vertex arrays out in _workspace, with workspace == nullptr it only returns the bytes needed
+    std::size_t carve_workspace(std::size_t G_size, std::byte* workspace);
+
+    // looks for a clique of size vertices in V_new, if found K+bi+clique replaces K_max
+    bool find_static_clique(
+        const custom_graph& G,
+        fixed_vector<int>& K,
+        solution<int>& K_max,
+        size_t V_new_size,
+        int bi,
+        int size,
+        std::chrono::time_point<std::chrono::steady_clock> max_time,
+        const thread_pool_CliSAT<Solver>& pool
+    );
+
+    // solves the subtree of P_Bj+B on the subgraph they induce (see local_graph_min_ratio),
+    // false if it's not narrow enough or some thread of the pool is idle
+    bool find_local_clique(
+        const custom_graph& G,
+        fixed_vector<int>& K,
+        solution<int>& K_max,
+        const custom_bitset& P_Bj,
+        const custom_bitset& B,
+        const std::vector<int>& u,
+        std::chrono::time_point<std::chrono::steady_clock> max_time,
+        thread_pool_CliSAT<Solver>& pool,
+        const fixed_vector<int>& alpha,
+        bool is_k_partite,
+        const std::vector<custom_bitset>& ISs,
+        const std::vector<int>& color_class
+    );
+
+    template <std::size_t N>
+    bool find_static_clique(
+        static_solver<N>& solver,
+        const custom_graph& G,
+        fixed_vector<int>& K,
+        solution<int>& K_max,
+        int bi,
+        int size,
+        std::chrono::time_point<std::chrono::steady_clock> max_time,
+        const thread_pool_CliSAT<Solver>& pool
+    );
 
     void identify_conflict_isets(
         int iset,
@@ -208,7 +305,8 @@ private:
         custom_bitset& B,
         std::vector<custom_bitset>& ISs,
         std::vector<int>& color_class,
-        int k
+        int k,
+        size_t active_size
     );
 
     int FiltCOL(
@@ -235,10 +333,32 @@ private:
         custom_bitset& V,       // vertices set
         std::vector<custom_bitset>& ISs,
         const std::vector<int>& color_class,
-        int k_max
+        int k_max,
+        size_t active_size
     );
 };
 
+inline std::size_t Solver::carve_workspace(const std::size_t G_size, std::byte* workspace) {
+    std::size_t offset = 0;
+    auto take = [&]<typename T>(std::span<T>& array, const std::size_t n) {
+        offset = (offset + workspace_alignment-1) / workspace_alignment * workspace_alignment;
+        if (workspace) array = {reinterpret_cast<T*>(workspace + offset), n};
+        offset += n*sizeof(T);
+    };
+
+    take(ISs_mapping, G_size);
+    take(ISs_size, G_size);
+    take(reason, G_size * 2);
+    take(_local_index, G_size);
+    take(ISs_state, G_size);
+    take(ISs_involved, G_size);
+    take(ISs_used, G_size);
+    take(ISs_tested, G_size);
+    take(is_processed_new, G_size);
+
+    return offset;
+}
+
 static std::atomic_uint64_t steps = 0;
 static std::atomic_uint64_t pruned = 0;
 
@@ -253,14 +373,14 @@ inline void Solver::identify_conflict_isets(
         const auto reason_iset = reason_stack[i];
 
         // removed_nodes
-        custom_bitset::AND(nodes3, ISs[reason_iset], is_processed);
-        for (auto r : nodes3) {
+        solver_set::AND(nodes3, ISs[reason_iset], is_processed);
+        nodes3.for_each_set_bit([&](const auto r) {
             const auto r_iset = reason[r];
-            if (r_iset == NONE || ISs_involved[r_iset]) continue;
+            if (r_iset == NONE || ISs_involved[r_iset]) return;
 
             ISs_involved[r_iset] = true;
             reason_stack.push_back(r_iset);
-        }
+        });
         for (auto r : ISs_new[reason_iset]) {
             // not processed (removed)
             if (!is_processed_new[r-is_processed.size()] || reason[r] == NONE) continue;
@@ -326,13 +446,15 @@ inline int Solver::fix_oldNode_for_iset(
 
     //custom_bitset::DIFF(anti_neighbors, G.get_complement_neighbor_set(fix_node), is_processed);
     // equivalent to the above -> ~a & ~b == ~(a|b) (de morgan)
-    custom_bitset::NOR(nodes3, G.get_neighbor_set(fix_node), is_processed);
+    solver_set::NOR(nodes3, G.get_neighbor_set(fix_node), is_processed, _active_size);
     //is_processed |= anti_neighbors;
 
-    for (auto r : nodes3) {
+    // nodes3 is a snapshot, only is_processed changes inside the scan
+    int empty_iset = NONE;
+    nodes3.for_each_set_bit([&](const auto r) {
         const auto iset = color_class[r];
 
-        if (!ISs_state[iset]) continue;
+        if (!ISs_state[iset]) return true;
 
         ISs_size[iset]--;
         reduced_iset_stack.push_back(iset);
@@ -341,14 +463,18 @@ inline int Solver::fix_oldNode_for_iset(
         reason[r] = fix_iset;
 
         // conflict found
-        if (ISs_size[iset] == 0) return iset;
+        if (ISs_size[iset] == 0) {
+            empty_iset = iset;
+            return false;
+        }
 
         if (ISs_size[iset] == 1) {
             new_unit_stack.push_back(iset);
         }
-    }
+        return true;
+    });
 
-    return NONE;
+    return empty_iset;
 }
 
 inline int Solver::get_node_of_unit_iset(
@@ -536,7 +662,7 @@ inline int Solver::simple_further_test_node(
         if (!ISs_state[chosen_iset] || ISs_tested[chosen_iset] || ISs_size[chosen_iset] != 2) continue;
 
         ISs_tested[chosen_iset] = true;
-        custom_bitset::DIFF(nodes, ISs[chosen_iset], is_processed);
+        solver_set::DIFF(nodes, ISs[chosen_iset], is_processed);
         for (auto node : nodes) {
             unit_stack2.clear();
 
@@ -619,7 +745,7 @@ inline bool Solver::test_by_eliminate_failed_nodes(
         for (auto my_iset = k; my_iset >= 0; my_iset--) {
             if (!ISs_state[my_iset]) continue;
             unit_stack.clear();
-            custom_bitset::DIFF(nodes2, ISs[my_iset], is_processed);
+            solver_set::DIFF(nodes2, ISs[my_iset], is_processed);
 
             for (auto node : nodes2) {
                 if (test_node_for_failed_nodes(node, my_iset, G, ISs, color_class) == NONE) continue;
@@ -681,7 +807,7 @@ inline int Solver::further_test_reduced_iset(
         }
         if (has_new_node) continue;
 
-        custom_bitset::DIFF(nodes2, ISs[chosen_iset], is_processed);
+        solver_set::DIFF(nodes2, ISs[chosen_iset], is_processed);
         std::size_t node = custom_bitset::npos;
         for (node = nodes2.front(); node != custom_bitset::npos; node = nodes2.next(node)) {
             unit_stack3.clear();
@@ -723,7 +849,7 @@ inline int Solver::inc_maxsatz_lookahead_by_fl2(
 
         reason_stack.resize(rs);
         ISs_tested[iset_idx] = true;
-        custom_bitset::DIFF(nodes, ISs[iset_idx], is_processed);
+        solver_set::DIFF(nodes, ISs[iset_idx], is_processed);
         bool exit = false;
         for (auto node : nodes) {
             unit_stack2.clear();
@@ -795,7 +921,9 @@ inline bool Solver::inc_maxsatz_on_last_iset(
     passive_iset_stack.clear();
     fixed_node_stack.clear();
 
-    for (const auto bi : ISs[k]) {
+    // ISs is const here, only B loses the vertices that lead to a conflict
+    bool all_conflicts = true;
+    ISs[k].for_each_set_bit([&](const auto bi) {
         unit_stack2.clear();
 
         // fix old node
@@ -810,18 +938,21 @@ inline bool Solver::inc_maxsatz_on_last_iset(
             identify_conflict_isets(empty_iset, ISs);
             reset_context_for_maxsatz();
             B.reset(bi);
-            continue;
+            return true;
         }
 
         // conflict not found
         if (inc_maxsatz_lookahead_by_fl2(G, ISs, color_class)) {
             reset_context_for_maxsatz();
             B.reset(bi);
-        } else {
-            reset_context_for_maxsatz();
-            return false;
+            return true;
         }
-    }
+
+        reset_context_for_maxsatz();
+        all_conflicts = false;
+        return false;
+    });
+    if (!all_conflicts) return false;
 
     enlarge_conflict_sets(ADDED_NODE, G);
 
@@ -833,12 +964,15 @@ inline bool Solver::SATCOL(
     custom_bitset& B,
     std::vector<custom_bitset>& ISs,
     std::vector<int>& color_class,
-    int k
+    int k,
+    const size_t active_size
 ) {
     unit_stack.clear();
 
-    // is_processed = true for nodes not considered
-    is_processed.set();
+    // is_processed = true for nodes not considered, the ones after the prefix are never read
+    _active_size = active_size;
+    is_processed.reset();
+    is_processed.set_before(active_size);
 
     for (int i = 0; i < k; i++) {
         // is_processed = true for nodes not considered
@@ -858,19 +992,16 @@ inline bool Solver::SATCOL(
     }
 
     do {
-        ISEQ_one(G, B, ISs[k]);
+        ISs_size[k] = ISEQ_one(G, B, ISs[k]);
         ISs_involved[k] = false;
         ISs_used[k] = false;
         ISs_state[k] = true;
         ISs_new[k].clear();
-        ISs_size[k] = ISs[k].count();
         if (ISs_size[k] == 1) {
             unit_stack.push_back(k);
         }
         is_processed -= ISs[k];
-        for (auto v : ISs[k]) {
-            color_class[v] = k;
-        }
+        ISs[k].for_each_set_bit([&](const auto v) { color_class[v] = k; });
 
         for (int i = 0; i <= k; i++) {
             assert(ISs_used[i] == false);
@@ -971,9 +1102,12 @@ inline bool Solver::FiltSAT(
     custom_bitset& V, // vertices set
     std::vector<custom_bitset>& ISs,
     const std::vector<int>& color_class,
-    const int k_max
+    const int k_max,
+    const size_t active_size
 ) {
-    is_processed.set();
+    _active_size = active_size;
+    is_processed.reset();
+    is_processed.set_before(active_size);
     for (int i = 0; i < k_max; i++) {
         is_processed -= ISs[i];
         ISs_state[i] = true;
@@ -993,6 +1127,7 @@ inline void Solver::FindMaxClique(
     solution<int>& K_max,   // max branch
     custom_bitset& P_Bj, // vertices set
     const custom_bitset& B,       // branching set
+    const size_t active_size,
     std::vector<int>& u, // incremental upper bounds,
     const std::chrono::time_point<std::chrono::steady_clock> max_time,
     thread_pool_CliSAT<Solver>& pool,
@@ -1002,6 +1137,8 @@ inline void Solver::FindMaxClique(
     const std::vector<custom_bitset>& ISs,
     const std::vector<int>& color_class
 ) {
+    if (find_local_clique(G, K, K_max, P_Bj, B, u, max_time, pool, alpha, is_k_partite, ISs, color_class)) return;
+
     steps++;
 
     // |K|+1 because we are yet to add the vertex to the current solution
@@ -1014,7 +1151,7 @@ inline void Solver::FindMaxClique(
             pool.stop_threads = true;
             return;
         }
-        if (pool.stop_threads) {
+        if (pool.stopped()) {
             return;
         }
 
@@ -1062,8 +1199,7 @@ inline void Solver::FindMaxClique(
         }
 
         // calculate sub-problem
-        custom_bitset::AND(V_new, P_Bj, G.get_neighbor_set(bi));
-        int V_new_size = V_new.count();
+        int V_new_size = custom_bitset::AND_count(V_new, P_Bj, G.get_neighbor_set(bi));
 
         u[bi] = std::min(u[bi], V_new_size+1);
         if (u[bi] + K.size() <= lb) {
@@ -1085,6 +1221,21 @@ inline void Solver::FindMaxClique(
         const int k = lb-depth;
         u[bi] = k+1;
 
+        if (!is_k_partite && V_new_size <= static_solver_max_size && (k+1)*static_solver_min_ratio <= V_new_size) {
+            // re-indexing costs more than the colouring, try to prune first
+            const auto n_isets = ISEQ_branching(G, V_new, _ISs, _color_class, k);
+            if (n_isets < k+1) {
+                u[bi] = n_isets+1;
+                continue;
+            }
+
+            if (find_static_clique(G, K, K_max, V_new_size, bi, k+1, max_time, pool)) {
+                pool.stop_threads = true;
+                return;
+            }
+            continue;
+        }
+
         int next_is_k_partite = is_k_partite;
 
         size_t new_alpha_idx = pool.borrow_alpha();
@@ -1104,7 +1255,7 @@ inline void Solver::FindMaxClique(
                 continue;
             }
 
-            if (FiltSAT(G, V_new, _ISs, _color_class, k+1)) {
+            if (FiltSAT(G, V_new, _ISs, _color_class, k+1, active_size)) {
                 pool.give_back_alpha(new_alpha_idx);
                 pool.give_back_bitset(B_new_idx);
                 continue;
@@ -1129,7 +1280,7 @@ inline void Solver::FindMaxClique(
             if (is_IS(G, _ISs[k])) {
                 next_is_k_partite = true;
                 // if we could return here, huge gains... damn
-                if (FiltSAT(G, V_new, _ISs, _color_class, k+1)) {
+                if (FiltSAT(G, V_new, _ISs, _color_class, k+1, active_size)) {
                     pool.give_back_alpha(new_alpha_idx);
                     pool.give_back_bitset(B_new_idx);
                     continue;
@@ -1141,7 +1292,7 @@ inline void Solver::FindMaxClique(
                 B_new.copy_same_size(_ISs[k]);
             } else {
                 B_new.copy_same_size(_ISs[k]);
-                if (SATCOL(G, B_new, _ISs, _color_class, k)) {
+                if (SATCOL(G, B_new, _ISs, _color_class, k, active_size)) {
                     pool.give_back_alpha(new_alpha_idx);
                     pool.give_back_bitset(B_new_idx);
                     continue;
@@ -1158,7 +1309,9 @@ inline void Solver::FindMaxClique(
 
         size_t local_u_idx = pool.borrow_u();
         std::vector<int>& local_u = pool.get_u(local_u_idx);
-        for (int i = 0; i < u.size(); i++) local_u[i] = u[i];
+        // the subtree reads and writes the bounds of its own vertices only, new_P_Bj and B_new (both in P_Bj here)
+        new_P_Bj.for_each_set_bit([&](const auto v) { local_u[v] = u[v]; });
+        B_new.for_each_set_bit([&](const auto v) { local_u[v] = u[v]; });
 
         /*
         if (pool.is_queue_full()) {
@@ -1204,8 +1357,8 @@ inline void Solver::FindMaxClique(
             std::vector<int>& local_color_class = pool.get_color_class(local_color_class_idx);
             std::swap(local_color_class, _color_class);
 
-            pool.submit(depth, [new_alpha_idx, B_new_idx, new_P_Bj_idx, local_ISs_idx, local_color_class_idx, local_K_idx, local_u_idx, &G, &K_max, &new_P_Bj, &B_new, max_time, &pool, &new_alpha, next_is_k_partite, &local_ISs, &local_color_class, &local_K, &local_u](Solver& solver, size_t sequence) {
-                if (!pool.stop_threads) solver.FindMaxClique(G, local_K, K_max, new_P_Bj, B_new, local_u, max_time, pool, sequence, new_alpha, next_is_k_partite, local_ISs, local_color_class);
+            pool.submit(depth, [new_alpha_idx, B_new_idx, new_P_Bj_idx, local_ISs_idx, local_color_class_idx, local_K_idx, local_u_idx, &G, &K_max, &new_P_Bj, &B_new, active_size, max_time, &pool, &new_alpha, next_is_k_partite, &local_ISs, &local_color_class, &local_K, &local_u](Solver& solver, size_t sequence) {
+                if (!pool.stopped()) solver.FindMaxClique(G, local_K, K_max, new_P_Bj, B_new, active_size, local_u, max_time, pool, sequence, new_alpha, next_is_k_partite, local_ISs, local_color_class);
                 pool.give_back_alpha(new_alpha_idx);
                 pool.give_back_bitset(B_new_idx);
                 pool.give_back_bitset(new_P_Bj_idx);
@@ -1215,8 +1368,8 @@ inline void Solver::FindMaxClique(
                 pool.give_back_u(local_u_idx);
             });
         } else {
-            pool.submit(depth, [new_alpha_idx, B_new_idx, new_P_Bj_idx, local_K_idx, local_u_idx, &G, &K_max, &new_P_Bj, &B_new, max_time, &pool, &new_alpha, next_is_k_partite, &local_K, &local_u](Solver& solver, size_t sequence) {
-                if (!pool.stop_threads) solver.FindMaxClique(G, local_K, K_max, new_P_Bj, B_new, local_u, max_time, pool, sequence, new_alpha, next_is_k_partite);
+            pool.submit(depth, [new_alpha_idx, B_new_idx, new_P_Bj_idx, local_K_idx, local_u_idx, &G, &K_max, &new_P_Bj, &B_new, active_size, max_time, &pool, &new_alpha, next_is_k_partite, &local_K, &local_u](Solver& solver, size_t sequence) {
+                if (!pool.stopped()) solver.FindMaxClique(G, local_K, K_max, new_P_Bj, B_new, active_size, local_u, max_time, pool, sequence, new_alpha, next_is_k_partite);
                 pool.give_back_alpha(new_alpha_idx);
                 pool.give_back_bitset(B_new_idx);
                 pool.give_back_bitset(new_P_Bj_idx);
@@ -1229,7 +1382,7 @@ inline void Solver::FindMaxClique(
 
         // to avoid task starvation
         thread_pool_CliSAT<Solver>::Task task;
-        while (pool.is_queue_full() && pool.get_higher_priority_task(task, depth-1, sequence)) task.func(*this, task.sequence);
+        while (pool.is_queue_full() && pool.get_higher_priority_task(task, depth-1, sequence)) task.run(*this);
 
         // if (new_solution_found) return true;
 
@@ -1238,8 +1391,165 @@ inline void Solver::FindMaxClique(
     }
 }
 
+// the subproblem in its own graph, with a pool that has no threads: the owning Solver runs its tasks
+struct Solver::local_subproblem {
+    custom_graph G;
+    thread_pool_CliSAT<Solver> pool;
+    Solver solver;
+    std::vector<int> vertices;  // local -> global, in the global order
+    custom_bitset P_Bj;
+    custom_bitset B;
+    fixed_vector<int> K;
+    fixed_vector<int> alpha;
+    std::vector<int> u;
+    std::vector<int> color_class;
+    std::vector<custom_bitset> ISs;
+
+    explicit local_subproblem(const size_t size)
+        : G(size), pool(size, 0), solver(size), P_Bj(size), B(size), K(size), alpha(size), u(size), color_class(size) {}
+};
+
+inline Solver::~Solver() = default;
+
+inline bool Solver::find_local_clique(
+    const custom_graph& G,
+    fixed_vector<int>& K,
+    solution<int>& K_max,
+    const custom_bitset& P_Bj,
+    const custom_bitset& B,
+    const std::vector<int>& u,
+    const std::chrono::time_point<std::chrono::steady_clock> max_time,
+    thread_pool_CliSAT<Solver>& pool,
+    const fixed_vector<int>& alpha,
+    const bool is_k_partite,
+    const std::vector<custom_bitset>& ISs,
+    const std::vector<int>& color_class
+) {
+    if (K.size() < 2 || !pool.all_threads_working()) return false;
+    // nested subproblems are always narrower, no level is in use twice
+    const auto n = P_Bj.count() + B.count();
+    const auto width = std::bit_ceil(std::max<std::size_t>(n, 64));
+    if (width * local_graph_min_ratio > G.size()) return false;
+    const auto level = static_cast<std::size_t>(std::countr_zero(width));
+    if (_local_subproblems.size() <= level) _local_subproblems.resize(level+1);
+    if (!_local_subproblems[level]) _local_subproblems[level] = std::make_unique<local_subproblem>(width);
+    auto& local = *_local_subproblems[level];
+
+    // V_new isn't in use until the branching loop
+    custom_bitset::OR(V_new, P_Bj, B);
+    local.vertices.resize(n);
+    V_new.extract(std::span(local.vertices));
+    for (std::size_t i = 0; i < n; ++i) _local_index[local.vertices[i]] = static_cast<int>(i);
+    local.G.assign_induced(G, V_new, local.vertices, _local_index, _local_tmp);
+
+    local.P_Bj.reset();
+    local.B.reset();
+    P_Bj.for_each_set_bit([&](const auto v) { local.P_Bj.set(_local_index[v]); });
+    B.for_each_set_bit([&](const auto v) { local.B.set(_local_index[v]); });
+    // the local order is the global one, so are the bounds
+    for (std::size_t i = 0; i < n; ++i) local.u[i] = u[local.vertices[i]];
+
+    if (is_k_partite) {
+        local.alpha.resize(alpha.size());
+        for (std::size_t i = 0; i < alpha.size(); ++i) local.alpha[i] = _local_index[alpha[i]];
+
+        while (local.ISs.size() < ISs.size()) local.ISs.emplace_back(width);
+        for (std::size_t i = 0; i < ISs.size(); ++i) {
+            local.ISs[i].reset();
+            custom_bitset::AND(_local_tmp, ISs[i], V_new);
+            _local_tmp.for_each_set_bit([&](const auto v) { local.ISs[i].set(_local_index[v]); });
+        }
+        for (std::size_t i = 0; i < n; ++i) local.color_class[i] = color_class[local.vertices[i]];
+    }
+
+    // K stays out of the local search: it starts empty and has to beat |K_max|-|K|.
+    // only its size is read until a bigger clique (of local vertices) replaces it
+    const auto lb = static_cast<int>(K_max.size()) - static_cast<int>(K.size());
+    solution<int> local_K_max(std::max(lb, 0));
+    local.K.resize(0);
+    local.pool.parent = &pool;
+    local.pool.stop_threads = false;
+
+    if (is_k_partite) {
+        local.solver.FindMaxClique(local.G, local.K, local_K_max, local.P_Bj, local.B, n, local.u, max_time, local.pool, local.pool.get_new_sequence(), local.alpha, true, local.ISs, local.color_class);
+    } else {
+        local.solver.FindMaxClique(local.G, local.K, local_K_max, local.P_Bj, local.B, n, local.u, max_time, local.pool, local.pool.get_new_sequence(), local.alpha);
+    }
+    // the tasks also give back what they borrowed, they run even when stopped
+    thread_pool_CliSAT<Solver>::Task task;
+    while (local.pool.get_task(task)) task.run(local.solver);
+
+    if (static_cast<int>(local_K_max.size()) <= lb) return true;
+
+    // map the clique back through the vertices, after K
+    const std::vector<int> clique = local_K_max;
+    for (std::size_t i = 0; i+1 < clique.size(); ++i) K.push_back(local.vertices[clique[i]]);
+    if (K_max.update_solution(K, local.vertices[clique.back()])) pool.stop_threads = true;
+    K.resize(K.size() - (clique.size()-1));
+
+    return true;
+}
+
+inline bool Solver::find_static_clique(
+    const custom_graph& G,
+    fixed_vector<int>& K,
+    solution<int>& K_max,
+    const size_t V_new_size,
+    const int bi,
+    const int size,
+    const std::chrono::time_point<std::chrono::steady_clock> max_time,
+    const thread_pool_CliSAT<Solver>& pool
+) {
+    if (V_new_size <= 64) return find_static_clique(_static_solver64, G, K, K_max, bi, size, max_time, pool);
+    if (V_new_size <= 128) return find_static_clique(_static_solver128, G, K, K_max, bi, size, max_time, pool);
+    if (V_new_size <= 256) return find_static_clique(_static_solver256, G, K, K_max, bi, size, max_time, pool);
+    return find_static_clique(_static_solver512, G, K, K_max, bi, size, max_time, pool);
+}
+
+template <std::size_t N>
+bool Solver::find_static_clique(
+    static_solver<N>& solver,
+    const custom_graph& G,
+    fixed_vector<int>& K,
+    solution<int>& K_max,
+    const int bi,
+    const int size,
+    const std::chrono::time_point<std::chrono::steady_clock> max_time,
+    const thread_pool_CliSAT<Solver>& pool
+) {
+    const auto should_stop = [&pool, max_time] { return pool.stopped() || std::chrono::steady_clock::now() > max_time; };
+
+    const bool found = solver.find_clique(G, V_new, size, _local_index, _local_tmp, should_stop);
+    steps += solver.steps();
+    if (!found) return false;
+
+    const auto& clique = solver.clique();
+    K.push_back(bi);
+    for (std::size_t i = 0; i+1 < clique.size(); ++i) K.push_back(clique[i]);
+    const bool improved = K_max.update_solution(K, clique.back());
+    K.resize(K.size() - clique.size());
+
+    return improved;
+}
+
 std::vector<int> CliSAT_no_sorting(const custom_graph& G, thread_pool_CliSAT<Solver>& pool, const custom_bitset& Ubb, std::chrono::milliseconds time_limit);
 
+std::vector<int> CliSAT_sparse(
+    csr_graph& S,
+    std::chrono::milliseconds time_limit,
+    size_t threads,
+    bool verbose);
+
+// snapshot of filename (see snapshot.h) in output: the bit matrix with the ordering of sorting_method (none for
+// NO_SORT and RANDOM_SORT), or the csr_graph with sparse or above dense_max_size vertices
+void convert(
+    const std::string& filename,
+    const std::string& output,
+    SORTING_METHOD sorting_method,
+    std::chrono::milliseconds cs_time_limit,
+    size_t threads,
+    bool sparse);
+
 std::vector<int> CliSAT(
     const std::string& filename,
     std::chrono::milliseconds time_limit,
@@ -1248,4 +1558,5 @@ std::vector<int> CliSAT(
     SORTING_METHOD sorting_method,
     bool AMTS_enabled,
     size_t threads,
-    bool verbose);
+    bool verbose,
+    bool sparse = false);
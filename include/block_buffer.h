@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "aligned_allocator.h"
+
+// aligned array of blocks, the storage of custom_bitset.
+// it either owns its memory (like the std::vector it replaces) or borrows a range of a bigger
+// buffer (a row of the custom_graph slab). a borrowed buffer never moves its data: copies and
+// assignments of the same size write through it, a resize detaches it into an owned buffer.
+// moving a buffer hands over the borrow, so a vector of rows can still reallocate
+template <class T, std::size_t alignment, class Allocator = aligned_allocator<T, alignment>>
+class block_buffer {
+public:
+    typedef std::size_t size_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+private:
+    T* _data = nullptr;
+    size_type _size = 0;
+    bool _owned = true;
+
+    static T* allocate(const size_type n) { return Allocator().allocate(n); }
+    void release() noexcept { if (_owned) Allocator().deallocate(_data, _size); }
+
+public:
+    block_buffer() = default;
+    explicit block_buffer(const size_type n, const T& value = T{}) : _data(allocate(n)), _size(n) { std::fill_n(_data, n, value); }
+
+    // the memory must be aligned and must outlive the buffer
+    static block_buffer borrow(T* data, const size_type n) noexcept {
+        assert(reinterpret_cast<std::uintptr_t>(data) % alignment == 0);
+
+        block_buffer buffer;
+        buffer._data = data;
+        buffer._size = n;
+        buffer._owned = false;
+        return buffer;
+    }
+
+    block_buffer(const block_buffer& other) : _data(allocate(other._size)), _size(other._size) { std::copy_n(other._data, _size, _data); }
+    block_buffer(block_buffer&& other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)), _owned(std::exchange(other._owned, true)) {}
+    ~block_buffer() { release(); }
+
+    block_buffer& operator=(const block_buffer& other) {
+        if (this == &other) return *this;
+        if (_size != other._size) *this = block_buffer(other._size);
+        std::copy_n(other._data, _size, _data);
+        return *this;
+    }
+
+    block_buffer& operator=(block_buffer&& other) noexcept {
+        if (this == &other) return *this;
+        // a borrowed row keeps its place in the slab
+        if (!_owned && _size == other._size) {
+            std::copy_n(other._data, _size, _data);
+            return *this;
+        }
+
+        release();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _owned = std::exchange(other._owned, true);
+        return *this;
+    }
+
+    // O(1) between owned buffers, borrowed ones exchange their contents
+    void swap(block_buffer& other) noexcept {
+        if (_owned && other._owned) {
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+        } else if (_size == other._size) {
+            std::swap_ranges(_data, _data + _size, other._data);
+        } else {
+            block_buffer tmp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(tmp);
+        }
+    }
+
+    // new blocks are zero
+    void resize(const size_type n) {
+        if (n == _size) return;
+
+        block_buffer resized(n);
+        std::copy_n(_data, std::min(n, _size), resized._data);
+        *this = std::move(resized);
+    }
+
+    [[nodiscard]] T* data() noexcept { return _data; }
+    [[nodiscard]] const T* data() const noexcept { return _data; }
+    [[nodiscard]] size_type size() const noexcept { return _size; }
+    [[nodiscard]] bool owned() const noexcept { return _owned; }
+
+    T& operator[](const size_type i) noexcept { assert(i < _size); return _data[i]; }
+    const T& operator[](const size_type i) const noexcept { assert(i < _size); return _data[i]; }
+    T& back() noexcept { assert(_size); return _data[_size-1]; }
+    const T& back() const noexcept { assert(_size); return _data[_size-1]; }
+
+    iterator begin() noexcept { return _data; }
+    iterator end() noexcept { return _data + _size; }
+    const_iterator begin() const noexcept { return _data; }
+    const_iterator end() const noexcept { return _data + _size; }
+};
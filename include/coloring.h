@@ -28,10 +28,12 @@ inline int ISEQ(const custom_graph& G, custom_bitset Ubb) {
 }
 
 // if we can't generate k independent sets, Ubb will be empty so then node will be fathomed (B empty)
-inline int ISEQ_branching(
-    const custom_graph& g,
-    const custom_bitset& Ubb,
-    std::vector<custom_bitset>& ISs,
+// templated on the graph/bitset pair, it's shared by custom_graph and the fixed width static_graph<N>
+template <typename graph_t, typename bitset_t>
+int ISEQ_branching(
+    const graph_t& g,
+    const bitset_t& Ubb,
+    std::vector<bitset_t>& ISs,
     std::vector<int>& color_class,
     const int k_max
 ) {
@@ -43,11 +45,11 @@ inline int ISEQ_branching(
 
     for (k = 0; k < k_max; ++k) {
         auto v = ISs[k_max].front();
-        if (v == custom_bitset::npos) return k;
+        if (v == bitset_t::npos) return k;
 
         ISs[k].copy_same_size(ISs[k_max]);
 
-        for (; v != custom_bitset::npos; v = ISs[k].next(v)) {
+        for (; v != bitset_t::npos; v = ISs[k].next(v)) {
             // at most, we can remove vertices, so we don't need to start a new scan
             ISs[k] -= g.get_neighbor_set(v);
             color_class[v] = k;
@@ -55,13 +57,10 @@ inline int ISEQ_branching(
         }
     }
 
-    auto v = ISs[k_max].front();
-    if (v == custom_bitset::npos) return k_max;
+    if (ISs[k_max].none()) return k_max;
 
-    for (; v != custom_bitset::npos; v = ISs[k_max].next(v)) {
-        // at most, we can remove vertices, so we don't need to start a new scan
-        color_class[v] = k_max;
-    }
+    // nothing is removed anymore, a single pass over the blocks is enough
+    ISs[k_max].for_each_set_bit([&](const auto v) { color_class[v] = k_max; });
 
     return k_max+1;
 }
@@ -167,16 +166,22 @@ inline int ISEQ_all(
 }
 
 // methods that tries to create the largest number of independent sets
-inline void ISEQ_one(
+// returns the size of IS: every visited vertex survives the removals, so no count() is needed
+inline std::size_t ISEQ_one(
     const custom_graph& g,
     const custom_bitset &Ubb,
     custom_bitset& IS
 ) {
+    std::size_t size = 0;
+
     IS = Ubb;
     for (const auto v : IS) {
         // at most, we can remove vertices, so we don't need to start a new scan
         IS -= g.get_neighbor_set(v);
+        ++size;
     }
+
+    return size;
 }
 
 inline bool is_IS(
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+// sparse graph in compressed sparse row form: the neighbours of v are _adjacency[_offsets[v], _offsets[v+1]),
+// sorted, so the ones before v (get_prev_neighbors) are a prefix of them.
+// the parsers build it for graphs whose bit matrix (custom_graph) doesn't fit in memory, the search then runs root by
+// root on small dense subgraphs (see CliSAT_sparse). the other ones go straight to the bit matrix
+class csr_graph {
+public:
+    typedef std::size_t size_type;
+    typedef std::uint32_t vertex_type;
+    typedef std::pair<vertex_type, vertex_type> edge_type;
+
+private:
+    std::vector<size_type> _offsets;
+    std::vector<vertex_type> _adjacency;
+
+public:
+    csr_graph() : _offsets(1, 0) {}
+    // undirected edges, 0-based. self loops and duplicates (also (u,v) and (v,u)) are dropped
+    csr_graph(size_type size, std::span<const edge_type> edges) : csr_graph(size, std::span(&edges, 1)) {}
+    // same, with the edges split in several buffers (one per parser thread)
+    csr_graph(size_type size, std::span<const std::span<const edge_type>> edge_buffers);
+    // arrays of an already built csr_graph (a snapshot): rows sorted, without duplicates
+    csr_graph(std::vector<size_type> offsets, std::vector<vertex_type> adjacency);
+
+    [[nodiscard]] size_type size() const noexcept { return _offsets.size() - 1; }
+    [[nodiscard]] size_type get_n_edges() const noexcept { return _adjacency.size() / 2; }
+
+    [[nodiscard]] std::span<const size_type> offsets() const noexcept { return _offsets; }
+    [[nodiscard]] std::span<const vertex_type> adjacency() const noexcept { return _adjacency; }
+    [[nodiscard]] std::span<const vertex_type> get_neighbors(size_type v) const;
+    [[nodiscard]] std::span<const vertex_type> get_prev_neighbors(size_type v) const;
+    [[nodiscard]] size_type degree(size_type v) const;
+    [[nodiscard]] bool adjacent(size_type u, size_type v) const;
+
+    [[nodiscard]] float get_density() const noexcept;
+    [[nodiscard]] size_type get_max_degree() const noexcept;
+    [[nodiscard]] size_type get_degeneracy() const;
+    // smallest-last order (order[new] = old): every vertex has at most get_degeneracy() neighbours before it
+    [[nodiscard]] std::vector<size_type> degeneracy_ordering() const;
+
+    // same convention of custom_graph::change_order, order[new] = old
+    void change_order(const std::vector<size_type>& order);
+};
+
+inline csr_graph::csr_graph(const size_type size, const std::span<const std::span<const edge_type>> edge_buffers) : _offsets(size+1, 0) {
+    for (const auto edges : edge_buffers) {
+        for (const auto& [u, v] : edges) {
+            assert(u < size && v < size);
+            if (u == v) continue;
+            ++_offsets[u+1];
+            ++_offsets[v+1];
+        }
+    }
+    std::partial_sum(_offsets.begin(), _offsets.end(), _offsets.begin());
+
+    _adjacency.resize(_offsets.back());
+    std::vector<size_type> next(_offsets.begin(), _offsets.end()-1);
+    for (const auto edges : edge_buffers) {
+        for (const auto& [u, v] : edges) {
+            if (u == v) continue;
+            _adjacency[next[u]++] = v;
+            _adjacency[next[v]++] = u;
+        }
+    }
+
+    // sort every row and squeeze the duplicates out, in place
+    size_type write = 0;
+    for (size_type v = 0; v < size; ++v) {
+        const auto first = _adjacency.begin() + _offsets[v];
+        const auto last = _adjacency.begin() + _offsets[v+1];
+        std::sort(first, last);
+        const auto unique_last = std::unique(first, last);
+
+        _offsets[v] = write;
+        write = std::copy(first, unique_last, _adjacency.begin() + write) - _adjacency.begin();
+    }
+    _offsets[size] = write;
+    _adjacency.resize(write);
+    _adjacency.shrink_to_fit();
+}
+
+inline csr_graph::csr_graph(std::vector<size_type> offsets, std::vector<vertex_type> adjacency)
+    : _offsets(std::move(offsets)), _adjacency(std::move(adjacency)) {
+    assert(!_offsets.empty() && _offsets.back() == _adjacency.size());
+}
+
+inline std::span<const csr_graph::vertex_type> csr_graph::get_neighbors(const size_type v) const {
+    assert(v < size());
+    return {_adjacency.data() + _offsets[v], _adjacency.data() + _offsets[v+1]};
+}
+
+inline std::span<const csr_graph::vertex_type> csr_graph::get_prev_neighbors(const size_type v) const {
+    const auto neighbors = get_neighbors(v);
+    return neighbors.first(std::ranges::lower_bound(neighbors, v) - neighbors.begin());
+}
+
+inline csr_graph::size_type csr_graph::degree(const size_type v) const {
+    assert(v < size());
+    return _offsets[v+1] - _offsets[v];
+}
+
+inline bool csr_graph::adjacent(const size_type u, const size_type v) const {
+    // search the shorter list
+    if (degree(u) > degree(v)) return std::ranges::binary_search(get_neighbors(v), u);
+    return std::ranges::binary_search(get_neighbors(u), v);
+}
+
+inline float csr_graph::get_density() const noexcept {
+    return 2.0f * static_cast<float>(get_n_edges()) /
+           (static_cast<float>(size()) * static_cast<float>(size() - 1));
+}
+
+inline csr_graph::size_type csr_graph::get_max_degree() const noexcept {
+    size_type max = 0;
+    for (size_type v = 0; v < size(); ++v) max = std::max(max, degree(v));
+    return max;
+}
+
+inline csr_graph::size_type csr_graph::get_degeneracy() const {
+    const auto order = degeneracy_ordering();
+    std::vector<size_type> position(size());
+    for (size_type i = 0; i < size(); ++i) position[order[i]] = i;
+
+    size_type max = 0;
+    for (size_type v = 0; v < size(); ++v) {
+        const auto neighbors = get_neighbors(v);
+        max = std::max<size_type>(max, std::ranges::count_if(neighbors, [&](const auto w) { return position[w] < position[v]; }));
+    }
+    return max;
+}
+
+// Batagelj-Zaversnik bucket queue, O(n+m): vertices sorted by degree (bin[d] is the first one of degree d),
+// removing the minimum moves its neighbours one bucket down. the removal order, reversed, is the ordering
+inline std::vector<csr_graph::size_type> csr_graph::degeneracy_ordering() const {
+    const auto n = size();
+    const auto max_degree = get_max_degree();
+
+    std::vector<size_type> degrees(n), bin(max_degree+2, 0), position(n), vertices(n);
+    for (size_type v = 0; v < n; ++v) ++bin[(degrees[v] = degree(v)) + 1];
+    std::partial_sum(bin.begin(), bin.end(), bin.begin());
+    for (size_type v = 0; v < n; ++v) {
+        position[v] = bin[degrees[v]]++;
+        vertices[position[v]] = v;
+    }
+    // bin[d] back to the first vertex of degree d
+    for (size_type d = max_degree+1; d > 0; --d) bin[d] = bin[d-1];
+    bin[0] = 0;
+
+    for (size_type i = 0; i < n; ++i) {
+        const auto v = vertices[i];
+        for (const auto w : get_neighbors(v)) {
+            if (degrees[w] <= degrees[v]) continue;
+
+            // swap w with the first vertex of its bucket, then shrink the bucket
+            const auto first = bin[degrees[w]];
+            const auto u = vertices[first];
+            if (u != w) {
+                std::swap(vertices[first], vertices[position[w]]);
+                position[u] = position[w];
+                position[w] = first;
+            }
+            ++bin[degrees[w]];
+            --degrees[w];
+        }
+    }
+
+    std::ranges::reverse(vertices);
+    return vertices;
+}
+
+inline void csr_graph::change_order(const std::vector<size_type>& order) {
+    assert(order.size() == size());
+
+    std::vector<vertex_type> old_to_new(size());
+    for (size_type i = 0; i < size(); ++i) old_to_new[order[i]] = static_cast<vertex_type>(i);
+
+    std::vector<size_type> offsets(size()+1, 0);
+    for (size_type i = 0; i < size(); ++i) offsets[i+1] = offsets[i] + degree(order[i]);
+
+    std::vector<vertex_type> adjacency(_adjacency.size());
+    for (size_type i = 0; i < size(); ++i) {
+        const auto row = adjacency.begin() + offsets[i];
+        std::ranges::transform(get_neighbors(order[i]), row, [&](const auto w) { return old_to_new[w]; });
+        std::sort(row, adjacency.begin() + offsets[i+1]);
+    }
+
+    _offsets = std::move(offsets);
+    _adjacency = std::move(adjacency);
+}
@@ -7,11 +7,14 @@
 #include <cassert>
 #include <concepts>
 #include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <print>
 #include <ostream>
 
-#include "aligned_allocator.h"
+#include "block_buffer.h"
 #include "instructions.h"
 
 // Primary concept for integer types
@@ -52,6 +55,7 @@ public:
         }
 
         friend class custom_bitset;
+        friend class hierarchical_bitset;
     };
 
     static const reference npos;
@@ -194,12 +198,20 @@ public:
     [[nodiscard]] reverse_const_iterator rend() const { return {this, npos}; }
 
 private:
+    friend class hierarchical_bitset;
+    friend class custom_graph;
+
     static constexpr size_type block_size = std::numeric_limits<block_type>::digits;
     static constexpr size_type block_size_log2 = std::countr_zero(block_size);
     static constexpr size_type alignment = 32; //bytes
 
     size_type _size;
-    std::vector<block_type, aligned_allocator<block_type, alignment>> _bits;
+    block_buffer<block_type, alignment> _bits;
+
+    // every block outside [_first, _last) is zero, the window can still contain zero blocks.
+    // an empty window always has _first == _last == 0
+    size_type _first = 0;
+    size_type _last = 0;
 
     static constexpr size_type get_block(const size_type pos) noexcept { return pos >> block_size_log2; };
     static constexpr size_type get_block_bit(const size_type pos) noexcept { return pos & below_mask(block_size_log2); }
@@ -216,6 +228,12 @@ private:
     static constexpr block_type from_mask(bit_type bit) noexcept;
     static constexpr block_type after_mask(bit_type bit) noexcept;
 
+    void widen_window(size_type block) noexcept;
+    void zero_outside(size_type first, size_type last) noexcept;
+    void trim_window() noexcept;
+    void fit_window() noexcept;
+    void clear_padding() noexcept;
+
     template <bool pop>
     reference front_impl(this auto&& self) noexcept;
 
@@ -228,6 +246,9 @@ private:
     template <bool pop>
     reference prev_impl(this auto&& self, reference ref);
 
+    // row of a custom_graph: the blocks live in the graph slab, the window is fitted to them
+    custom_bitset(block_type* data, size_type size);
+
 public:
     custom_bitset() : custom_bitset(0) {}
     explicit custom_bitset(size_type size, bool default_value = false);
@@ -347,12 +368,20 @@ public:
     static void DIFF(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, size_type end_pos);
     static void DIFF(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference& start, const reference& end);
     static void DIFF(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, size_type start_pos, size_type end_pos);
-    static void DIFF(custom_bitset& lhs, const custom_bitset& rhs) { lhs &= ~rhs; };
+    static void DIFF(custom_bitset& lhs, const custom_bitset& rhs) { lhs -= rhs; };
     static void DIFF(custom_bitset& lhs, const custom_bitset& rhs, const reference& end);
     static void DIFF(custom_bitset& lhs, const custom_bitset& rhs, size_type end_pos);
     static void DIFF(custom_bitset& lhs, const custom_bitset& rhs, const reference& start, const reference& end);
     static void DIFF(custom_bitset& lhs, const custom_bitset& rhs, size_type start_pos, size_type end_pos);
 
+    // same as AND/DIFF, but they also return dest.count()
+    static size_type AND_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static size_type AND_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference& end);
+    static size_type AND_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, size_type end_pos);
+    static size_type DIFF_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static size_type DIFF_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference& end);
+    static size_type DIFF_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, size_type end_pos);
+
     bool operator[](const reference& ref) const { return test(ref); };
     bool operator[](const size_type pos) const { return test(pos); };
     iterator operator[](const reference& ref) { return {this, ref}; };
@@ -386,6 +415,16 @@ public:
     [[nodiscard]] reference prev(const size_type pos) const { return prev(reference(pos)); }
     inline reference pop_prev(const reference& ref) { return prev_impl<true>(ref); }
 
+    // calls fn(pos) for every set bit in increasing order, a fn returning bool stops the scan on false.
+    // unlike the iterators the blocks are read once: fn must not modify this bitset
+    template <typename Fn>
+    void for_each_set_bit(Fn&& fn) const;
+
+    // writes the positions of the set bits in dest, in increasing order, and returns how many they are.
+    // dest must hold at least count() elements
+    template <Integer T>
+    size_type extract(std::span<T> dest) const;
+
     [[nodiscard]] size_type degree() const noexcept { return count(); };
 
     void flip() noexcept;
@@ -393,6 +432,8 @@ public:
     void reset() noexcept;
 
     [[nodiscard]] size_type size() const noexcept { return _size; }
+    // blocks [first, last) that can hold set bits, every block outside is zero
+    [[nodiscard]] std::pair<size_type, size_type> window() const noexcept { return {_first, _last}; }
     [[nodiscard]] size_type count() const noexcept;
     [[nodiscard]] size_type count(const reference& end) const noexcept;
     [[nodiscard]] size_type count(const size_type end_pos) const noexcept;
@@ -412,6 +453,8 @@ public:
 
     void resize(size_type new_size);
 
+    void set_before(const reference& ref);
+    void set_before(size_type pos);
     void clear_before(const reference& ref);
     void clear_before(size_type pos);
     void clear_until(const reference& ref);
@@ -453,6 +496,61 @@ constexpr custom_bitset::block_type custom_bitset::after_mask(const bit_type bit
     return ~block_type{1} << bit;
 }
 
+// called after setting a bit of block
+inline void custom_bitset::widen_window(const size_type block) noexcept {
+    if (_first == _last) {
+        _first = block;
+        _last = block+1;
+        return;
+    }
+
+    _first = std::min(_first, block);
+    _last = std::max(_last, block+1);
+}
+
+// clears the blocks of the current window not in [first, last) and makes it the new window.
+// the caller is expected to write every block of [first, last)
+inline void custom_bitset::zero_outside(const size_type first, const size_type last) noexcept {
+    if (first >= last) {
+        instructions::memset<alignment>(_bits.data(), 0, _first, _last);
+        _first = _last = 0;
+        return;
+    }
+
+    instructions::memset<alignment>(_bits.data(), 0, _first, std::min(_last, first));
+    instructions::memset<alignment>(_bits.data(), 0, std::max(_first, last), _last);
+
+    _first = first;
+    _last = last;
+}
+
+// drops the zero blocks at both ends of the window
+inline void custom_bitset::trim_window() noexcept {
+    // locals: blocks and indices share the same type, so the compiler can't keep members in registers
+    auto first = _first;
+    auto last = _last;
+
+    while (first < last && _bits[first] == 0) ++first;
+    while (last > first && _bits[last-1] == 0) --last;
+    if (first >= last) first = last = 0;
+
+    _first = first;
+    _last = last;
+}
+
+// recomputes the window from scratch, used by operations that don't track it
+inline void custom_bitset::fit_window() noexcept {
+    _first = 0;
+    _last = _bits.size();
+    trim_window();
+}
+
+// clears the bits after the last position, set by operations that complement whole blocks.
+// a full last block has none (below_mask(0) would clear all of them), an empty bitset keeps one block to clear
+inline void custom_bitset::clear_padding() noexcept {
+    if (get_block_bit(_size) || _size == 0) _bits.back() &= below_mask(get_block_bit(_size));
+}
+
 template <>
 struct std::formatter<custom_bitset::reference> : std::formatter<custom_bitset::size_type> {
     auto format(const custom_bitset::reference& id, std::format_context& ctx) const {
@@ -480,6 +578,14 @@ inline custom_bitset::custom_bitset(const size_type size, const bool default_val
 {
     // unset last part of last block (if there is one)
     if (get_block_bit(_size)) _bits.back() &= below_mask(get_block_bit(_size));
+    if (default_value && _size) _last = _bits.size();
+}
+
+inline custom_bitset::custom_bitset(block_type* data, const size_type size)
+        : _size(size),
+          _bits(decltype(_bits)::borrow(data, blocks_needed(size)))
+{
+    fit_window();
 }
 
 /*
@@ -562,11 +668,12 @@ inline custom_bitset custom_bitset::from(const custom_bitset &src, const size_ty
 }
 
 inline void custom_bitset::BEFORE(custom_bitset& dest, const custom_bitset& src, const reference &ref) {
-    const auto a = std::assume_aligned<alignment>(dest._bits.data());
-    const auto b = std::assume_aligned<alignment>(src._bits.data());
+    const auto first = src._first;
+    const auto last = std::min(src._last, ref.block+1);
 
-    for (size_type i = 0; i < ref.block+1; ++i)
-        a[i] = b[i];
+    dest.zero_outside(first, last);
+    for (size_type i = first; i < last; ++i)
+        dest._bits[i] = src._bits[i];
     dest.clear_from(ref);
 }
 
@@ -575,11 +682,12 @@ inline void custom_bitset::BEFORE(custom_bitset& dest, const custom_bitset& src,
 }
 
 inline void custom_bitset::UNTIL(custom_bitset& dest, const custom_bitset& src, const reference &ref) {
-    const auto a = std::assume_aligned<alignment>(dest._bits.data());
-    const auto b = std::assume_aligned<alignment>(src._bits.data());
+    const auto first = src._first;
+    const auto last = std::min(src._last, ref.block+1);
 
-    for (size_type i = 0; i < ref.block+1; ++i)
-        a[i] = b[i];
+    dest.zero_outside(first, last);
+    for (size_type i = first; i < last; ++i)
+        dest._bits[i] = src._bits[i];
     dest.clear_after(ref);
 }
 
@@ -588,11 +696,12 @@ inline void custom_bitset::UNTIL(custom_bitset& dest, const custom_bitset& src,
 }
 
 inline void custom_bitset::AFTER(custom_bitset& dest, const custom_bitset& src, const reference &ref) {
-    const auto a = std::assume_aligned<alignment>(dest._bits.data());
-    const auto b = std::assume_aligned<alignment>(src._bits.data());
+    const auto first = std::max(src._first, ref.block);
+    const auto last = src._last;
 
-    for (size_type i = ref.block; i < dest._bits.size(); ++i)
-        a[i] = b[i];
+    dest.zero_outside(first, last);
+    for (size_type i = first; i < last; ++i)
+        dest._bits[i] = src._bits[i];
     dest.clear_until(ref);
 }
 
@@ -601,11 +710,12 @@ inline void custom_bitset::AFTER(custom_bitset& dest, const custom_bitset& src,
 }
 
 inline void custom_bitset::FROM(custom_bitset& dest, const custom_bitset& src, const reference &ref) {
-    const auto a = std::assume_aligned<alignment>(dest._bits.data());
-    const auto b = std::assume_aligned<alignment>(src._bits.data());
+    const auto first = std::max(src._first, ref.block);
+    const auto last = src._last;
 
-    for (size_type i = ref.block; i < dest._bits.size(); ++i)
-        a[i] = b[i];
+    dest.zero_outside(first, last);
+    for (size_type i = first; i < last; ++i)
+        dest._bits[i] = src._bits[i];
     dest.clear_before(ref);
 }
 
@@ -652,8 +762,15 @@ inline bool custom_bitset::operator==(const custom_bitset &other) const {
 }
 
 inline custom_bitset& custom_bitset::operator=(const custom_bitset &other) {
+    if (_bits.size() == other._bits.size()) {
+        _size = other.size();
+        return copy_same_size(other);
+    }
+
     _bits.resize(other._bits.size());
     _size = other.size();
+    _first = other._first;
+    _last = other._last;
 
     // using this functions results in a call to memcpy, slower than manual loop
     // few elements. -fno-tree-loop-distribute-patterns could resolve it
@@ -671,17 +788,23 @@ inline custom_bitset& custom_bitset::operator=(const custom_bitset &other) {
 }
 
 inline custom_bitset& custom_bitset::copy_same_size(const custom_bitset &other) {
-    assert(size() == other.size());
-    [[assume(size() == other.size())]];
+    assert(_bits.size() == other._bits.size());
+    [[assume(_bits.size() == other._bits.size())]];
+
+    if (this == &other) return *this;
 
     // using this functions results in a call to memcpy, slower than manual loop
     // few elements. -fno-tree-loop-distribute-patterns could resolve it
     //instructions::memcpy<alignment>(_bits.data(), other._bits.data(), _bits.size());
 
+    const auto first = other._first;
+    const auto last = other._last;
+    zero_outside(first, last);
+
     const auto a = std::assume_aligned<alignment>(_bits.data());
     const auto b = std::assume_aligned<alignment>(other._bits.data());
 
-    for (size_type i = 0; i < _bits.size(); ++i)
+    for (size_type i = first; i < last; ++i)
         a[i] = b[i];
 
     assert(count() == other.count());
@@ -693,6 +816,8 @@ inline custom_bitset& custom_bitset::copy_same_size(const custom_bitset &other)
 inline custom_bitset& custom_bitset::operator=(custom_bitset&& other) noexcept {
 	_bits = std::move(other._bits);
     _size = other._size;
+    _first = other._first;
+    _last = other._last;
 
     return *this;
 }
@@ -703,6 +828,8 @@ inline custom_bitset& custom_bitset::copy_same_size(custom_bitset&& other) noexc
 
     //_size = other._size;
     _bits = std::move(other._bits);
+    _first = other._first;
+    _last = other._last;
 
     return *this;
 }
@@ -711,7 +838,12 @@ inline custom_bitset& custom_bitset::operator&=(const custom_bitset &other) {
     assert(size() == other.size());
     [[assume(size() == other.size())]];
 
-    instructions::and_inplace<alignment>(_bits.data(), other._bits.data(), _bits.size());
+    const auto first = std::max(_first, other._first);
+    const auto last = std::min(_last, other._last);
+
+    zero_outside(first, last);
+    instructions::and_inplace<alignment>(_bits.data(), other._bits.data(), _first, _last);
+    trim_window();
 
     return *this;
 }
@@ -720,7 +852,11 @@ inline custom_bitset& custom_bitset::operator|=(const custom_bitset &other) {
     assert(size() == other.size());
     [[assume(size() == other.size())]];
 
-    instructions::or_inplace<alignment>(_bits.data(), other._bits.data(), _bits.size());
+    if (other._first == other._last) return *this;
+
+    instructions::or_inplace<alignment>(_bits.data(), other._bits.data(), other._first, other._last);
+    widen_window(other._first);
+    widen_window(other._last-1);
 
     return *this;
 }
@@ -729,11 +865,12 @@ inline custom_bitset& custom_bitset::operator^=(const custom_bitset &other) {
     assert(size() == other.size());
     [[assume(size() == other.size())]];
 
-    const auto a = std::assume_aligned<alignment>(_bits.data());
-    const auto b = std::assume_aligned<alignment>(other._bits.data());
+    if (other._first == other._last) return *this;
 
-    for (size_type i = 0; i < _bits.size(); ++i)
-        a[i] ^= b[i];
+    instructions::xor_inplace<alignment>(_bits.data(), other._bits.data(), other._first, other._last);
+    widen_window(other._first);
+    widen_window(other._last-1);
+    trim_window();
 
     return *this;
 }
@@ -742,7 +879,13 @@ inline custom_bitset& custom_bitset::operator-=(const custom_bitset &other) {
     assert(size() == other.size());
     [[assume(size() == other.size())]];
 
-    instructions::diff_inplace<alignment>(_bits.data(), other._bits.data(), _bits.size());
+    // removing bits keeps the window valid, so it's left untouched: -= is the inner step of ISEQ
+    // and re-trimming after every neighbor set costs more than it saves.
+    // a mostly overlapping range is cheaper as a plain full pass (fixed length, predictable)
+    const auto first = std::max(_first, other._first);
+    const auto last = std::min(_last, other._last);
+    if (2*(last - first) > _bits.size()) instructions::diff_inplace<alignment>(_bits.data(), other._bits.data(), _bits.size());
+    else if (first < last) instructions::diff_inplace<alignment>(_bits.data(), other._bits.data(), first, last);
 
     return *this;
 }
@@ -753,7 +896,12 @@ inline void custom_bitset::AND(custom_bitset& dest, const custom_bitset& src1, c
     [[assume(dest.size() == src1.size())]];
     [[assume(src1.size() == src2.size())]];
 
-    instructions::and_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    const auto first = std::max(src1._first, src2._first);
+    const auto last = std::min(src1._last, src2._last);
+
+    dest.zero_outside(first, last);
+    instructions::and_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._first, dest._last);
+    dest.trim_window();
 }
 
 inline void custom_bitset::AND(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -767,6 +915,7 @@ inline void custom_bitset::AND(custom_bitset& dest, const custom_bitset& src1, c
     instructions::and_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
     dest._bits[end.block] = (src1._bits[end.block] & src2._bits[end.block]) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::AND(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -789,6 +938,7 @@ inline void custom_bitset::AND(custom_bitset& dest, const custom_bitset& src1, c
     instructions::and_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (src1._bits[end.block] & src2._bits[end.block]) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::AND(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -804,6 +954,7 @@ inline void custom_bitset::AND(custom_bitset& lhs, const custom_bitset& rhs, con
 
     instructions::and_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] &= (rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::AND(custom_bitset& lhs, const custom_bitset& rhs,
@@ -822,6 +973,7 @@ inline void custom_bitset::AND(custom_bitset& lhs, const custom_bitset& rhs, con
     lhs._bits[start.block] &= (rhs._bits[start.block] & from_mask(start.bit));
     instructions::and_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] &= (rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::AND(custom_bitset& lhs, const custom_bitset& rhs,
@@ -835,7 +987,14 @@ inline void custom_bitset::OR(custom_bitset& dest, const custom_bitset& src1, co
     [[assume(dest.size() == src1.size())]];
     [[assume(src1.size() == src2.size())]];
 
-    instructions::or_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    if (src1._first == src1._last) { dest.copy_same_size(src2); return; }
+    if (src2._first == src2._last) { dest.copy_same_size(src1); return; }
+
+    const auto first = std::min(src1._first, src2._first);
+    const auto last = std::max(src1._last, src2._last);
+
+    dest.zero_outside(first, last);
+    instructions::or_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), first, last);
 }
 
 inline void custom_bitset::OR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -849,6 +1008,7 @@ inline void custom_bitset::OR(custom_bitset& dest, const custom_bitset& src1, co
     instructions::or_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
     dest._bits[end.block] = (src1._bits[end.block] | src2._bits[end.block]) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::OR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -871,6 +1031,7 @@ inline void custom_bitset::OR(custom_bitset& dest, const custom_bitset& src1, co
     instructions::or_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (src1._bits[end.block] | src2._bits[end.block]) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::OR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -886,6 +1047,7 @@ inline void custom_bitset::OR(custom_bitset& lhs, const custom_bitset& rhs, cons
 
     instructions::or_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] |= (rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::OR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -904,6 +1066,7 @@ inline void custom_bitset::OR(custom_bitset& lhs, const custom_bitset& rhs, cons
     lhs._bits[start.block] |= (rhs._bits[start.block] & from_mask(start.bit));
     instructions::or_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] |= (rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::OR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -917,7 +1080,15 @@ inline void custom_bitset::XOR(custom_bitset& dest, const custom_bitset& src1, c
     [[assume(dest.size() == src1.size())]];
     [[assume(src1.size() == src2.size())]];
 
-    instructions::xor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    if (src1._first == src1._last) { dest.copy_same_size(src2); return; }
+    if (src2._first == src2._last) { dest.copy_same_size(src1); return; }
+
+    const auto first = std::min(src1._first, src2._first);
+    const auto last = std::max(src1._last, src2._last);
+
+    dest.zero_outside(first, last);
+    instructions::xor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), first, last);
+    dest.trim_window();
 }
 
 inline void custom_bitset::XOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -931,6 +1102,7 @@ inline void custom_bitset::XOR(custom_bitset& dest, const custom_bitset& src1, c
     instructions::xor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
     dest._bits[end.block] = (src1._bits[end.block] ^ src2._bits[end.block]) & until_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::XOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -953,6 +1125,7 @@ inline void custom_bitset::XOR(custom_bitset& dest, const custom_bitset& src1, c
     instructions::xor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (src1._bits[end.block] ^ src2._bits[end.block]) & until_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::XOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -968,6 +1141,7 @@ inline void custom_bitset::XOR(custom_bitset& lhs, const custom_bitset& rhs, con
 
     instructions::xor_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] ^= (rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::XOR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -986,6 +1160,7 @@ inline void custom_bitset::XOR(custom_bitset& lhs, const custom_bitset& rhs, con
     lhs._bits[start.block] ^= (rhs._bits[start.block] & from_mask(start.bit));
     instructions::xor_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] ^= (rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::XOR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1000,6 +1175,8 @@ inline void custom_bitset::NAND(custom_bitset& dest, const custom_bitset& src1,
     [[assume(src1.size() == src2.size())]];
 
     instructions::nand_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    dest.clear_padding();
+    dest.fit_window();
 }
 
 inline void custom_bitset::NAND(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -1013,6 +1190,7 @@ inline void custom_bitset::NAND(custom_bitset& dest, const custom_bitset& src1,
     instructions::nand_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
     dest._bits[end.block] = (~(src1._bits[end.block] & src2._bits[end.block])) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::NAND(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1035,6 +1213,7 @@ inline void custom_bitset::NAND(custom_bitset& dest, const custom_bitset& src1,
     instructions::nand_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (~(src1._bits[end.block] & src2._bits[end.block])) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::NAND(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1050,6 +1229,7 @@ inline void custom_bitset::NAND(custom_bitset& lhs, const custom_bitset& rhs, co
 
     instructions::nand_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] = (~(lhs._bits[end.block] & rhs._bits[end.block])) & until_mask(end.bit);
+    lhs.fit_window();
 }
 
 inline void custom_bitset::NAND(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1068,6 +1248,7 @@ inline void custom_bitset::NAND(custom_bitset& lhs, const custom_bitset& rhs, co
     lhs._bits[start.block] = (~(lhs._bits[start.block] & rhs._bits[start.block])) & from_mask(start.bit);
     instructions::nand_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] = (~(lhs._bits[end.block] & rhs._bits[end.block])) & until_mask(end.bit);
+    lhs.fit_window();
 }
 
 inline void custom_bitset::NAND(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1082,6 +1263,8 @@ inline void custom_bitset::NOR(custom_bitset& dest, const custom_bitset& src1, c
     [[assume(src1.size() == src2.size())]];
 
     instructions::nor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    dest.clear_padding();
+    dest.fit_window();
 }
 
 inline void custom_bitset::NOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -1092,9 +1275,12 @@ inline void custom_bitset::NOR(custom_bitset& dest, const custom_bitset& src1, c
     [[assume(src1.size() == src2.size())]];
     [[assume(end <= dest.size())]];
 
+    // everything after end is zero: only [0, end) and the old window are touched
+    const auto last = end.block + (end.bit != 0);
+    dest.zero_outside(0, last);
     instructions::nor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
-    dest._bits[end.block] = (~(src1._bits[end.block] | src2._bits[end.block])) & below_mask(end.bit);
-    instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    if (end.bit) dest._bits[end.block] = (~(src1._bits[end.block] | src2._bits[end.block])) & below_mask(end.bit);
+    dest.trim_window();
 }
 
 inline void custom_bitset::NOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1117,6 +1303,7 @@ inline void custom_bitset::NOR(custom_bitset& dest, const custom_bitset& src1, c
     instructions::nor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (~(src1._bits[end.block] | src2._bits[end.block])) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::NOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1132,6 +1319,7 @@ inline void custom_bitset::NOR(custom_bitset& lhs, const custom_bitset& rhs, con
 
     instructions::nor_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] = (~(lhs._bits[end.block] | rhs._bits[end.block])) & until_mask(end.bit);
+    lhs.fit_window();
 }
 
 inline void custom_bitset::NOR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1150,6 +1338,7 @@ inline void custom_bitset::NOR(custom_bitset& lhs, const custom_bitset& rhs, con
     lhs._bits[start.block] = (~(lhs._bits[start.block] | rhs._bits[start.block])) & from_mask(start.bit);
     instructions::nor_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] = (~(lhs._bits[end.block] | rhs._bits[end.block])) & until_mask(end.bit);
+    lhs.fit_window();
 }
 
 inline void custom_bitset::NOR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1164,6 +1353,8 @@ inline void custom_bitset::NXOR(custom_bitset& dest, const custom_bitset& src1,
     [[assume(src1.size() == src2.size())]];
 
     instructions::nxor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    dest.clear_padding();
+    dest.fit_window();
 }
 
 inline void custom_bitset::NXOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -1177,6 +1368,7 @@ inline void custom_bitset::NXOR(custom_bitset& dest, const custom_bitset& src1,
     instructions::nxor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
     dest._bits[end.block] = (~(src1._bits[end.block] ^ src2._bits[end.block])) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::NXOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1199,6 +1391,7 @@ inline void custom_bitset::NXOR(custom_bitset& dest, const custom_bitset& src1,
     instructions::nxor_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (~(src1._bits[end.block] ^ src2._bits[end.block])) & below_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::NXOR(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1214,6 +1407,7 @@ inline void custom_bitset::NXOR(custom_bitset& lhs, const custom_bitset& rhs, co
 
     instructions::nxor_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] = (~(lhs._bits[end.block] ^ rhs._bits[end.block])) & until_mask(end.bit);
+    lhs.fit_window();
 }
 
 inline void custom_bitset::NXOR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1232,6 +1426,7 @@ inline void custom_bitset::NXOR(custom_bitset& lhs, const custom_bitset& rhs, co
     lhs._bits[start.block] = (~(lhs._bits[start.block] ^ rhs._bits[start.block])) & from_mask(start.bit);
     instructions::nxor_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] = (~(lhs._bits[end.block] ^ rhs._bits[end.block])) & until_mask(end.bit);
+    lhs.fit_window();
 }
 
 inline void custom_bitset::NXOR(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1245,7 +1440,12 @@ inline void custom_bitset::DIFF(custom_bitset &dest, const custom_bitset &src1,
     [[assume(dest.size() == src1.size())]];
     [[assume(src1.size() == src2.size())]];
 
-    instructions::diff_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._bits.size());
+    const auto first = src1._first;
+    const auto last = src1._last;
+
+    dest.zero_outside(first, last);
+    instructions::diff_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), first, last);
+    dest.trim_window();
 }
 
 inline void custom_bitset::DIFF(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
@@ -1259,6 +1459,7 @@ inline void custom_bitset::DIFF(custom_bitset& dest, const custom_bitset& src1,
     instructions::diff_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), end.block);
     dest._bits[end.block] = (src1._bits[end.block] & ~src2._bits[end.block]) & until_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::DIFF(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const size_type end_pos) {
@@ -1280,6 +1481,7 @@ inline void custom_bitset::DIFF(custom_bitset& dest, const custom_bitset& src1,
     instructions::diff_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), start.block+1, end.block);
     dest._bits[end.block] = (src1._bits[end.block] & ~src2._bits[end.block]) & until_mask(end.bit);
     instructions::memset<alignment>(dest._bits.data(), 0, end.block+1, dest._bits.size());
+    dest.fit_window();
 }
 
 inline void custom_bitset::DIFF(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
@@ -1295,6 +1497,7 @@ inline void custom_bitset::DIFF(custom_bitset& lhs, const custom_bitset& rhs, co
 
     instructions::diff_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), end.block);
     lhs._bits[end.block] &= ~(rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::DIFF(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1313,6 +1516,7 @@ inline void custom_bitset::DIFF(custom_bitset& lhs, const custom_bitset& rhs, co
     lhs._bits[start.block] &= ~(rhs._bits[start.block] & from_mask(start.bit));
     instructions::diff_inplace<alignment>(lhs._bits.data(), rhs._bits.data(), start.block+1, end.block);
     lhs._bits[end.block] &= ~(rhs._bits[end.block] & until_mask(end.bit));
+    lhs.fit_window();
 }
 
 inline void custom_bitset::DIFF(custom_bitset& lhs, const custom_bitset& rhs,
@@ -1320,6 +1524,104 @@ inline void custom_bitset::DIFF(custom_bitset& lhs, const custom_bitset& rhs,
     DIFF(lhs, rhs, reference(start_pos), reference(end_pos));
 }
 
+inline custom_bitset::size_type custom_bitset::AND_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    assert(dest.size() == src1.size());
+    assert(src1.size() == src2.size());
+    [[assume(dest.size() == src1.size())]];
+    [[assume(src1.size() == src2.size())]];
+
+    const auto first = std::max(src1._first, src2._first);
+    const auto last = std::min(src1._last, src2._last);
+
+    dest.zero_outside(first, last);
+    const auto sum = instructions::and_count_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), dest._first, dest._last);
+
+    if (sum == 0) dest._first = dest._last = 0;
+    else dest.trim_window();
+
+    return sum;
+}
+
+inline custom_bitset::size_type custom_bitset::AND_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
+    assert(dest.size() == src1.size());
+    assert(src1.size() == src2.size());
+    assert(end <= dest.size());
+    [[assume(dest.size() == src1.size())]];
+    [[assume(src1.size() == src2.size())]];
+    [[assume(end <= dest.size())]];
+
+    const auto first = std::max(src1._first, src2._first);
+    const auto last = std::min({src1._last, src2._last, end.block+1});
+
+    dest.zero_outside(first, last);
+    size_type sum = instructions::and_count_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), first, last);
+
+    // the block of end was written, drop the bits from end onwards
+    if (last == end.block+1) {
+        sum -= std::popcount(dest._bits[end.block] & from_mask(end.bit));
+        dest._bits[end.block] &= below_mask(end.bit);
+    }
+
+    if (sum == 0) dest._first = dest._last = 0;
+    else dest.trim_window();
+
+    return sum;
+}
+
+inline custom_bitset::size_type custom_bitset::AND_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
+    const size_type end_pos) {
+    return AND_count(dest, src1, src2, reference(end_pos));
+}
+
+inline custom_bitset::size_type custom_bitset::DIFF_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    assert(dest.size() == src1.size());
+    assert(src1.size() == src2.size());
+    [[assume(dest.size() == src1.size())]];
+    [[assume(src1.size() == src2.size())]];
+
+    const auto first = src1._first;
+    const auto last = src1._last;
+
+    dest.zero_outside(first, last);
+    const auto sum = instructions::diff_count_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), first, last);
+
+    if (sum == 0) dest._first = dest._last = 0;
+    else dest.trim_window();
+
+    return sum;
+}
+
+inline custom_bitset::size_type custom_bitset::DIFF_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const reference &end) {
+    assert(dest.size() == src1.size());
+    assert(src1.size() == src2.size());
+    assert(end <= dest.size());
+    [[assume(dest.size() == src1.size())]];
+    [[assume(src1.size() == src2.size())]];
+    [[assume(end <= dest.size())]];
+
+    const auto first = src1._first;
+    const auto last = std::min(src1._last, end.block+1);
+
+    dest.zero_outside(first, last);
+    size_type sum = instructions::diff_count_store<alignment>(dest._bits.data(), src1._bits.data(), src2._bits.data(), first, last);
+
+    // the block of end was written, drop the bits from end onwards
+    if (last == end.block+1) {
+        sum -= std::popcount(dest._bits[end.block] & from_mask(end.bit));
+        dest._bits[end.block] &= below_mask(end.bit);
+    }
+
+    if (sum == 0) dest._first = dest._last = 0;
+    else dest.trim_window();
+
+    return sum;
+}
+
+inline custom_bitset::size_type custom_bitset::DIFF_count(custom_bitset& dest, const custom_bitset& src1, const custom_bitset& src2,
+    const size_type end_pos) {
+    return DIFF_count(dest, src1, src2, reference(end_pos));
+}
+
 inline custom_bitset::operator std::vector<custom_bitset::size_type>() const {
     std::vector<size_type> list;
     list.reserve(count());
@@ -1347,6 +1649,7 @@ inline void custom_bitset::set(const reference &ref) {
     [[assume(ref < _size)]];
 
     _bits[ref.block] |= mask_bit(ref.bit);
+    widen_window(ref.block);
 }
 
 inline void custom_bitset::set(const reference &ref, const bool value) {
@@ -1363,10 +1666,13 @@ inline void custom_bitset::reset(const reference &ref) {
 
 inline void custom_bitset::set() noexcept {
     instructions::memset<alignment>(_bits.data(), std::numeric_limits<block_type>::max(), _bits.size());
+    clear_padding();
+    fit_window();
 }
 
 inline void custom_bitset::reset() noexcept {
-    instructions::memset<alignment>(_bits.data(), 0, _bits.size());
+    instructions::memset<alignment>(_bits.data(), 0, _first, _last);
+    _first = _last = 0;
 }
 
 inline void custom_bitset::flip(const reference &ref) {
@@ -1374,6 +1680,7 @@ inline void custom_bitset::flip(const reference &ref) {
     [[assume(ref < _size)]];
 
     _bits[ref.block] ^= mask_bit(ref.bit);
+    widen_window(ref.block);
 }
 
 inline bool custom_bitset::test(const reference &ref) const {
@@ -1385,14 +1692,12 @@ inline bool custom_bitset::test(const reference &ref) const {
 
 template <bool pop>
 custom_bitset::reference custom_bitset::front_impl(this auto&& self) noexcept {
-    for (auto ref = reference{0, 0}; ref.block < self._bits.size(); ++ref.block) {
-        if (self._bits[ref.block] != 0) {
-            ref.bit = instructions::bit_scan_forward(self._bits[ref.block]);
-            if constexpr (pop) self.reset(ref);
-            return ref;
-        }
-    }
-    return npos;
+    const auto block = instructions::find_first<alignment>(self._bits.data(), self._first, self._last);
+    if (block == self._last) return npos;
+
+    const reference ref{block, instructions::bit_scan_forward(self._bits[block])};
+    if constexpr (pop) self.reset(ref);
+    return ref;
 }
 
 template <bool pop>
@@ -1410,29 +1715,25 @@ custom_bitset::reference custom_bitset::next_impl(this auto&& self, reference re
         return ref;
     }
 
-    for (++ref.block; ref.block < self._bits.size(); ++ref.block) {
-        if (self._bits[ref.block] != 0) {
-            ref.bit = instructions::bit_scan_forward(self._bits[ref.block]);
-            if constexpr (pop) self.reset(ref);
-            return ref;
-        }
-    }
+    const auto start = std::max(ref.block+1, self._first);
+    if (start >= self._last) return npos;
 
-    return npos;
+    ref.block = instructions::find_first<alignment>(self._bits.data(), start, self._last);
+    if (ref.block == self._last) return npos;
+
+    ref.bit = instructions::bit_scan_forward(self._bits[ref.block]);
+    if constexpr (pop) self.reset(ref);
+    return ref;
 }
 
 template <bool pop>
 custom_bitset::reference custom_bitset::back_impl(this auto&& self) noexcept {
-    reference ref(self._size-1);
-    do {
-        if (self._bits[ref.block] != 0) {
-            ref.bit = instructions::bit_scan_reverse(self._bits[ref.block]);
-            if constexpr (pop) self.reset(ref);
-            return ref;
-        }
-    } while (ref.block-- > 0);
+    const auto block = instructions::find_last<alignment>(self._bits.data(), self._first, self._last);
+    if (block == self._last) return npos;
 
-    return npos;
+    const reference ref{block, instructions::bit_scan_reverse(self._bits[block])};
+    if constexpr (pop) self.reset(ref);
+    return ref;
 }
 
 template <bool pop>
@@ -1447,24 +1748,60 @@ custom_bitset::reference custom_bitset::prev_impl(this auto&& self, reference re
         return ref;
     }
 
-    while (ref.block-- > 0) {
-        if (self._bits[ref.block] != 0) {
-            ref.bit = instructions::bit_scan_reverse(self._bits[ref.block]);
-            if constexpr (pop) self.reset(ref);
-            return ref;
-        }
+    const auto end = std::min(ref.block, self._last);
+    if (end <= self._first) return npos;
+
+    ref.block = instructions::find_last<alignment>(self._bits.data(), self._first, end);
+    if (ref.block == end) return npos;
+
+    ref.bit = instructions::bit_scan_reverse(self._bits[ref.block]);
+    if constexpr (pop) self.reset(ref);
+    return ref;
+}
+
+template <typename Fn>
+void custom_bitset::for_each_set_bit(Fn&& fn) const {
+    const auto* bits = _bits.data();
+
+    for (auto block = _first; block < _last; ++block) {
+        auto word = bits[block];
+        if (word == 0) continue;
+
+        const size_type base = block << block_size_log2;
+        do {
+            const size_type pos = base + instructions::bit_scan_forward(word);
+            if constexpr (std::is_same_v<std::invoke_result_t<Fn&, size_type>, bool>) {
+                if (!fn(pos)) return;
+            } else {
+                fn(pos);
+            }
+            word &= word - 1;
+        } while (word != 0);
     }
+}
 
-    return npos;
+template <Integer T>
+custom_bitset::size_type custom_bitset::extract(std::span<T> dest) const {
+    // the kernels write 32 bit positions, any other type goes through the scalar loop
+    if constexpr (std::is_same_v<std::make_unsigned_t<T>, std::uint32_t>) {
+        assert(_size <= std::numeric_limits<std::uint32_t>::max());
+        assert(dest.size() >= count());
+        return instructions::extract<alignment>(_bits.data(), _first, _last, reinterpret_cast<std::uint32_t*>(dest.data()));
+    } else {
+        size_type size = 0;
+        for_each_set_bit([&](const size_type pos) { assert(size < dest.size()); dest[size++] = static_cast<T>(pos); });
+        return size;
+    }
 }
 
 inline void custom_bitset::flip() noexcept {
     instructions::flip<alignment>(_bits.data(), _bits.size());
-    _bits.back() &= below_mask(get_block_bit(_size));
+    clear_padding();
+    fit_window();
 }
 
 inline custom_bitset::size_type custom_bitset::count() const noexcept {
-    return instructions::popcount<alignment>(_bits.data(), _bits.size());
+    return instructions::popcount<alignment>(_bits.data(), _first, _last);
 }
 
 inline custom_bitset::size_type custom_bitset::count(const reference& end) const noexcept {
@@ -1473,7 +1810,7 @@ inline custom_bitset::size_type custom_bitset::count(const reference& end) const
 
     std::size_t sum = 0;
 
-    sum += instructions::popcount<alignment>(_bits.data(), 0, end.block);
+    sum += instructions::popcount<alignment>(_bits.data(), std::min(_first, end.block), std::min(_last, end.block));
     sum += std::popcount(_bits[end.block] & below_mask(end.bit));
 
     return sum;
@@ -1496,7 +1833,7 @@ inline custom_bitset::size_type custom_bitset::count(const reference& start, con
     std::size_t sum = 0;
 
     sum += std::popcount(_bits[start.block] & from_mask(start.bit));
-    sum += instructions::popcount<alignment>(_bits.data(), start.block+1, end.block);
+    sum += instructions::popcount<alignment>(_bits.data(), std::max(start.block+1, _first), std::min(end.block, _last));
     sum += std::popcount(_bits[end.block] & below_mask(end.bit));
 
     return sum;
@@ -1509,21 +1846,46 @@ inline custom_bitset::size_type custom_bitset::count(const size_type start_pos,
 inline void custom_bitset::swap(custom_bitset &other) noexcept {
     std::swap(_size, other._size);
     _bits.swap(other._bits);
+    std::swap(_first, other._first);
+    std::swap(_last, other._last);
 }
 
 inline void custom_bitset::resize(const size_type new_size) {
     if (_size == new_size) return;
     _size = new_size;
     _bits.resize(blocks_needed(_size));
-    if (get_block_bit(_size)) _bits[get_last_block(_size)] &= below_mask(get_block_bit(_size));
+    clear_padding();
+    _last = std::min(_last, _bits.size());
+    trim_window();
+}
+
+// sets every bit in [0, ref), the others are left untouched
+inline void custom_bitset::set_before(const reference& ref) {
+    assert(ref <= _size);
+    [[assume(ref <= _size)]];
+
+    if (ref == 0) return;
+
+    instructions::memset<alignment>(_bits.data(), std::numeric_limits<block_type>::max(), 0, ref.block);
+    if (ref.bit) _bits[ref.block] |= below_mask(ref.bit);
+
+    widen_window(0);
+    widen_window(ref.block - (ref.bit == 0));
+}
+
+inline void custom_bitset::set_before(const size_type pos) {
+    set_before(reference(pos));
 }
 
 inline void custom_bitset::clear_before(const reference& ref) {
     assert(ref < _size);
     [[assume(ref < _size)]];
 
-    instructions::memset<alignment>(_bits.data(), 0, ref.block);
+    instructions::memset<alignment>(_bits.data(), 0, _first, std::min(ref.block, _last));
     _bits[ref.block] &= from_mask(ref.bit);
+
+    _first = std::max(_first, ref.block);
+    if (_first >= _last) _first = _last = 0;
 }
 
 inline void custom_bitset::clear_before(const size_type pos) {
@@ -1551,7 +1913,10 @@ inline void custom_bitset::clear_from(const reference& ref) {
     [[assume(ref < _size)]];
 
     _bits[ref.block] &= below_mask(ref.bit);
-    instructions::memset<alignment>(_bits.data(), 0, ref.block+1, _bits.size());
+    instructions::memset<alignment>(_bits.data(), 0, std::max(ref.block+1, _first), _last);
+
+    _last = std::min(_last, ref.block+1);
+    if (_first >= _last) _first = _last = 0;
 }
 
 inline void custom_bitset::clear_from(const size_type pos) {
@@ -1570,7 +1935,7 @@ inline bool custom_bitset::all() const noexcept {
 inline bool custom_bitset::any() const noexcept {
     const auto a = std::assume_aligned<alignment>(_bits.data());
 
-    for (size_type i = 0; i < _bits.size(); i++)
+    for (size_type i = _first; i < _last; i++)
         if (a[i]) return true;
 
     return false;
@@ -1579,7 +1944,7 @@ inline bool custom_bitset::any() const noexcept {
 inline bool custom_bitset::none() const noexcept {
     const auto a = std::assume_aligned<alignment>(_bits.data());
 
-    for (size_type i = 0; i < _bits.size(); i++)
+    for (size_type i = _first; i < _last; i++)
         if (a[i]) return false;
 
     return true;
@@ -1592,7 +1957,8 @@ inline bool custom_bitset::intersects(const custom_bitset &other) const {
     const auto a = std::assume_aligned<alignment>(_bits.data());
     const auto b = std::assume_aligned<alignment>(other._bits.data());
 
-    for (size_type i = 0; i < _bits.size(); i++)
+    const auto last = std::min(_last, other._last);
+    for (size_type i = std::max(_first, other._first); i < last; i++)
         if (a[i] & b[i]) return true;
 
     return false;
@@ -1605,7 +1971,7 @@ inline bool custom_bitset::is_subset_of(const custom_bitset &other) const {
     const auto a = std::assume_aligned<alignment>(_bits.data());
     const auto b = std::assume_aligned<alignment>(other._bits.data());
 
-    for (size_type i = 0; i < _bits.size(); i++)
+    for (size_type i = _first; i < _last; i++)
         if (a[i] & ~b[i]) return false;
 
     return true;
@@ -1618,7 +1984,7 @@ inline bool custom_bitset::is_superset_of(const custom_bitset &other) const {
     const auto a = std::assume_aligned<alignment>(_bits.data());
     const auto b = std::assume_aligned<alignment>(other._bits.data());
 
-    for (size_type i = 0; i < _bits.size(); i++)
+    for (size_type i = other._first; i < other._last; i++)
         if (b[i] & ~a[i]) return false;
 
     return true;
@@ -1632,7 +1998,7 @@ inline custom_bitset::reference custom_bitset::front_difference(const custom_bit
     const auto a = std::assume_aligned<alignment>(_bits.data());
     const auto b = std::assume_aligned<alignment>(other._bits.data());
 
-    for (size_type i = 0; i < _bits.size(); i++) {
+    for (size_type i = _first; i < _last; i++) {
         if (a[i] & ~b[i]) {
             auto bit = instructions::bit_scan_forward(a[i] & ~b[i]);
             return {i, bit};
@@ -1646,15 +2012,8 @@ inline custom_bitset::size_type custom_bitset::and_count(const custom_bitset &ot
     assert(size() == other.size());
     [[assume(size() == other.size())]];
 
-    const auto a = std::assume_aligned<alignment>(_bits.data());
-    const auto b = std::assume_aligned<alignment>(other._bits.data());
-
-    size_type sum = 0;
-
-    for (size_type i = 0; i < _bits.size(); i++)
-        sum += instructions::popcount(a[i] & b[i]);
-
-    return sum;
+    return instructions::and_count<alignment>(_bits.data(), other._bits.data(),
+        std::max(_first, other._first), std::min(_last, other._last));
 }
 
 // Needed to allow std::views::reverse and std::ranges::reverse_view compatibility
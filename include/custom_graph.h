@@ -10,21 +10,56 @@
 #include <numeric>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <queue>
+#include <span>
+#include <stdexcept>
 
+#include "block_buffer.h"
+#include "csr_graph.h"
 #include "custom_bitset.h"
+#include "huge_pages.h"
 #include "threadsafe_queue.h"
 #include "thread_pool.h"
 
+// adjacency matrix in a single row-major slab: every row starts on a cache line and rows are
+// _stride blocks apart, the slab gets 2 MB pages when huge_pages is enabled. _graph holds the custom_bitset views over the rows, so get_neighbor_set
+// still hands out a const custom_bitset&
 class custom_graph {
     typedef custom_bitset::size_type size_type;
+    typedef custom_bitset::block_type block_type;
 
+    static constexpr size_type slab_alignment = 64; // bytes, a cache line
+    // change_order relabels rows in blocks of change_order_block per thread, one thread per change_order_min_rows rows
+    static constexpr size_type change_order_block = 64;
+    static constexpr size_type change_order_min_rows = 4096;
+
+    // owner of a borrowed slab (a mapped snapshot), null when the slab is owned. first, so it goes last
+    std::shared_ptr<void> _backing;
+    block_buffer<block_type, slab_alignment, huge_page_allocator<block_type, slab_alignment>> _slab;
+    size_type _stride = 0;
     std::vector<custom_bitset> _graph;
+
+    static constexpr size_type row_stride(size_type size) noexcept;
+    void bind_rows(size_type size);
     void community_degeneracy_update(int u, int v, size_t k, const std::vector<unsigned long long>& incremental_count, std::vector<std::atomic<unsigned int>>& delta, thread_pool& pool, std::atomic<size_type>& remaining) const noexcept;
 
 public:
     explicit custom_graph() {};
     explicit custom_graph(size_type size);
+    explicit custom_graph(const csr_graph& S);
+    // undirected edges, 0-based, split in several buffers (one per parser thread): the bits are set straight from
+    // them, self loops are dropped
+    custom_graph(size_type size, std::span<const std::span<const csr_graph::edge_type>> edge_buffers);
+
+    custom_graph(const custom_graph& other);
+    custom_graph(custom_graph&& other) noexcept = default;
+    custom_graph& operator=(const custom_graph& other);
+    custom_graph& operator=(custom_graph&& other) noexcept;
+
+    // rows over a slab kept alive by backing (a snapshot mapped copy-on-write), nothing is copied.
+    // stride must be the one of custom_graph(size), slab aligned to a cache line
+    static custom_graph borrow(custom_bitset::block_type* slab, size_type size, size_type stride, std::shared_ptr<void> backing);
     
     using iterator = std::vector<custom_bitset>::iterator;
     using const_iterator = std::vector<custom_bitset>::const_iterator;
@@ -41,6 +76,9 @@ public:
     void remove_edge(size_type u, size_type v);
 
     [[nodiscard]] inline size_type size() const noexcept { return _graph.size(); }
+    // the whole matrix, row v starts at data() + v*stride()
+    [[nodiscard]] inline const block_type* data() const noexcept { return _slab.data(); }
+    [[nodiscard]] inline size_type stride() const noexcept { return _stride; }
     [[nodiscard]] size_type get_n_edges() const noexcept;
 
     [[nodiscard]] const custom_bitset& get_neighbor_set(size_type v) const;
@@ -61,22 +99,91 @@ public:
     [[nodiscard]] size_type get_degeneracy() const noexcept;
     [[nodiscard]] size_type get_community_degeneracy() const noexcept;
     [[nodiscard]] size_type get_max_degree() const noexcept;
+    // vertices of the k-core, the largest subgraph where every vertex has at least k neighbours
+    [[nodiscard]] custom_bitset get_core(size_type k) const;
 
     [[nodiscard]] static std::vector<size_type> convert_back_set(const std::vector<size_type> &v, const std::vector<size_type> &ordering) ;
     [[nodiscard]] static std::vector<int> convert_back_set(const std::vector<int> &v, const std::vector<size_type> &ordering) ;
     [[nodiscard]] static custom_bitset convert_back_set(const custom_bitset &bb, const std::vector<size_type> &ordering);
     [[nodiscard]] custom_graph get_complement() const;
     void complement();
-    void change_order(const std::vector<size_type>& order);
+    // threads == 0: one per change_order_min_rows rows, up to the cores
+    void change_order(const std::vector<size_type>& order, size_type threads = 0);
     void restore_order(const std::vector<size_type>& order);
     [[nodiscard]] size_type get_subgraph_edges(const custom_bitset &subset) const;
     [[nodiscard]] std::vector<size_type> get_subgraph_vertices_degree(const custom_bitset &subset) const;
 
     void resize(size_type new_size, bool default_value = false);
+
+    // subgraph of S induced by vertices, re-indexed to 0..|vertices|-1 in the first rows, the other rows are emptied.
+    // local_index is a scratch array of S.size() entries, all -1: they are -1 again on return
+    void assign_induced(const csr_graph& S, std::span<const csr_graph::vertex_type> vertices, std::span<int> local_index);
+    // same for the subgraph of G induced by V: vertices are the ones of V in order and local_index[vertices[i]] == i
+    void assign_induced(const custom_graph& G, const custom_bitset& V, std::span<const int> vertices, std::span<const int> local_index, custom_bitset& tmp);
 };
 
 inline custom_graph::custom_graph(const size_type size)
-    : _graph(size, custom_bitset(size)) {
+    : _slab(size*row_stride(size)), _stride(row_stride(size)) {
+    bind_rows(size);
+}
+
+inline custom_graph::custom_graph(const csr_graph& S) : custom_graph(S.size()) {
+    for (size_type v = 0; v < size(); ++v)
+        for (const auto w : S.get_neighbors(v)) _graph[v].set(w);
+}
+
+inline custom_graph::custom_graph(const size_type size, const std::span<const std::span<const csr_graph::edge_type>> edge_buffers) : custom_graph(size) {
+    for (const auto edges : edge_buffers) {
+        for (const auto& [u, v] : edges) {
+            if (u == v) continue;
+            add_edge(u, v);
+        }
+    }
+}
+
+inline custom_graph::custom_graph(const custom_graph& other)
+    : _slab(other._slab), _stride(other._stride) {
+    bind_rows(other.size());
+}
+
+inline custom_graph& custom_graph::operator=(const custom_graph& other) {
+    if (this != &other) *this = custom_graph(other);
+    return *this;
+}
+
+inline custom_graph& custom_graph::operator=(custom_graph&& other) noexcept {
+    if (this == &other) return *this;
+    // a borrowed slab would be written through (see block_buffer): drop it first, then take the other one
+    _slab = {};
+    _slab = std::move(other._slab);
+    _stride = other._stride;
+    _graph = std::move(other._graph);
+    _backing = std::move(other._backing);
+    return *this;
+}
+
+inline custom_graph custom_graph::borrow(custom_bitset::block_type* slab, const size_type size, const size_type stride, std::shared_ptr<void> backing) {
+    if (stride != row_stride(size)) throw std::runtime_error("custom_graph::borrow: wrong row stride");
+
+    custom_graph G;
+    G._slab = decltype(_slab)::borrow(slab, size*stride);
+    G._stride = stride;
+    G._backing = std::move(backing);
+    G.bind_rows(size);
+    return G;
+}
+
+// blocks of a row, rounded up to a whole number of cache lines
+inline constexpr custom_graph::size_type custom_graph::row_stride(const size_type size) noexcept {
+    constexpr size_type line_blocks = slab_alignment / sizeof(block_type);
+    return (custom_bitset::blocks_needed(size) + line_blocks-1) / line_blocks * line_blocks;
+}
+
+// the views fit their window to the slab content, so it works for a copied slab too
+inline void custom_graph::bind_rows(const size_type size) {
+    _graph.clear();
+    _graph.reserve(size);
+    for (size_type v = 0; v < size; ++v) _graph.push_back(custom_bitset(_slab.data() + v*_stride, size));
 }
 
 /*
@@ -220,46 +327,79 @@ inline float custom_graph::get_density() const noexcept {
 }
 
 // Is the same as the k-core
+// Batagelj-Zaversnik bucket queue, as csr_graph::degeneracy_ordering: the degeneracy is the largest degree
+// a vertex has when it is the minimum one and gets removed
 inline custom_graph::size_type custom_graph::get_degeneracy() const noexcept {
-    std::vector<std::size_t> vertices(size());
-    std::vector<std::size_t> degrees(size());
-    custom_bitset is_node_processed(size());
-    std::iota(vertices.begin(), vertices.end(), 0);
-
-    std::size_t max = 0;
-
-    for (std::size_t i = 0; i < size(); i++) {
-        degrees[i] = _graph[i].count();
+    const auto n = size();
+    const auto max_degree = get_max_degree();
+
+    std::vector<size_type> degrees(n), bin(max_degree+2, 0), position(n), vertices(n);
+    for (size_type v = 0; v < n; ++v) ++bin[(degrees[v] = _graph[v].count()) + 1];
+    std::partial_sum(bin.begin(), bin.end(), bin.begin());
+    for (size_type v = 0; v < n; ++v) {
+        position[v] = bin[degrees[v]]++;
+        vertices[position[v]] = v;
     }
+    // bin[d] back to the first vertex of degree d
+    for (size_type d = max_degree+1; d > 0; --d) bin[d] = bin[d-1];
+    bin[0] = 0;
 
-    std::vector<std::size_t> degrees_orig = degrees;
-
-    custom_bitset neighbors_min(size());
-
-    for (std::ptrdiff_t i = _graph.size()-1; i > 0; i--) {
-        auto min_idx = 0;
-        for (int j = 1; j <= i; j++) {
-            const auto node = vertices[j];
-            const auto v_min = vertices[min_idx];
-
-            if (degrees[node] < degrees[v_min]) min_idx = j;
+    size_type max = 0;
+    custom_bitset is_node_processed(n);
+    custom_bitset neighbors(n);
+
+    for (size_type i = 0; i < n; ++i) {
+        const auto v = vertices[i];
+        max = std::max(max, degrees[v]);
+
+        // the processed neighbours are in lower buckets already, skip them in bulk
+        is_node_processed.set(v);
+        custom_bitset::DIFF(neighbors, _graph[v], is_node_processed);
+        for (const auto w : neighbors) {
+            if (degrees[w] <= degrees[v]) continue;
+
+            // swap w with the first vertex of its bucket, then shrink the bucket
+            const auto first = bin[degrees[w]];
+            const auto u = vertices[first];
+            if (u != w) {
+                std::swap(vertices[first], vertices[position[w]]);
+                position[u] = position[w];
+                position[w] = first;
+            }
+            ++bin[degrees[w]];
+            --degrees[w];
         }
+    }
 
-        const auto min = vertices[min_idx];
+    return max;
+}
 
-        max = std::max(max, degrees[min]);
+// peeling: every vertex with less than k neighbours left goes, its neighbours lose one
+inline custom_bitset custom_graph::get_core(const size_type k) const {
+    custom_bitset core(size());
+    core.set_before(size());
 
-        is_node_processed.set(min);
-        custom_bitset::DIFF(neighbors_min, _graph[min], is_node_processed);
-        for (auto v : neighbors_min) {
-            // update neigh_degree (we are going to remove v_min)
-            degrees[v]--;
+    std::vector<size_type> degrees(size());
+    std::vector<size_type> removed;
+    for (size_type v = 0; v < size(); ++v) {
+        degrees[v] = _graph[v].count();
+        if (degrees[v] < k) {
+            core.reset(v);
+            removed.push_back(v);
         }
+    }
 
-        std::swap(vertices[min_idx], vertices[i]);
+    // removed grows while we scan it, every vertex enters it once
+    for (size_type i = 0; i < removed.size(); ++i) {
+        for (const auto w : _graph[removed[i]]) {
+            if (core.test(w) && --degrees[w] < k) {
+                core.reset(w);
+                removed.push_back(w);
+            }
+        }
     }
 
-    return max;
+    return core;
 }
 
 // https://arxiv.org/pdf/1806.05523v2
@@ -432,12 +572,12 @@ inline void custom_graph::complement() {
     }
 }
 
-inline void custom_graph::change_order(const std::vector<size_type> &order) {
-    constexpr size_type invalid = std::numeric_limits<size_type>::max();
-
-    custom_bitset temp(size());
-    custom_bitset temp2(size());
-    std::vector<bool> visited(size());
+// two passes, so the extra memory is one row per thread instead of a second matrix:
+// - every row is decoded word by word and rewritten in place with its columns relabelled. a row only reads
+//   and writes itself, so threads take disjoint blocks of rows and need no synchronization
+// - rows go to their new position following the cycles of the permutation, a copy of the row window each
+inline void custom_graph::change_order(const std::vector<size_type> &order, size_type threads) {
+    assert(order.size() == size());
 
     // Maps original vertex -> new position
     std::vector<size_type> old_to_new(size());
@@ -445,45 +585,44 @@ inline void custom_graph::change_order(const std::vector<size_type> &order) {
         old_to_new[order[i]] = i;
     }
 
-    size_type temp_pos = invalid;
-
-    for (size_type i = 0; i < size(); ++i) {
-        while (temp_pos != invalid) {
-            const size_type orig_pos = temp_pos;
-
-            if (visited[orig_pos]) {
-                temp_pos = invalid;
-                break;
+    const auto relabel_rows = [this, &old_to_new](std::atomic<size_type>& next_block) {
+        custom_bitset row(size());
+        size_type first;
+        while ((first = next_block.fetch_add(change_order_block, std::memory_order_relaxed)) < size()) {
+            for (size_type v = first; v < std::min(first + change_order_block, size()); ++v) {
+                row.reset();
+                _graph[v].for_each_set_bit([&](const size_type w) { row.set(old_to_new[w]); });
+                _graph[v].copy_same_size(row);
             }
-
-            visited[orig_pos] = true;
-            const size_type new_pos = old_to_new[orig_pos];
-
-            temp2.swap(temp);
-            temp.swap(_graph[new_pos]);
-            _graph[new_pos].reset();
-
-            for (auto v : temp2) _graph[new_pos].set(old_to_new[v]);
-            if (new_pos != orig_pos) temp_pos = new_pos;
-            else temp_pos = invalid;
         }
+    };
 
-        const size_type orig_pos = i;
-        if (visited[orig_pos]) continue;
-
-        visited[orig_pos] = true;
-        const size_type new_pos = old_to_new[orig_pos];
+    std::atomic<size_type> next_block{0};
+    if (threads == 0) threads = std::min<size_type>(std::thread::hardware_concurrency(), size() / change_order_min_rows);
+    if (threads > 1) {
+        thread_pool pool(threads);
+        for (size_type i = 0; i < threads; ++i) pool.submit([&relabel_rows, &next_block] { relabel_rows(next_block); });
+        pool.wait_until_idle();
+    } else {
+        relabel_rows(next_block);
+    }
 
-        temp.swap(_graph[new_pos]);
-        _graph[new_pos].reset();
+    // new row i is old row order[i]: walk every cycle once, its first row waits in temp
+    custom_bitset temp(size());
+    std::vector<bool> visited(size());
 
-        if (new_pos != orig_pos) {
-            for (auto v : _graph[orig_pos]) _graph[new_pos].set(old_to_new[v]);
-            temp_pos = new_pos;
-        } else {
-            for (auto v : temp) _graph[new_pos].set(old_to_new[v]);
-            temp_pos = invalid;
+    for (size_type i = 0; i < size(); ++i) {
+        if (visited[i]) continue;
+        visited[i] = true;
+        if (order[i] == i) continue;
+
+        temp.copy_same_size(_graph[i]);
+        size_type pos = i;
+        for (auto src = order[pos]; src != i; pos = src, src = order[pos]) {
+            _graph[pos].copy_same_size(_graph[src]);
+            visited[src] = true;
         }
+        _graph[pos].copy_same_size(temp);
     }
 }
 
@@ -510,30 +649,52 @@ inline std::vector<custom_graph::size_type> custom_graph::get_subgraph_vertices_
 inline void custom_graph::resize(const size_type new_size, const bool default_value) {
     if (size() == new_size) return;
 
-    if (new_size > size()) {
-        // resize each bitset already in the graph
-        for (auto& bitset : _graph) {
-            bitset.resize(new_size);
+    const auto old_size = size();
+    custom_graph resized(new_size);
+
+    // old rows keep their bits below new_size, the new columns are zero
+    const auto blocks = std::min(custom_bitset::blocks_needed(old_size), custom_bitset::blocks_needed(new_size));
+    for (size_type v = 0; v < std::min(old_size, new_size); ++v) {
+        auto& row = resized._graph[v];
+        std::copy_n(_slab.data() + v*_stride, blocks, row._bits.data());
+        if (new_size < old_size && custom_bitset::get_block_bit(new_size)) row._bits.back() &= custom_bitset::below_mask(custom_bitset::get_block_bit(new_size));
+        row.fit_window();
+    }
+
+    if (default_value) {
+        for (size_type v = old_size; v < new_size; v++) {
+            auto& row = resized._graph[v];
+            row.set();
+            if (custom_bitset::get_block_bit(new_size)) row._bits.back() &= custom_bitset::below_mask(custom_bitset::get_block_bit(new_size));
+            row.reset(v);
         }
+    }
 
-        // add new bitsets if the new size is larger than the current size
-        const custom_bitset default_bitset(new_size, default_value);
+    *this = std::move(resized);
+}
 
-        auto old_size = size();
+inline void custom_graph::assign_induced(const csr_graph& S, const std::span<const csr_graph::vertex_type> vertices, const std::span<int> local_index) {
+    assert(vertices.size() <= size());
 
-        _graph.resize(new_size, default_bitset);
+    for (auto& row : _graph) row.reset();
+    for (size_type i = 0; i < vertices.size(); ++i) local_index[vertices[i]] = static_cast<int>(i);
 
-        if (default_value) {
-            for (int i = old_size; i < new_size; i++) {
-                _graph[i].reset(i);
-            }
+    // every edge is seen once, from its later endpoint
+    for (size_type i = 0; i < vertices.size(); ++i) {
+        for (const auto w : S.get_prev_neighbors(vertices[i])) {
+            if (const auto j = local_index[w]; j >= 0) add_edge(i, j);
         }
-    } else {
-        _graph.resize(new_size);
+    }
 
-        // resize each bitset in the graph
-        for (auto& bitset : _graph) {
-            bitset.resize(new_size);
-        }
+    for (const auto v : vertices) local_index[v] = -1;
+}
+
+inline void custom_graph::assign_induced(const custom_graph& G, const custom_bitset& V, const std::span<const int> vertices, const std::span<const int> local_index, custom_bitset& tmp) {
+    assert(vertices.size() <= size());
+
+    for (auto& row : _graph) row.reset();
+    for (size_type i = 0; i < vertices.size(); ++i) {
+        custom_bitset::AND(tmp, G.get_neighbor_set(vertices[i]), V);
+        tmp.for_each_set_bit([&](const auto w) { _graph[i].set(local_index[w]); });
     }
 }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+
+#if defined(CLISAT_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+// gzip members start with 1f 8b
+[[nodiscard]] inline bool is_gzip(const std::string_view data) noexcept {
+    return data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+#if defined(CLISAT_HAVE_ZLIB)
+namespace gzip_detail {
+    // zlib keeps a pointer to the stream: it never moves, the readers share it
+    class inflater {
+        static constexpr std::size_t window = std::size_t{1} << 20;
+
+        z_stream _stream{};
+        byte_reader _compressed;
+        std::vector<char> _input = std::vector<char>(window);
+        bool _done = false;
+
+        // false at the end of the compressed input
+        bool refill() {
+            const auto bytes = _compressed(_input.data(), _input.size());
+            _stream.next_in = reinterpret_cast<Bytef*>(_input.data());
+            _stream.avail_in = static_cast<uInt>(bytes);
+            return bytes > 0;
+        }
+
+    public:
+        explicit inflater(byte_reader compressed) : _compressed(std::move(compressed)) {
+            if (inflateInit2(&_stream, 15 + 16) != Z_OK) throw std::runtime_error("gunzip: cannot initialise zlib");
+        }
+        ~inflater() { inflateEnd(&_stream); }
+
+        inflater(const inflater&) = delete;
+        inflater& operator=(const inflater&) = delete;
+
+        // all the members one after the other, as gzip -d
+        std::size_t read(char* dst, const std::size_t max) {
+            if (_done) return 0;
+
+            _stream.next_out = reinterpret_cast<Bytef*>(dst);
+            _stream.avail_out = static_cast<uInt>(std::min<std::size_t>(max, std::numeric_limits<uInt>::max()));
+            const auto wanted = _stream.avail_out;
+
+            while (_stream.avail_out > 0) {
+                if (_stream.avail_in == 0 && !refill()) throw std::runtime_error("gunzip: truncated data");
+
+                const auto ret = inflate(&_stream, Z_NO_FLUSH);
+                if (ret == Z_STREAM_END) {
+                    // another member may follow
+                    if (_stream.avail_in == 0 && !refill()) {
+                        _done = true;
+                        break;
+                    }
+                    if (inflateReset(&_stream) != Z_OK) throw std::runtime_error("gunzip: corrupted data");
+                } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                    throw std::runtime_error("gunzip: corrupted data");
+                }
+            }
+
+            return wanted - _stream.avail_out;
+        }
+    };
+}
+#endif
+
+// the content of gzip compressed bytes, inflated as they are read: the input goes to zlib a window at a time
+inline byte_reader gunzip_reader(byte_reader compressed) {
+#if defined(CLISAT_HAVE_ZLIB)
+    auto stream = std::make_shared<gzip_detail::inflater>(std::move(compressed));
+    return [stream](char* dst, const std::size_t max) { return stream->read(dst, max); };
+#else
+    (void) compressed;
+    throw std::runtime_error("gunzip: CliSAT was built without zlib, decompress the graph first");
+#endif
+}
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <cassert>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "custom_bitset.h"
+#include "instructions.h"
+
+// custom_bitset with a second level: bit j of _summary[i] is set iff block i*64+j is nonzero.
+// front/next/back/prev jump straight to the next nonzero block, instead of scanning zero blocks,
+// so the cost depends on the number of elements and not on the size of the set.
+// the flat bitset is always up to date, so it can be passed wherever a const custom_bitset& is expected
+class hierarchical_bitset {
+public:
+    typedef custom_bitset::block_type block_type;
+    typedef custom_bitset::bit_type bit_type;
+    typedef custom_bitset::size_type size_type;
+    typedef custom_bitset::reference reference;
+
+    static constexpr reference npos = custom_bitset::npos;
+
+    class const_iterator {
+        const hierarchical_bitset* bs;
+        reference ref;
+
+    public:
+        using value_type = reference;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using iterator_concept  = std::bidirectional_iterator_tag;
+
+        explicit const_iterator() : bs(nullptr), ref(0, 0) {}
+        const_iterator(const hierarchical_bitset* bitset, const size_type pos) : bs(bitset), ref(pos) {}
+        const_iterator(const hierarchical_bitset* bitset, const reference& ref) : bs(bitset), ref(ref) {}
+
+        reference operator*() const { return ref; }
+
+        operator bool() const { return bs->test(ref); }
+
+        const_iterator& operator++() { ref = bs->next(ref); return *this; }
+        const_iterator operator++(int) { const auto tmp = *this; ++(*this); return tmp; }
+
+        const_iterator& operator--() { ref = bs->prev(ref); return *this; }
+        const_iterator operator--(int) { const auto tmp = *this; --(*this); return tmp; }
+
+        bool operator==(const const_iterator& other) const { return bs == other.bs && ref == other.ref; }
+    };
+
+    [[nodiscard]] const_iterator begin() const { return {this, front()}; }
+    [[nodiscard]] const_iterator end() const { return {this, npos}; }
+
+private:
+    static constexpr size_type block_size = custom_bitset::block_size;
+    static constexpr size_type block_size_log2 = custom_bitset::block_size_log2;
+
+    custom_bitset _bits;
+    std::vector<block_type> _summary;
+
+    static constexpr size_type get_word(const size_type block) noexcept { return block >> block_size_log2; }
+    static constexpr bit_type get_word_bit(const size_type block) noexcept { return block & (block_size-1); }
+
+    void update_summary(size_type block) noexcept;
+    void rebuild_summary() noexcept;
+
+    [[nodiscard]] reference first_from(size_type block) const noexcept;
+    [[nodiscard]] reference last_before(size_type block) const noexcept;
+
+    template <typename Op>
+    static void apply(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, Op op);
+
+public:
+    hierarchical_bitset() : hierarchical_bitset(0) {}
+    explicit hierarchical_bitset(size_type size, bool default_value = false);
+    explicit hierarchical_bitset(const custom_bitset& bits);
+
+    hierarchical_bitset& operator=(const custom_bitset& other);
+    hierarchical_bitset& copy_same_size(const custom_bitset& other);
+
+    operator const custom_bitset&() const noexcept { return _bits; }
+    [[nodiscard]] const custom_bitset& flat() const noexcept { return _bits; }
+
+    hierarchical_bitset& operator&=(const custom_bitset& other);
+    hierarchical_bitset& operator|=(const custom_bitset& other);
+    hierarchical_bitset& operator^=(const custom_bitset& other);
+    hierarchical_bitset& operator-=(const custom_bitset& other);
+
+    static void AND(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static void OR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static void XOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static void NAND(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static void NOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static void NOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, size_type end_pos);
+    static void NXOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+    static void DIFF(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2);
+
+    bool operator[](const reference& ref) const { return test(ref); };
+    bool operator[](const size_type pos) const { return test(pos); };
+
+    void set(const reference& ref);
+    void set(const size_type pos) { set(reference(pos)); }
+    void set(const reference& ref, bool value);
+    void set(const size_type pos, const bool value) { set(reference(pos), value); }
+    void reset(const reference& ref);
+    void reset(const size_type pos) { reset(reference(pos)); }
+    void flip(const reference& ref);
+    void flip(const size_type pos) { flip(reference(pos)); }
+    [[nodiscard]] bool test(const reference& ref) const { return _bits.test(ref); }
+    [[nodiscard]] bool test(const size_type pos) const { return _bits.test(pos); }
+
+    [[nodiscard]] reference front() const noexcept { return first_from(0); }
+    [[nodiscard]] reference next(const reference& ref) const;
+    [[nodiscard]] reference next(const size_type pos) const { return next(reference(pos)); }
+    [[nodiscard]] reference back() const noexcept { return last_before(_bits._bits.size()); }
+    [[nodiscard]] reference prev(const reference& ref) const;
+    [[nodiscard]] reference prev(const size_type pos) const { return prev(reference(pos)); }
+
+    // same as custom_bitset, but only the nonzero blocks are visited
+    template <typename Fn>
+    void for_each_set_bit(Fn&& fn) const;
+    template <Integer T>
+    size_type extract(std::span<T> dest) const;
+
+    void flip() noexcept;
+    void set() noexcept;
+    void reset() noexcept;
+    void set_before(size_type pos);
+
+    [[nodiscard]] size_type size() const noexcept { return _bits.size(); }
+    [[nodiscard]] size_type count() const noexcept { return _bits.count(); }
+
+    [[nodiscard]] bool any() const noexcept;
+    [[nodiscard]] bool none() const noexcept { return !any(); }
+    [[nodiscard]] reference front_difference(const custom_bitset& other) const;
+};
+
+inline hierarchical_bitset::hierarchical_bitset(const size_type size, const bool default_value) :
+    _bits(size, default_value),
+    _summary(get_word(_bits._bits.size() + block_size-1))
+{
+    if (default_value) rebuild_summary();
+}
+
+inline hierarchical_bitset::hierarchical_bitset(const custom_bitset& bits) :
+    _bits(bits),
+    _summary(get_word(_bits._bits.size() + block_size-1))
+{
+    rebuild_summary();
+}
+
+// called after writing a single block
+inline void hierarchical_bitset::update_summary(const size_type block) noexcept {
+    const auto mask = block_type{1} << get_word_bit(block);
+
+    if (_bits._bits[block]) _summary[get_word(block)] |= mask;
+    else _summary[get_word(block)] &= ~mask;
+}
+
+// only the window of the flat bitset can hold nonzero blocks
+inline void hierarchical_bitset::rebuild_summary() noexcept {
+    std::ranges::fill(_summary, 0);
+
+    for (auto block = _bits._first; block < _bits._last; ++block)
+        _summary[get_word(block)] |= block_type{_bits._bits[block] != 0} << get_word_bit(block);
+}
+
+// first element in a block >= block
+inline hierarchical_bitset::reference hierarchical_bitset::first_from(const size_type block) const noexcept {
+    auto word = get_word(block);
+    const auto last_word = get_word(_bits._last + block_size-1);
+    if (word >= last_word) return npos;
+
+    auto summary = _summary[word] & custom_bitset::from_mask(get_word_bit(block));
+    while (summary == 0) {
+        if (++word == last_word) return npos;
+        summary = _summary[word];
+    }
+
+    const auto found = word*block_size + instructions::bit_scan_forward(summary);
+    return {found, instructions::bit_scan_forward(_bits._bits[found])};
+}
+
+// last element in a block < block
+inline hierarchical_bitset::reference hierarchical_bitset::last_before(size_type block) const noexcept {
+    block = std::min(block, _bits._last);
+    if (block-- <= _bits._first) return npos;
+
+    auto word = get_word(block);
+    auto summary = _summary[word] & custom_bitset::until_mask(get_word_bit(block));
+    while (summary == 0) {
+        if (word-- == 0) return npos;
+        summary = _summary[word];
+    }
+
+    const auto found = word*block_size + instructions::bit_scan_reverse(summary);
+    return {found, instructions::bit_scan_reverse(_bits._bits[found])};
+}
+
+template <typename Fn>
+void hierarchical_bitset::for_each_set_bit(Fn&& fn) const {
+    const auto last_word = get_word(_bits._last + block_size-1);
+
+    for (auto word = get_word(_bits._first); word < last_word; ++word) {
+        for (auto summary = _summary[word]; summary != 0; summary &= summary - 1) {
+            const auto block = word*block_size + instructions::bit_scan_forward(summary);
+            for (auto bits = _bits._bits[block]; bits != 0; bits &= bits - 1) {
+                const size_type pos = (block << block_size_log2) + instructions::bit_scan_forward(bits);
+                if constexpr (std::is_same_v<std::invoke_result_t<Fn&, size_type>, bool>) {
+                    if (!fn(pos)) return;
+                } else {
+                    fn(pos);
+                }
+            }
+        }
+    }
+}
+
+template <Integer T>
+hierarchical_bitset::size_type hierarchical_bitset::extract(std::span<T> dest) const {
+    size_type size = 0;
+    for_each_set_bit([&](const size_type pos) { assert(size < dest.size()); dest[size++] = static_cast<T>(pos); });
+    return size;
+}
+
+inline hierarchical_bitset& hierarchical_bitset::operator=(const custom_bitset& other) {
+    _bits = other;
+    _summary.resize(get_word(_bits._bits.size() + block_size-1));
+    rebuild_summary();
+
+    return *this;
+}
+
+inline hierarchical_bitset& hierarchical_bitset::copy_same_size(const custom_bitset& other) {
+    _bits.copy_same_size(other);
+    rebuild_summary();
+
+    return *this;
+}
+
+inline hierarchical_bitset& hierarchical_bitset::operator&=(const custom_bitset& other) {
+    _bits &= other;
+    rebuild_summary();
+
+    return *this;
+}
+
+inline hierarchical_bitset& hierarchical_bitset::operator|=(const custom_bitset& other) {
+    _bits |= other;
+    rebuild_summary();
+
+    return *this;
+}
+
+inline hierarchical_bitset& hierarchical_bitset::operator^=(const custom_bitset& other) {
+    _bits ^= other;
+    rebuild_summary();
+
+    return *this;
+}
+
+inline hierarchical_bitset& hierarchical_bitset::operator-=(const custom_bitset& other) {
+    _bits -= other;
+    rebuild_summary();
+
+    return *this;
+}
+
+template <typename Op>
+void hierarchical_bitset::apply(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, Op op) {
+    op(dest._bits, src1, src2);
+    dest.rebuild_summary();
+}
+
+inline void hierarchical_bitset::AND(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::AND(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::OR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::OR(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::XOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::XOR(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::NAND(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::NAND(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::NOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::NOR(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::NOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2, const size_type end_pos) {
+    apply(dest, src1, src2, [end_pos](auto& d, const auto& s1, const auto& s2) { custom_bitset::NOR(d, s1, s2, end_pos); });
+}
+
+inline void hierarchical_bitset::NXOR(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::NXOR(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::DIFF(hierarchical_bitset& dest, const custom_bitset& src1, const custom_bitset& src2) {
+    apply(dest, src1, src2, [](auto& d, const auto& s1, const auto& s2) { custom_bitset::DIFF(d, s1, s2); });
+}
+
+inline void hierarchical_bitset::set(const reference& ref) {
+    _bits.set(ref);
+    _summary[get_word(ref.block)] |= block_type{1} << get_word_bit(ref.block);
+}
+
+inline void hierarchical_bitset::set(const reference& ref, const bool value) {
+    if (value) set(ref);
+    else reset(ref);
+}
+
+inline void hierarchical_bitset::reset(const reference& ref) {
+    _bits.reset(ref);
+    update_summary(ref.block);
+}
+
+inline void hierarchical_bitset::flip(const reference& ref) {
+    _bits.flip(ref);
+    update_summary(ref.block);
+}
+
+inline hierarchical_bitset::reference hierarchical_bitset::next(const reference& pos) const {
+    assert(pos < size());
+    [[assume(pos < size())]];
+
+    auto ref = pos;
+
+    const auto masked_number = _bits._bits[ref.block] & custom_bitset::after_mask(ref.bit);
+    if (masked_number != 0) {
+        ref.bit = instructions::bit_scan_forward(masked_number);
+        return ref;
+    }
+
+    return first_from(ref.block+1);
+}
+
+inline hierarchical_bitset::reference hierarchical_bitset::prev(const reference& pos) const {
+    assert(pos < size());
+    [[assume(pos < size())]];
+
+    auto ref = pos;
+
+    const auto masked_number = _bits._bits[ref.block] & custom_bitset::below_mask(ref.bit);
+    if (masked_number != 0) {
+        ref.bit = instructions::bit_scan_reverse(masked_number);
+        return ref;
+    }
+
+    return last_before(ref.block);
+}
+
+inline void hierarchical_bitset::flip() noexcept {
+    _bits.flip();
+    rebuild_summary();
+}
+
+inline void hierarchical_bitset::set() noexcept {
+    _bits.set();
+    rebuild_summary();
+}
+
+inline void hierarchical_bitset::set_before(const size_type pos) {
+    _bits.set_before(pos);
+    rebuild_summary();
+}
+
+inline void hierarchical_bitset::reset() noexcept {
+    _bits.reset();
+    std::ranges::fill(_summary, 0);
+}
+
+inline bool hierarchical_bitset::any() const noexcept {
+    return std::ranges::any_of(_summary, [](const auto word) { return word != 0; });
+}
+
+// visits only the nonzero blocks of this
+inline hierarchical_bitset::reference hierarchical_bitset::front_difference(const custom_bitset& other) const {
+    assert(size() == other.size());
+    [[assume(size() == other.size())]];
+
+    for (auto ref = front(); ref != npos; ref = first_from(ref.block+1)) {
+        const auto diff = _bits._bits[ref.block] & ~other._bits[ref.block];
+        if (diff != 0) return {ref.block, instructions::bit_scan_forward(diff)};
+    }
+
+    return npos;
+}
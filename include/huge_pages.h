@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// 2 MB pages for the big, randomly accessed buffers (custom_graph slab, Solver workspaces).
+// when enabled, every allocation of at least page_size is a private anonymous mapping rounded up to page_size:
+// first MAP_HUGETLB (needs pages reserved in /proc/sys/vm/nr_hugepages), otherwise a normal
+// mapping with madvise(MADV_HUGEPAGE), so transparent huge pages back it if the kernel allows.
+// smaller ones (local subproblems, small graphs) would waste most of a page and take the registry lock:
+// like disabled (the default) or other systems, they get plain aligned operator new.
+// the mappings are few and long lived, a registry tells deallocate how each one was obtained
+namespace huge_pages {
+    inline constexpr std::size_t page_size = std::size_t{2} << 20;
+
+    enum class backing { none, hugetlb, transparent };
+
+    namespace detail {
+        struct mapping {
+            std::size_t bytes;
+            backing kind;
+        };
+
+        inline std::atomic_bool enabled = false;
+        inline std::mutex registry_m;
+        inline std::map<std::uintptr_t, mapping> registry; // start address -> mapping
+
+        // requested bytes per backing, reported by report()
+        inline std::atomic_size_t requested = 0;
+        inline std::atomic_size_t hugetlb = 0;
+        inline std::atomic_size_t transparent = 0;
+    }
+
+    // call it before building the graph, buffers already allocated keep their pages
+    inline void enable(const bool value = true) noexcept { detail::enabled = value; }
+    [[nodiscard]] inline bool enabled() noexcept { return detail::enabled; }
+
+    [[nodiscard]] inline void* allocate(const std::size_t bytes, const std::size_t alignment) {
+        if (bytes == 0) return nullptr;
+
+#if defined(__linux__)
+        if (enabled() && alignment <= page_size && bytes >= page_size) {
+            const auto length = (bytes + page_size-1) / page_size * page_size;
+            auto kind = backing::hugetlb;
+
+            void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p == MAP_FAILED) {
+                // over-map by a page, so a 2 MB aligned range of length bytes can be cut out of it
+                kind = backing::transparent;
+                p = mmap(nullptr, length + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED) throw std::bad_alloc();
+
+                const auto start = reinterpret_cast<std::uintptr_t>(p);
+                const auto aligned = (start + page_size-1) / page_size * page_size;
+                if (aligned != start) munmap(p, aligned - start);
+                if (const auto tail = start + length + page_size - (aligned + length)) munmap(reinterpret_cast<void*>(aligned + length), tail);
+                p = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE)
+                madvise(p, length, MADV_HUGEPAGE);
+#endif
+            }
+
+            detail::requested += bytes;
+            (kind == backing::hugetlb ? detail::hugetlb : detail::transparent) += bytes;
+
+            std::lock_guard lg(detail::registry_m);
+            detail::registry.emplace(reinterpret_cast<std::uintptr_t>(p), detail::mapping{length, kind});
+            return p;
+        }
+#endif
+
+        detail::requested += bytes;
+        return ::operator new(bytes, static_cast<std::align_val_t>(alignment));
+    }
+
+    inline void deallocate(void* p, const std::size_t bytes, const std::size_t alignment) noexcept {
+        if (!p) return;
+
+#if defined(__linux__)
+        if (bytes >= page_size) {
+            std::lock_guard lg(detail::registry_m);
+            if (const auto it = detail::registry.find(reinterpret_cast<std::uintptr_t>(p)); it != detail::registry.end()) {
+                detail::requested -= bytes;
+                (it->second.kind == backing::hugetlb ? detail::hugetlb : detail::transparent) -= bytes;
+                munmap(p, it->second.bytes);
+                detail::registry.erase(it);
+                return;
+            }
+        }
+#endif
+
+        detail::requested -= bytes;
+        ::operator delete(p, static_cast<std::align_val_t>(alignment));
+    }
+
+    // bytes of the madvised mappings that the kernel actually backs with transparent huge pages
+    // (AnonHugePages of their areas in /proc/self/smaps). only meaningful once they were touched
+    [[nodiscard]] inline std::size_t transparent_backed() {
+#if defined(__linux__)
+        std::ifstream smaps("/proc/self/smaps");
+        if (!smaps) return 0;
+
+        std::lock_guard lg(detail::registry_m);
+        std::size_t total = 0;
+        bool tracked = false;
+        std::string line;
+        while (std::getline(smaps, line)) {
+            std::uintptr_t start, end;
+            char dash;
+            std::istringstream header(line);
+            if (header >> std::hex >> start >> dash >> end && dash == '-') {
+                // any transparent mapping inside [start, end)?
+                const auto it = detail::registry.lower_bound(start);
+                tracked = false;
+                for (auto m = it; m != detail::registry.end() && m->first < end; ++m)
+                    tracked |= m->second.kind == backing::transparent;
+            } else if (tracked && line.starts_with("AnonHugePages:")) {
+                std::size_t kb = 0;
+                std::istringstream(line.substr(14)) >> kb;
+                total += kb << 10;
+            }
+        }
+
+        return std::min(total, detail::transparent.load());
+#else
+        return 0;
+#endif
+    }
+
+    // one line summary: how much of the huge page allocations actually got 2 MB pages
+    [[nodiscard]] inline std::string report() {
+        constexpr double MB = 1 << 20;
+
+        if (!enabled()) return "huge pages: disabled";
+
+        const auto requested = detail::requested.load();
+        const auto hugetlb = detail::hugetlb.load();
+        const auto transparent = detail::transparent.load();
+        const auto backed = transparent_backed();
+
+        std::ostringstream out;
+        out.precision(3);
+        out << "huge pages: " << requested/MB << " MB requested, " << hugetlb/MB << " MB on hugetlb pages, "
+            << backed/MB << "/" << transparent/MB << " MB on transparent huge pages";
+        if (hugetlb + transparent == 0) out << " (no buffer of a page or more)";
+        else if (hugetlb + backed == 0) out << " (none obtained, small pages fallback)";
+        return out.str();
+    }
+
+    // owning buffer of bytes allocated through allocate(), move only
+    class buffer {
+        void* _data = nullptr;
+        std::size_t _bytes = 0;
+        std::size_t _alignment = alignof(std::max_align_t);
+
+    public:
+        buffer() = default;
+        buffer(const std::size_t bytes, const std::size_t alignment) : _data(allocate(bytes, alignment)), _bytes(bytes), _alignment(alignment) {}
+        buffer(buffer&& other) noexcept
+            : _data(std::exchange(other._data, nullptr)), _bytes(std::exchange(other._bytes, 0)), _alignment(other._alignment) {}
+        buffer& operator=(buffer&& other) noexcept {
+            std::swap(_data, other._data);
+            std::swap(_bytes, other._bytes);
+            std::swap(_alignment, other._alignment);
+            return *this;
+        }
+        ~buffer() { deallocate(_data, _bytes, _alignment); }
+
+        [[nodiscard]] std::byte* data() const noexcept { return static_cast<std::byte*>(_data); }
+        [[nodiscard]] std::size_t size() const noexcept { return _bytes; }
+    };
+}
+
+// same interface of aligned_allocator, through huge_pages::allocate
+template <class T, std::size_t alignment>
+requires (alignment >= alignof(T)) && (std::has_single_bit(alignment))
+class huge_page_allocator {
+public:
+    using value_type                             = T;
+    using size_type                              = std::size_t;
+    using difference_type                        = std::ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal                        = std::true_type; // stateless
+
+    template <class U> struct rebind { using other = huge_page_allocator<U, alignment>; };
+
+    constexpr huge_page_allocator() noexcept = default;
+    template <class U>
+    constexpr explicit huge_page_allocator(const huge_page_allocator<U, alignment>&) noexcept {}
+
+    [[nodiscard]] value_type* allocate(const size_type n) {
+        if (n > max_size()) throw std::bad_array_new_length();
+        return static_cast<value_type*>(huge_pages::allocate(n * sizeof(T), alignment));
+    }
+
+    static void deallocate(value_type* p, const size_type n) noexcept {
+        huge_pages::deallocate(p, n * sizeof(T), alignment);
+    }
+
+    [[nodiscard]] constexpr size_type max_size() const noexcept {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+    template <class U>
+    friend constexpr bool operator==(const huge_page_allocator&, const huge_page_allocator<U, alignment>&) noexcept { return true; }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature, std::size_t capacity>
+class inplace_function;
+
+// a move-only std::function that keeps the callable in its own storage: constructing, moving and destroying it never
+// allocate. callables bigger than capacity don't compile
+template<typename R, typename... Args, std::size_t capacity>
+class inplace_function<R(Args...), capacity> {
+    struct operations {
+        R (*invoke)(void*, Args&&...);
+        void (*relocate)(void* to, void* from) noexcept;    // move to uninitialized storage, destroy the old one
+        void (*destroy)(void*) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr operations operations_of = {
+        [](void* fn, Args&&... args) -> R { return (*static_cast<Fn*>(fn))(std::forward<Args>(args)...); },
+        [](void* to, void* from) noexcept {
+            ::new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        },
+        [](void* fn) noexcept { static_cast<Fn*>(fn)->~Fn(); },
+    };
+
+    alignas(std::max_align_t) std::byte storage[capacity];
+    const operations* ops = nullptr;
+
+public:
+    inplace_function() noexcept = default;
+
+    template<typename F> requires (!std::is_same_v<std::remove_cvref_t<F>, inplace_function> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    inplace_function(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= capacity, "callable too big, raise the capacity");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t));
+        static_assert(std::is_nothrow_move_constructible_v<Fn>);
+
+        ::new (static_cast<void*>(storage)) Fn(std::forward<F>(f));
+        ops = &operations_of<Fn>;
+    }
+
+    inplace_function(inplace_function&& other) noexcept : ops(std::exchange(other.ops, nullptr)) {
+        if (ops) ops->relocate(storage, other.storage);
+    }
+
+    inplace_function& operator=(inplace_function&& other) noexcept {
+        if (this == &other) return *this;
+        reset();
+        ops = std::exchange(other.ops, nullptr);
+        if (ops) ops->relocate(storage, other.storage);
+        return *this;
+    }
+
+    inplace_function(const inplace_function&) = delete;
+    inplace_function& operator=(const inplace_function&) = delete;
+
+    ~inplace_function() {
+        reset();
+    }
+
+    void reset() noexcept {
+        if (ops) std::exchange(ops, nullptr)->destroy(storage);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops != nullptr;
+    }
+
+    R operator()(Args... args) {
+        return ops->invoke(storage, std::forward<Args>(args)...);
+    }
+};
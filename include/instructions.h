@@ -10,8 +10,20 @@
 
 #include <memory>
 #include <cassert>
+#include <cstdint>
 #include <bit>
 
+// the x86 kernels use 64-bit only intrinsics (_mm256_extract_epi64, _mm_popcnt_u64): 32-bit x86 keeps the scalar ones
+// the arm kernels were never run on hardware or under emulation: opt in with CLISAT_ARM_KERNELS (cmake -DARM_KERNELS=ON)
+#if defined(__x86_64__) || defined(_M_X64)
+#include "instructions_x86.h"
+#elif defined(CLISAT_ARM_KERNELS) && (defined(__aarch64__) || defined(_M_ARM64))
+#include "instructions_arm.h"
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
 namespace instructions {
     struct features {
         bool popcnt = false;
@@ -20,6 +32,11 @@ namespace instructions {
         bool avx = false;
         bool avx2 = false;
         bool avx512f = false;
+        bool avx512bw = false;
+        bool avx512vpopcntdq = false;
+        bool avx512vbmi2 = false;
+        bool neon = false;
+        bool sve = false;
     };
 
 #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
@@ -39,6 +56,17 @@ namespace instructions {
 #endif
     }
 
+    // XCR0, tells which register states the os saves on context switch
+    static inline std::uint64_t xgetbv() noexcept {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        std::uint32_t eax, edx;
+        asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+    }
+
     static inline features cpu_supports_impl() {
         features cpu_supports;
         std::uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
@@ -54,21 +82,42 @@ namespace instructions {
         cpu_supports.popcnt = (ecx >> 23) & 1;
         cpu_supports.sse2 = (edx >> 26) & 1;      // SSE2 is bit 26 of EDX, not ECX
         cpu_supports.sse4_1 = (ecx >> 19) & 1;    // SSE4.1 is bit 19 of ECX
-        cpu_supports.avx = (ecx >> 28) & 1;
+
+        // ymm/zmm registers are usable only if the os enabled them (OSXSAVE + XCR0)
+        const bool osxsave = (ecx >> 27) & 1;
+        const std::uint64_t xcr0 = osxsave ? xgetbv() : 0;
+        const bool os_avx = (xcr0 & 0x6) == 0x6;        // xmm, ymm
+        const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;   // xmm, ymm, opmask, zmm
+        cpu_supports.avx = ((ecx >> 28) & 1) && os_avx;
 
         if (max_basic_leaf < 7) return cpu_supports;
 
         cpuid(7, 0, eax, ebx, ecx, edx);
-        cpu_supports.avx2 = (ebx >> 5) & 1;
-        cpu_supports.avx512f = (ebx >> 16) & 1;
+        cpu_supports.avx2 = ((ebx >> 5) & 1) && os_avx;
+        cpu_supports.avx512f = ((ebx >> 16) & 1) && os_avx512;
+        cpu_supports.avx512bw = ((ebx >> 30) & 1) && os_avx512;
+        cpu_supports.avx512vpopcntdq = ((ecx >> 14) & 1) && os_avx512;
+        cpu_supports.avx512vbmi2 = ((ecx >> 6) & 1) && os_avx512;
 
         return cpu_supports;
     }
 
+#elif defined(CLISAT_ARM_KERNELS) && (defined(__aarch64__) || defined(_M_ARM64))
+    static inline features cpu_supports_impl() noexcept {
+        features cpu_supports;
+        // advanced simd is mandatory on AArch64
+        cpu_supports.neon = true;
+#if defined(__linux__) && defined(__ARM_FEATURE_SVE)
+        // HWCAP_SVE, the kernel clears it when sve is disabled
+        cpu_supports.sve = (getauxval(AT_HWCAP) >> 22) & 1;
+#endif
+        return cpu_supports;
+    }
+
 #else
-    // ------------------- Non-x86 (ARM, RISC-V, etc.) Stub -------------------
+    // ------------------- Non-x86/ARM (RISC-V, etc.) Stub -------------------
     static inline features cpu_supports_impl() noexcept {
-        // All features disabled — ARM has none of these x86 SIMD flags
+        // All features disabled, only the scalar kernels are used
         return features{};
     }
 #endif
@@ -209,54 +258,271 @@ namespace instructions {
 #endif
     }
 
-    template <std::size_t alignment, std::unsigned_integral T>
-    std::size_t popcount(const T* src, const std::size_t start, const std::size_t end) noexcept {
-        src = std::assume_aligned<alignment>(src);
+    // plain loops, selected when no simd extension is available
+    namespace scalar {
+        struct and_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return a & b; } };
+        struct or_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return a | b; } };
+        struct xor_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return a ^ b; } };
+        struct nand_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return ~(a & b); } };
+        struct nor_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return ~(a | b); } };
+        struct nxor_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return ~(a ^ b); } };
+        struct diff_op { static constexpr std::uint64_t apply(const std::uint64_t a, const std::uint64_t b) noexcept { return a & ~b; } };
+
+        template <typename op>
+        void store(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            for (std::size_t i = 0; i < n; ++i)
+                dest[i] = op::apply(src1[i], src2[i]);
+        }
 
-        std::size_t sum = 0;
+        template <typename op>
+        void inplace(std::uint64_t* __restrict lhs, const std::uint64_t* __restrict rhs, const std::size_t n) noexcept {
+            for (std::size_t i = 0; i < n; ++i)
+                lhs[i] = op::apply(lhs[i], rhs[i]);
+        }
+
+        template <typename op>
+        std::size_t store_count(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            std::size_t sum = 0;
+
+            for (std::size_t i = 0; i < n; ++i) {
+                dest[i] = op::apply(src1[i], src2[i]);
+                sum += instructions::popcount(dest[i]);
+            }
+
+            return sum;
+        }
+
+        template <typename op>
+        std::size_t count(const std::uint64_t* __restrict src1, const std::uint64_t* __restrict src2, const std::size_t n) noexcept {
+            std::size_t sum = 0;
 
-        /*
-        if (cpu_supports.popcnt)
             for (std::size_t i = 0; i < n; ++i)
-                sum += popcnt64_hw(src[i]);
-        else
+                sum += instructions::popcount(op::apply(src1[i], src2[i]));
+
+            return sum;
+        }
+
+        inline std::size_t popcount(const std::uint64_t* src, const std::size_t n) noexcept {
+            std::size_t sum = 0;
+
+            // faster thanks to branch prediction...
+            // no need to inline two different loops
             for (std::size_t i = 0; i < n; ++i)
-                sum += popcnt64_sw(src[i]);
-        */
-       
-        // faster thanks to branch prediction...
-        // no need to inline two different loops
-        for (std::size_t i = start; i < end; ++i) {
-            sum += popcount(src[i]);
+                sum += instructions::popcount(src[i]);
+
+            return sum;
         }
 
-        return sum;
+        // index of the first/last nonzero block, n if there isn't any
+        inline std::size_t find_first(const std::uint64_t* src, const std::size_t n) noexcept {
+            for (std::size_t i = 0; i < n; ++i)
+                if (src[i] != 0) return i;
+            return n;
+        }
+
+        inline std::size_t find_last(const std::uint64_t* src, const std::size_t n) noexcept {
+            for (std::size_t i = n; i-- > 0;)
+                if (src[i] != 0) return i;
+            return n;
+        }
+
+        // tzcnt + blsr, one iteration per set bit
+        inline std::size_t extract(const std::uint64_t* __restrict src, const std::size_t n, std::uint32_t base, std::uint32_t* __restrict dest) noexcept {
+            std::size_t size = 0;
+
+            for (std::size_t i = 0; i < n; ++i, base += 64) {
+                for (auto block = src[i]; block != 0; block &= block - 1)
+                    dest[size++] = base + static_cast<std::uint32_t>(std::countr_zero(block));
+            }
+
+            return size;
+        }
+    }
+
+    using store_kernel = void (*)(std::uint64_t*, const std::uint64_t*, const std::uint64_t*, std::size_t) noexcept;
+    using inplace_kernel = void (*)(std::uint64_t*, const std::uint64_t*, std::size_t) noexcept;
+    using popcount_kernel = std::size_t (*)(const std::uint64_t*, std::size_t) noexcept;
+    using store_count_kernel = std::size_t (*)(std::uint64_t*, const std::uint64_t*, const std::uint64_t*, std::size_t) noexcept;
+    using count_kernel = std::size_t (*)(const std::uint64_t*, const std::uint64_t*, std::size_t) noexcept;
+    using scan_kernel = std::size_t (*)(const std::uint64_t*, std::size_t) noexcept;
+    using extract_kernel = std::size_t (*)(const std::uint64_t*, std::size_t, std::uint32_t, std::uint32_t*) noexcept;
+
+    // defaults are the scalar kernels, so an empty table is always valid
+    struct kernel_table {
+        store_kernel and_store = scalar::store<scalar::and_op>;
+        store_kernel or_store = scalar::store<scalar::or_op>;
+        store_kernel xor_store = scalar::store<scalar::xor_op>;
+        store_kernel nand_store = scalar::store<scalar::nand_op>;
+        store_kernel nor_store = scalar::store<scalar::nor_op>;
+        store_kernel nxor_store = scalar::store<scalar::nxor_op>;
+        store_kernel diff_store = scalar::store<scalar::diff_op>;
+
+        inplace_kernel and_inplace = scalar::inplace<scalar::and_op>;
+        inplace_kernel or_inplace = scalar::inplace<scalar::or_op>;
+        inplace_kernel xor_inplace = scalar::inplace<scalar::xor_op>;
+        inplace_kernel nand_inplace = scalar::inplace<scalar::nand_op>;
+        inplace_kernel nor_inplace = scalar::inplace<scalar::nor_op>;
+        inplace_kernel nxor_inplace = scalar::inplace<scalar::nxor_op>;
+        inplace_kernel diff_inplace = scalar::inplace<scalar::diff_op>;
+
+        popcount_kernel popcount = scalar::popcount;
+
+        // fused op + popcount, the result is read only once
+        store_count_kernel and_count_store = scalar::store_count<scalar::and_op>;
+        store_count_kernel diff_count_store = scalar::store_count<scalar::diff_op>;
+        count_kernel and_count = scalar::count<scalar::and_op>;
+
+        // first/last nonzero block, n if the range is empty
+        scan_kernel find_first = scalar::find_first;
+        scan_kernel find_last = scalar::find_last;
+
+        // positions of the set bits, the first block starts at base
+        extract_kernel extract = scalar::extract;
+
+        const char* name = "scalar";
+    };
+
+#if defined(__x86_64__) || defined(_M_X64)
+    template <template <typename> typename simd>
+    void fill_kernels(kernel_table& table) noexcept {
+        table.and_store = simd<x86::and_op>::store;
+        table.or_store = simd<x86::or_op>::store;
+        table.xor_store = simd<x86::xor_op>::store;
+        table.nand_store = simd<x86::nand_op>::store;
+        table.nor_store = simd<x86::nor_op>::store;
+        table.nxor_store = simd<x86::nxor_op>::store;
+        table.diff_store = simd<x86::diff_op>::store;
+
+        table.and_inplace = simd<x86::and_op>::inplace;
+        table.or_inplace = simd<x86::or_op>::inplace;
+        table.xor_inplace = simd<x86::xor_op>::inplace;
+        table.nand_inplace = simd<x86::nand_op>::inplace;
+        table.nor_inplace = simd<x86::nor_op>::inplace;
+        table.nxor_inplace = simd<x86::nxor_op>::inplace;
+        table.diff_inplace = simd<x86::diff_op>::inplace;
     }
 
+    template <template <typename> typename simd>
+    void fill_count_kernels(kernel_table& table) noexcept {
+        table.and_count_store = simd<x86::and_op>::store_count;
+        table.diff_count_store = simd<x86::diff_op>::store_count;
+        table.and_count = simd<x86::and_op>::count;
+    }
+#elif defined(CLISAT_ARM_KERNELS) && (defined(__aarch64__) || defined(_M_ARM64))
+    template <template <typename> typename simd>
+    void fill_kernels(kernel_table& table) noexcept {
+        table.and_store = simd<arm::and_op>::store;
+        table.or_store = simd<arm::or_op>::store;
+        table.xor_store = simd<arm::xor_op>::store;
+        table.nand_store = simd<arm::nand_op>::store;
+        table.nor_store = simd<arm::nor_op>::store;
+        table.nxor_store = simd<arm::nxor_op>::store;
+        table.diff_store = simd<arm::diff_op>::store;
+
+        table.and_inplace = simd<arm::and_op>::inplace;
+        table.or_inplace = simd<arm::or_op>::inplace;
+        table.xor_inplace = simd<arm::xor_op>::inplace;
+        table.nand_inplace = simd<arm::nand_op>::inplace;
+        table.nor_inplace = simd<arm::nor_op>::inplace;
+        table.nxor_inplace = simd<arm::nxor_op>::inplace;
+        table.diff_inplace = simd<arm::diff_op>::inplace;
+
+        table.and_count_store = simd<arm::and_op>::store_count;
+        table.diff_count_store = simd<arm::diff_op>::store_count;
+        table.and_count = simd<arm::and_op>::count;
+    }
+#endif
+
+    inline kernel_table select_kernels() noexcept {
+        kernel_table table;
+#if defined(__x86_64__) || defined(_M_X64)
+        // cpu_supports could still be uninitialized here
+        const features supports = cpu_supports_impl();
+
+        if (supports.avx2) {
+            fill_kernels<x86::avx2>(table);
+            fill_count_kernels<x86::harley_seal>(table);
+            table.popcount = x86::popcount_avx2;
+            table.find_first = x86::find_first_avx2;
+            table.find_last = x86::find_last_avx2;
+            table.name = "avx2";
+        }
+        if (supports.avx512f) {
+            fill_kernels<x86::avx512>(table);
+            if (supports.avx512bw) table.popcount = x86::popcount_avx512;
+            if (supports.avx512vpopcntdq) {
+                fill_count_kernels<x86::vpopcntdq>(table);
+                table.popcount = x86::popcount_vpopcntdq;
+            }
+            if (supports.avx512bw && supports.avx512vbmi2) table.extract = x86::extract_vbmi2;
+            table.name = "avx512";
+        }
+#elif defined(CLISAT_ARM_KERNELS) && (defined(__aarch64__) || defined(_M_ARM64))
+        const features supports = cpu_supports_impl();
+
+        if (supports.neon) {
+            fill_kernels<arm::neon>(table);
+            table.popcount = arm::popcount_neon;
+            table.find_first = arm::find_first_neon;
+            table.find_last = arm::find_last_neon;
+            table.name = "neon";
+        }
+#if defined(__ARM_FEATURE_SVE)
+        // find_last keeps the neon version, sve has no cheap "last active lane" index
+        if (supports.sve) {
+            fill_kernels<arm::sve>(table);
+            table.popcount = arm::popcount_sve;
+            table.find_first = arm::find_first_sve;
+            table.name = "sve";
+        }
+#endif
+#endif
+
+        return table;
+    }
+
+    // constant initialized with the scalar kernels, replaced once during dynamic initialization.
+    // this way bitset operations executed by other static initializers are always safe
+    inline kernel_table kernels{};
+    inline const bool kernels_selected = (kernels = select_kernels(), true);
+
+    // below this many blocks the indirect call costs more than the loop itself
+    inline constexpr std::size_t dispatch_threshold = 8;
+
     template <std::size_t alignment, std::unsigned_integral T>
-    std::size_t popcount(const T* src, const std::size_t n) noexcept {
+    std::size_t popcount(const T* src, const std::size_t start, const std::size_t end) noexcept {
         src = std::assume_aligned<alignment>(src);
 
         std::size_t sum = 0;
 
-        /*
-        if (cpu_supports.popcnt)
-            for (std::size_t i = 0; i < n; ++i)
-                sum += popcnt64_hw(src[i]);
-        else
-            for (std::size_t i = 0; i < n; ++i)
-                sum += popcnt64_sw(src[i]);
-        */
-       
+        if constexpr (std::same_as<T, std::uint64_t>)
+            if (start + dispatch_threshold <= end)
+                return kernels.popcount(src + start, end - start);
+
         // faster thanks to branch prediction...
         // no need to inline two different loops
-        for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t i = start; i < end; ++i) {
             sum += popcount(src[i]);
         }
 
         return sum;
     }
 
+    template <std::size_t alignment, std::unsigned_integral T>
+    std::size_t popcount(const T* src, const std::size_t n) noexcept {
+        return popcount<alignment>(src, 0, n);
+    }
+
     template <std::size_t alignment>
     void and_inplace(
         std::uint64_t* __restrict lhs,
@@ -267,6 +533,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.and_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] &= rhs[i];
     }
@@ -286,6 +557,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.or_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] |= rhs[i];
     }
@@ -305,6 +581,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.xor_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] ^= rhs[i];
     }
@@ -324,6 +605,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.nand_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] = ~(lhs[i] & rhs[i]);
     }
@@ -343,6 +629,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.nor_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] = ~(lhs[i] | rhs[i]);
     }
@@ -362,6 +653,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.nxor_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] = ~(lhs[i] ^ rhs[i]);
     }
@@ -381,6 +677,11 @@ namespace instructions {
         lhs = std::assume_aligned<alignment>(lhs);
         rhs = std::assume_aligned<alignment>(rhs);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.diff_inplace(lhs + start, rhs + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             lhs[i] &= ~rhs[i];
     }
@@ -402,6 +703,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.and_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = src1[i] & src2[i];
     }
@@ -428,6 +734,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.or_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = src1[i] | src2[i];
     }
@@ -454,6 +765,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.xor_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = src1[i] ^ src2[i];
     }
@@ -480,6 +796,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.nand_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = ~(src1[i] & src2[i]);
     }
@@ -506,6 +827,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.nor_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = ~(src1[i] | src2[i]);
     }
@@ -532,6 +858,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.nxor_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = ~(src1[i] ^ src2[i]);
     }
@@ -558,6 +889,11 @@ namespace instructions {
         src1 = std::assume_aligned<alignment>(src1);
         src2 = std::assume_aligned<alignment>(src2);
 
+        if (start + dispatch_threshold <= end) {
+            kernels.diff_store(dest + start, src1 + start, src2 + start, end - start);
+            return;
+        }
+
         for (std::size_t i = start; i < end; ++i)
             dest[i] = src1[i] & ~src2[i];
     }
@@ -572,6 +908,141 @@ namespace instructions {
         diff_store<alignment>(dest, src1, src2, 0, n);
     }
 
+    template <std::size_t alignment>
+    std::size_t and_count_store(
+        std::uint64_t* __restrict dest,
+        const std::uint64_t* __restrict src1,
+        const std::uint64_t* __restrict src2,
+        const std::size_t start,
+        const std::size_t end
+    ) {
+        dest = std::assume_aligned<alignment>(dest);
+        src1 = std::assume_aligned<alignment>(src1);
+        src2 = std::assume_aligned<alignment>(src2);
+
+        if (start + dispatch_threshold <= end)
+            return kernels.and_count_store(dest + start, src1 + start, src2 + start, end - start);
+
+        std::size_t sum = 0;
+        for (std::size_t i = start; i < end; ++i) {
+            dest[i] = src1[i] & src2[i];
+            sum += popcount(dest[i]);
+        }
+
+        return sum;
+    }
+
+    template <std::size_t alignment>
+    std::size_t and_count_store(
+        std::uint64_t* __restrict dest,
+        const std::uint64_t* __restrict src1,
+        const std::uint64_t* __restrict src2,
+        const std::size_t n
+    ) {
+        return and_count_store<alignment>(dest, src1, src2, 0, n);
+    }
+
+    template <std::size_t alignment>
+    std::size_t diff_count_store(
+        std::uint64_t* __restrict dest,
+        const std::uint64_t* __restrict src1,
+        const std::uint64_t* __restrict src2,
+        const std::size_t start,
+        const std::size_t end
+    ) {
+        dest = std::assume_aligned<alignment>(dest);
+        src1 = std::assume_aligned<alignment>(src1);
+        src2 = std::assume_aligned<alignment>(src2);
+
+        if (start + dispatch_threshold <= end)
+            return kernels.diff_count_store(dest + start, src1 + start, src2 + start, end - start);
+
+        std::size_t sum = 0;
+        for (std::size_t i = start; i < end; ++i) {
+            dest[i] = src1[i] & ~src2[i];
+            sum += popcount(dest[i]);
+        }
+
+        return sum;
+    }
+
+    template <std::size_t alignment>
+    std::size_t diff_count_store(
+        std::uint64_t* __restrict dest,
+        const std::uint64_t* __restrict src1,
+        const std::uint64_t* __restrict src2,
+        const std::size_t n
+    ) {
+        return diff_count_store<alignment>(dest, src1, src2, 0, n);
+    }
+
+    template <std::size_t alignment>
+    std::size_t and_count(
+        const std::uint64_t* __restrict src1,
+        const std::uint64_t* __restrict src2,
+        const std::size_t start,
+        const std::size_t end
+    ) {
+        src1 = std::assume_aligned<alignment>(src1);
+        src2 = std::assume_aligned<alignment>(src2);
+
+        if (start + dispatch_threshold <= end)
+            return kernels.and_count(src1 + start, src2 + start, end - start);
+
+        std::size_t sum = 0;
+        for (std::size_t i = start; i < end; ++i)
+            sum += popcount(src1[i] & src2[i]);
+
+        return sum;
+    }
+
+    template <std::size_t alignment>
+    std::size_t and_count(const std::uint64_t* __restrict src1, const std::uint64_t* __restrict src2, const std::size_t n) {
+        return and_count<alignment>(src1, src2, 0, n);
+    }
+
+    // first nonzero block in [start, end), end if there isn't any.
+    // the next block is usually the one we look for: the first blocks are tested inline
+    // and the kernel is called only on long runs of zero blocks
+    template <std::size_t alignment>
+    std::size_t find_first(const std::uint64_t* src, const std::size_t start, const std::size_t end) noexcept {
+        src = std::assume_aligned<alignment>(src);
+
+        const auto inline_end = start + dispatch_threshold < end ? start + dispatch_threshold : end;
+        for (std::size_t i = start; i < inline_end; ++i)
+            if (src[i] != 0) return i;
+        if (inline_end == end) return end;
+
+        const auto found = kernels.find_first(src + inline_end, end - inline_end);
+        return inline_end + found;
+    }
+
+    // last nonzero block in [start, end), end if there isn't any
+    template <std::size_t alignment>
+    std::size_t find_last(const std::uint64_t* src, const std::size_t start, const std::size_t end) noexcept {
+        src = std::assume_aligned<alignment>(src);
+
+        const auto inline_start = start + dispatch_threshold < end ? end - dispatch_threshold : start;
+        for (std::size_t i = end; i-- > inline_start;)
+            if (src[i] != 0) return i;
+        if (inline_start == start) return end;
+
+        const auto found = kernels.find_last(src + start, inline_start - start);
+        return found == inline_start - start ? end : start + found;
+    }
+
+    // writes the positions of the set bits of [start, end) in dest, in increasing order,
+    // and returns how many they are. dest must hold at least popcount(src, start, end) elements
+    template <std::size_t alignment>
+    std::size_t extract(const std::uint64_t* __restrict src, const std::size_t start, const std::size_t end, std::uint32_t* __restrict dest) {
+        src = std::assume_aligned<alignment>(src);
+
+        if (start + dispatch_threshold <= end)
+            return kernels.extract(src + start, end - start, static_cast<std::uint32_t>(start * 64), dest);
+
+        return scalar::extract(src + start, end - start, static_cast<std::uint32_t>(start * 64), dest);
+    }
+
     template <std::size_t alignment>
     void memset(
         std::uint64_t* __restrict dest,
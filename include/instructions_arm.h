@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <arm_neon.h>
+
+#if defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#endif
+
+// AArch64 counterpart of instructions_x86.h.
+// NEON is part of the base ISA, so the neon kernels need no target attribute and are always
+// selected. SVE kernels are compiled only when the build enables SVE (-march=armv8.2-a+sve or
+// newer) and they are selected only if the cpu reports it, the vector length is read at runtime.
+// Pointers are not required to be aligned (ranges can start in the middle of a bitset).
+namespace instructions::arm {
+    // NEON has no 64 bit lane not, it's the same bits through the 32 bit lanes
+    inline uint64x2_t not_u64(const uint64x2_t a) noexcept {
+        return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(a)));
+    }
+
+    // every operation exposes its neon and (when enabled) sve variant, scalar ones live in instructions.h
+    struct and_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return vandq_u64(a, b); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return svand_u64_x(pg, a, b); }
+#endif
+    };
+
+    struct or_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return vorrq_u64(a, b); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return svorr_u64_x(pg, a, b); }
+#endif
+    };
+
+    struct xor_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return veorq_u64(a, b); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return sveor_u64_x(pg, a, b); }
+#endif
+    };
+
+    struct nand_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return not_u64(vandq_u64(a, b)); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return svnot_u64_x(pg, svand_u64_x(pg, a, b)); }
+#endif
+    };
+
+    struct nor_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return not_u64(vorrq_u64(a, b)); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return svnot_u64_x(pg, svorr_u64_x(pg, a, b)); }
+#endif
+    };
+
+    struct nxor_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return not_u64(veorq_u64(a, b)); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return svnot_u64_x(pg, sveor_u64_x(pg, a, b)); }
+#endif
+    };
+
+    // a & ~b, a single bic
+    struct diff_op {
+        static uint64x2_t neon(const uint64x2_t a, const uint64x2_t b) noexcept { return vbicq_u64(a, b); }
+#if defined(__ARM_FEATURE_SVE)
+        static svuint64_t sve(const svbool_t pg, const svuint64_t a, const svuint64_t b) noexcept { return svbic_u64_x(pg, a, b); }
+#endif
+    };
+
+    // vcnt gives the popcount of every byte, vpadal folds them into 16 bit lanes.
+    // a lane grows by at most 16 per vector, flushing every 2048 vectors keeps it below 65536
+    inline constexpr std::size_t neon_flush_interval = 2048;
+
+    inline uint16x8_t popcount_acc_neon(const uint16x8_t acc, const uint64x2_t v) noexcept {
+        return vpadalq_u8(acc, vcntq_u8(vreinterpretq_u8_u64(v)));
+    }
+
+    template <typename op>
+    struct neon {
+        static void store(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            std::size_t i = 0;
+
+            // two vectors per iteration, the cores have at least two simd pipes
+            for (; i + 4 <= n; i += 4) {
+                vst1q_u64(dest + i, op::neon(vld1q_u64(src1 + i), vld1q_u64(src2 + i)));
+                vst1q_u64(dest + i + 2, op::neon(vld1q_u64(src1 + i + 2), vld1q_u64(src2 + i + 2)));
+            }
+            for (; i + 2 <= n; i += 2)
+                vst1q_u64(dest + i, op::neon(vld1q_u64(src1 + i), vld1q_u64(src2 + i)));
+            if (i < n)
+                vst1_u64(dest + i, vget_low_u64(op::neon(vcombine_u64(vld1_u64(src1 + i), vdup_n_u64(0)), vcombine_u64(vld1_u64(src2 + i), vdup_n_u64(0)))));
+        }
+
+        static void inplace(
+            std::uint64_t* __restrict lhs,
+            const std::uint64_t* __restrict rhs,
+            const std::size_t n
+        ) noexcept {
+            std::size_t i = 0;
+
+            for (; i + 4 <= n; i += 4) {
+                vst1q_u64(lhs + i, op::neon(vld1q_u64(lhs + i), vld1q_u64(rhs + i)));
+                vst1q_u64(lhs + i + 2, op::neon(vld1q_u64(lhs + i + 2), vld1q_u64(rhs + i + 2)));
+            }
+            for (; i + 2 <= n; i += 2)
+                vst1q_u64(lhs + i, op::neon(vld1q_u64(lhs + i), vld1q_u64(rhs + i)));
+            if (i < n)
+                vst1_u64(lhs + i, vget_low_u64(op::neon(vcombine_u64(vld1_u64(lhs + i), vdup_n_u64(0)), vcombine_u64(vld1_u64(rhs + i), vdup_n_u64(0)))));
+        }
+
+        template <bool store>
+        static std::size_t kernel(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            std::size_t sum = 0;
+            std::size_t i = 0;
+
+            while (i + 2 <= n) {
+                auto acc = vdupq_n_u16(0);
+                const auto end = std::min(n & ~std::size_t{1}, i + 2*neon_flush_interval);
+                for (; i < end; i += 2) {
+                    const auto v = op::neon(vld1q_u64(src1 + i), vld1q_u64(src2 + i));
+                    if constexpr (store) vst1q_u64(dest + i, v);
+                    acc = popcount_acc_neon(acc, v);
+                }
+                sum += vaddlvq_u16(acc);
+            }
+            if (i < n) {
+                const auto v = op::neon(vcombine_u64(vld1_u64(src1 + i), vdup_n_u64(0)), vcombine_u64(vld1_u64(src2 + i), vdup_n_u64(0)));
+                if constexpr (store) vst1_u64(dest + i, vget_low_u64(v));
+                sum += vaddv_u8(vcnt_u8(vreinterpret_u8_u64(vget_low_u64(v))));
+            }
+
+            return sum;
+        }
+
+        static std::size_t store_count(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<true>(dest, src1, src2, n);
+        }
+
+        static std::size_t count(
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<false>(nullptr, src1, src2, n);
+        }
+    };
+
+    inline std::size_t popcount_neon(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t sum = 0;
+        std::size_t i = 0;
+
+        while (i + 2 <= n) {
+            auto acc = vdupq_n_u16(0);
+            const auto end = std::min(n & ~std::size_t{1}, i + 2*neon_flush_interval);
+            for (; i < end; i += 2) acc = popcount_acc_neon(acc, vld1q_u64(src + i));
+            sum += vaddlvq_u16(acc);
+        }
+        if (i < n) sum += vaddv_u8(vcnt_u8(vreinterpret_u8_u64(vld1_u64(src + i))));
+
+        return sum;
+    }
+
+    // 4 blocks are tested at once, the nonzero one is then found by the scalar loop
+    inline std::size_t find_first_neon(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t i = 0;
+
+        for (; i + 4 <= n; i += 4) {
+            const auto v = vorrq_u64(vld1q_u64(src + i), vld1q_u64(src + i + 2));
+            if (vmaxvq_u32(vreinterpretq_u32_u64(v)) != 0) break;
+        }
+        for (; i < n; ++i)
+            if (src[i] != 0) return i;
+
+        return n;
+    }
+
+    inline std::size_t find_last_neon(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t i = n;
+
+        for (; i >= 4; i -= 4) {
+            const auto v = vorrq_u64(vld1q_u64(src + i - 4), vld1q_u64(src + i - 2));
+            if (vmaxvq_u32(vreinterpretq_u32_u64(v)) != 0) break;
+        }
+        while (i-- > 0)
+            if (src[i] != 0) return i;
+
+        return n;
+    }
+
+#if defined(__ARM_FEATURE_SVE)
+    // vector length agnostic: whilelt predicates cover the tail, no scalar loop needed
+    template <typename op>
+    struct sve {
+        static void store(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            for (std::size_t i = 0; i < n; i += svcntd()) {
+                const auto pg = svwhilelt_b64(i, n);
+                svst1_u64(pg, dest + i, op::sve(pg, svld1_u64(pg, src1 + i), svld1_u64(pg, src2 + i)));
+            }
+        }
+
+        static void inplace(
+            std::uint64_t* __restrict lhs,
+            const std::uint64_t* __restrict rhs,
+            const std::size_t n
+        ) noexcept {
+            for (std::size_t i = 0; i < n; i += svcntd()) {
+                const auto pg = svwhilelt_b64(i, n);
+                svst1_u64(pg, lhs + i, op::sve(pg, svld1_u64(pg, lhs + i), svld1_u64(pg, rhs + i)));
+            }
+        }
+
+        // svcnt counts whole 64 bit lanes, the accumulator can't overflow
+        template <bool store>
+        static std::size_t kernel(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            auto acc = svdup_n_u64(0);
+
+            for (std::size_t i = 0; i < n; i += svcntd()) {
+                const auto pg = svwhilelt_b64(i, n);
+                const auto v = op::sve(pg, svld1_u64(pg, src1 + i), svld1_u64(pg, src2 + i));
+                if constexpr (store) svst1_u64(pg, dest + i, v);
+                acc = svadd_u64_m(pg, acc, svcnt_u64_x(pg, v));
+            }
+
+            return svaddv_u64(svptrue_b64(), acc);
+        }
+
+        static std::size_t store_count(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<true>(dest, src1, src2, n);
+        }
+
+        static std::size_t count(
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<false>(nullptr, src1, src2, n);
+        }
+    };
+
+    inline std::size_t popcount_sve(const std::uint64_t* src, const std::size_t n) noexcept {
+        auto acc = svdup_n_u64(0);
+
+        for (std::size_t i = 0; i < n; i += svcntd()) {
+            const auto pg = svwhilelt_b64(i, n);
+            acc = svadd_u64_m(pg, acc, svcnt_u64_x(pg, svld1_u64(pg, src + i)));
+        }
+
+        return svaddv_u64(svptrue_b64(), acc);
+    }
+
+    // brkb keeps the lanes before the first nonzero one, their count is its index
+    inline std::size_t find_first_sve(const std::uint64_t* src, const std::size_t n) noexcept {
+        for (std::size_t i = 0; i < n; i += svcntd()) {
+            const auto pg = svwhilelt_b64(i, n);
+            const auto nonzero = svcmpne_n_u64(pg, svld1_u64(pg, src + i), 0);
+            if (svptest_any(pg, nonzero)) return i + svcntp_b64(pg, svbrkb_b_z(pg, nonzero));
+        }
+
+        return n;
+    }
+#endif
+}
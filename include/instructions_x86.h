@@ -0,0 +1,490 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <immintrin.h>
+
+// GCC/Clang need the target attribute to emit AVX code inside a baseline x86-64 build,
+// MSVC lets us use every intrinsic without any flag
+#if defined(__GNUC__) || defined(__clang__)
+#define INSTRUCTIONS_TARGET(x) __attribute__((target(x)))
+#else
+#define INSTRUCTIONS_TARGET(x)
+#endif
+
+#define INSTRUCTIONS_AVX2 INSTRUCTIONS_TARGET("avx2")
+#define INSTRUCTIONS_AVX512 INSTRUCTIONS_TARGET("avx512f")
+#define INSTRUCTIONS_AVX512BW INSTRUCTIONS_TARGET("avx512f,avx512bw")
+#define INSTRUCTIONS_AVX512VPOPCNTDQ INSTRUCTIONS_TARGET("avx512f,avx512vpopcntdq")
+#define INSTRUCTIONS_AVX512VBMI2 INSTRUCTIONS_TARGET("avx512f,avx512bw,avx512vbmi2,popcnt")
+
+// Hand written 256/512 bit kernels.
+// They are never called directly: instructions.h selects them once at startup
+// based on cpu_supports, so the binary can still be built for baseline x86-64.
+// Pointers are not required to be aligned (ranges can start in the middle of a bitset).
+namespace instructions::x86 {
+    // every operation exposes its avx2 and avx512 variant, scalar ones live in instructions.h
+    // avx512 variants use vpternlogq to compute the negated operations in a single instruction
+    // (A = 0xF0, B = 0xCC)
+    struct and_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept { return _mm256_and_si256(a, b); }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_and_si512(a, b); }
+    };
+
+    struct or_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept { return _mm256_or_si256(a, b); }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_or_si512(a, b); }
+    };
+
+    struct xor_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept { return _mm256_xor_si256(a, b); }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_xor_si512(a, b); }
+    };
+
+    struct nand_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept {
+            return _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_set1_epi64x(-1));
+        }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_ternarylogic_epi64(a, b, a, 0x3F); }
+    };
+
+    struct nor_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept {
+            return _mm256_xor_si256(_mm256_or_si256(a, b), _mm256_set1_epi64x(-1));
+        }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_ternarylogic_epi64(a, b, a, 0x03); }
+    };
+
+    struct nxor_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept {
+            return _mm256_xor_si256(_mm256_xor_si256(a, b), _mm256_set1_epi64x(-1));
+        }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_ternarylogic_epi64(a, b, a, 0xC3); }
+    };
+
+    // a & ~b
+    struct diff_op {
+        INSTRUCTIONS_AVX2 static __m256i avx2(const __m256i a, const __m256i b) noexcept { return _mm256_andnot_si256(b, a); }
+        INSTRUCTIONS_AVX512 static __m512i avx512(const __m512i a, const __m512i b) noexcept { return _mm512_andnot_si512(b, a); }
+    };
+
+    // lanes [0, n) enabled, n < 4
+    INSTRUCTIONS_AVX2 inline __m256i tail_mask_avx2(const std::size_t n) noexcept {
+        return _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(n)), _mm256_setr_epi64x(0, 1, 2, 3));
+    }
+
+    template <typename op>
+    struct avx2 {
+        INSTRUCTIONS_AVX2 static void store(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            std::size_t i = 0;
+
+            // two vectors per iteration, enough to saturate the load ports
+            for (; i + 8 <= n; i += 8) {
+                const auto a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+                const auto a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i + 4));
+                const auto b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+                const auto b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i + 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), op::avx2(a0, b0));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i + 4), op::avx2(a1, b1));
+            }
+            for (; i + 4 <= n; i += 4) {
+                const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+                const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), op::avx2(a, b));
+            }
+            if (i < n) {
+                const auto mask = tail_mask_avx2(n - i);
+                const auto a = _mm256_maskload_epi64(reinterpret_cast<const long long*>(src1 + i), mask);
+                const auto b = _mm256_maskload_epi64(reinterpret_cast<const long long*>(src2 + i), mask);
+                _mm256_maskstore_epi64(reinterpret_cast<long long*>(dest + i), mask, op::avx2(a, b));
+            }
+        }
+
+        INSTRUCTIONS_AVX2 static void inplace(
+            std::uint64_t* __restrict lhs,
+            const std::uint64_t* __restrict rhs,
+            const std::size_t n
+        ) noexcept {
+            std::size_t i = 0;
+
+            for (; i + 8 <= n; i += 8) {
+                const auto a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+                const auto a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i + 4));
+                const auto b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+                const auto b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i + 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(lhs + i), op::avx2(a0, b0));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(lhs + i + 4), op::avx2(a1, b1));
+            }
+            for (; i + 4 <= n; i += 4) {
+                const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+                const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(lhs + i), op::avx2(a, b));
+            }
+            if (i < n) {
+                const auto mask = tail_mask_avx2(n - i);
+                const auto a = _mm256_maskload_epi64(reinterpret_cast<const long long*>(lhs + i), mask);
+                const auto b = _mm256_maskload_epi64(reinterpret_cast<const long long*>(rhs + i), mask);
+                _mm256_maskstore_epi64(reinterpret_cast<long long*>(lhs + i), mask, op::avx2(a, b));
+            }
+        }
+    };
+
+    // the tail is handled with masked loads/stores, no scalar loop needed
+    template <typename op>
+    struct avx512 {
+        INSTRUCTIONS_AVX512 static void store(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            std::size_t i = 0;
+
+            for (; i + 8 <= n; i += 8) {
+                const auto a = _mm512_loadu_si512(src1 + i);
+                const auto b = _mm512_loadu_si512(src2 + i);
+                _mm512_storeu_si512(dest + i, op::avx512(a, b));
+            }
+            if (i < n) {
+                const __mmask8 mask = (1u << (n - i)) - 1;
+                const auto a = _mm512_maskz_loadu_epi64(mask, src1 + i);
+                const auto b = _mm512_maskz_loadu_epi64(mask, src2 + i);
+                _mm512_mask_storeu_epi64(dest + i, mask, op::avx512(a, b));
+            }
+        }
+
+        INSTRUCTIONS_AVX512 static void inplace(
+            std::uint64_t* __restrict lhs,
+            const std::uint64_t* __restrict rhs,
+            const std::size_t n
+        ) noexcept {
+            std::size_t i = 0;
+
+            for (; i + 8 <= n; i += 8) {
+                const auto a = _mm512_loadu_si512(lhs + i);
+                const auto b = _mm512_loadu_si512(rhs + i);
+                _mm512_storeu_si512(lhs + i, op::avx512(a, b));
+            }
+            if (i < n) {
+                const __mmask8 mask = (1u << (n - i)) - 1;
+                const auto a = _mm512_maskz_loadu_epi64(mask, lhs + i);
+                const auto b = _mm512_maskz_loadu_epi64(mask, rhs + i);
+                _mm512_mask_storeu_epi64(lhs + i, mask, op::avx512(a, b));
+            }
+        }
+    };
+
+    // Mula's nibble lookup popcount: 4 bits -> count through vpshufb, bytes summed with vpsadbw
+    INSTRUCTIONS_AVX2 inline __m256i popcount_bytes_avx2(const __m256i v) noexcept {
+        const auto lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+        );
+        const auto low_mask = _mm256_set1_epi8(0x0f);
+
+        const auto lo = _mm256_and_si256(v, low_mask);
+        const auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    }
+
+    INSTRUCTIONS_AVX2 inline std::size_t horizontal_sum_avx2(const __m256i v) noexcept {
+        return static_cast<std::size_t>(_mm256_extract_epi64(v, 0)) + static_cast<std::size_t>(_mm256_extract_epi64(v, 1)) +
+               static_cast<std::size_t>(_mm256_extract_epi64(v, 2)) + static_cast<std::size_t>(_mm256_extract_epi64(v, 3));
+    }
+
+    INSTRUCTIONS_AVX2 inline std::size_t popcount_avx2(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t i = 0;
+        auto acc = _mm256_setzero_si256();
+
+        for (; i + 4 <= n; i += 4) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(popcount_bytes_avx2(v), _mm256_setzero_si256()));
+        }
+
+        if (i < n) {
+            const auto v = _mm256_maskload_epi64(reinterpret_cast<const long long*>(src + i), tail_mask_avx2(n - i));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(popcount_bytes_avx2(v), _mm256_setzero_si256()));
+        }
+
+        return horizontal_sum_avx2(acc);
+    }
+
+    INSTRUCTIONS_AVX512BW inline __m512i popcount_bytes_avx512(const __m512i v) noexcept {
+        const auto lookup = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+        const auto low_mask = _mm512_set1_epi8(0x0f);
+
+        const auto lo = _mm512_and_si512(v, low_mask);
+        const auto hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_mask);
+        return _mm512_add_epi8(_mm512_shuffle_epi8(lookup, lo), _mm512_shuffle_epi8(lookup, hi));
+    }
+
+    INSTRUCTIONS_AVX512BW inline std::size_t popcount_avx512(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t i = 0;
+        auto acc = _mm512_setzero_si512();
+
+        for (; i + 8 <= n; i += 8) {
+            const auto v = _mm512_loadu_si512(src + i);
+            acc = _mm512_add_epi64(acc, _mm512_sad_epu8(popcount_bytes_avx512(v), _mm512_setzero_si512()));
+        }
+        if (i < n) {
+            const __mmask8 mask = (1u << (n - i)) - 1;
+            const auto v = _mm512_maskz_loadu_epi64(mask, src + i);
+            acc = _mm512_add_epi64(acc, _mm512_sad_epu8(popcount_bytes_avx512(v), _mm512_setzero_si512()));
+        }
+
+        return static_cast<std::size_t>(_mm512_reduce_add_epi64(acc));
+    }
+
+    INSTRUCTIONS_AVX2 inline __m256i popcount_avx2(const __m256i v) noexcept {
+        return _mm256_sad_epu8(popcount_bytes_avx2(v), _mm256_setzero_si256());
+    }
+
+    // carry-save adder: h:l = a + b + c
+    INSTRUCTIONS_AVX2 inline void csa_avx2(__m256i& h, __m256i& l, const __m256i a, const __m256i b, const __m256i c) noexcept {
+        const auto u = _mm256_xor_si256(a, b);
+        h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+        l = _mm256_xor_si256(u, c);
+    }
+
+    // Harley-Seal popcount of op(src1, src2), optionally storing op(src1, src2) into dest.
+    // 16 vectors are reduced through a tree of carry-save adders, so the lookup popcount
+    // runs once every 64 blocks instead of once every 4
+    template <typename op>
+    struct harley_seal {
+        template <bool store>
+        INSTRUCTIONS_AVX2 static __m256i apply(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t i
+        ) noexcept {
+            const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+            const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+            const auto v = op::avx2(a, b);
+            if constexpr (store) _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), v);
+            return v;
+        }
+
+        template <bool store>
+        INSTRUCTIONS_AVX2 static std::size_t kernel(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            auto total = _mm256_setzero_si256();
+            auto ones = _mm256_setzero_si256();
+            auto twos = _mm256_setzero_si256();
+            auto fours = _mm256_setzero_si256();
+            auto eights = _mm256_setzero_si256();
+            __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+
+            std::size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                csa_avx2(twos_a, ones, ones, apply<store>(dest, src1, src2, i), apply<store>(dest, src1, src2, i + 4));
+                csa_avx2(twos_b, ones, ones, apply<store>(dest, src1, src2, i + 8), apply<store>(dest, src1, src2, i + 12));
+                csa_avx2(fours_a, twos, twos, twos_a, twos_b);
+                csa_avx2(twos_a, ones, ones, apply<store>(dest, src1, src2, i + 16), apply<store>(dest, src1, src2, i + 20));
+                csa_avx2(twos_b, ones, ones, apply<store>(dest, src1, src2, i + 24), apply<store>(dest, src1, src2, i + 28));
+                csa_avx2(fours_b, twos, twos, twos_a, twos_b);
+                csa_avx2(eights_a, fours, fours, fours_a, fours_b);
+                csa_avx2(twos_a, ones, ones, apply<store>(dest, src1, src2, i + 32), apply<store>(dest, src1, src2, i + 36));
+                csa_avx2(twos_b, ones, ones, apply<store>(dest, src1, src2, i + 40), apply<store>(dest, src1, src2, i + 44));
+                csa_avx2(fours_a, twos, twos, twos_a, twos_b);
+                csa_avx2(twos_a, ones, ones, apply<store>(dest, src1, src2, i + 48), apply<store>(dest, src1, src2, i + 52));
+                csa_avx2(twos_b, ones, ones, apply<store>(dest, src1, src2, i + 56), apply<store>(dest, src1, src2, i + 60));
+                csa_avx2(fours_b, twos, twos, twos_a, twos_b);
+                csa_avx2(eights_b, fours, fours, fours_a, fours_b);
+                csa_avx2(sixteens, eights, eights, eights_a, eights_b);
+
+                total = _mm256_add_epi64(total, popcount_avx2(sixteens));
+            }
+
+            total = _mm256_slli_epi64(total, 4);
+            total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_avx2(eights), 3));
+            total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_avx2(fours), 2));
+            total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_avx2(twos), 1));
+            total = _mm256_add_epi64(total, popcount_avx2(ones));
+
+            for (; i + 4 <= n; i += 4)
+                total = _mm256_add_epi64(total, popcount_avx2(apply<store>(dest, src1, src2, i)));
+
+            if (i < n) {
+                const auto mask = tail_mask_avx2(n - i);
+                const auto a = _mm256_maskload_epi64(reinterpret_cast<const long long*>(src1 + i), mask);
+                const auto b = _mm256_maskload_epi64(reinterpret_cast<const long long*>(src2 + i), mask);
+                const auto v = _mm256_and_si256(op::avx2(a, b), mask);
+                if constexpr (store) _mm256_maskstore_epi64(reinterpret_cast<long long*>(dest + i), mask, v);
+                total = _mm256_add_epi64(total, popcount_avx2(v));
+            }
+
+            return horizontal_sum_avx2(total);
+        }
+
+        INSTRUCTIONS_AVX2 static std::size_t store_count(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<true>(dest, src1, src2, n);
+        }
+
+        INSTRUCTIONS_AVX2 static std::size_t count(
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<false>(nullptr, src1, src2, n);
+        }
+    };
+
+    // same as harley_seal, but with the native 64 bit lane popcount
+    template <typename op>
+    struct vpopcntdq {
+        template <bool store>
+        INSTRUCTIONS_AVX512VPOPCNTDQ static std::size_t kernel(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            // two accumulators to hide the vpopcntq latency
+            auto acc0 = _mm512_setzero_si512();
+            auto acc1 = _mm512_setzero_si512();
+
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const auto v0 = op::avx512(_mm512_loadu_si512(src1 + i), _mm512_loadu_si512(src2 + i));
+                const auto v1 = op::avx512(_mm512_loadu_si512(src1 + i + 8), _mm512_loadu_si512(src2 + i + 8));
+                if constexpr (store) {
+                    _mm512_storeu_si512(dest + i, v0);
+                    _mm512_storeu_si512(dest + i + 8, v1);
+                }
+                acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(v0));
+                acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(v1));
+            }
+            for (; i + 8 <= n; i += 8) {
+                const auto v = op::avx512(_mm512_loadu_si512(src1 + i), _mm512_loadu_si512(src2 + i));
+                if constexpr (store) _mm512_storeu_si512(dest + i, v);
+                acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(v));
+            }
+            if (i < n) {
+                const __mmask8 mask = (1u << (n - i)) - 1;
+                const auto a = _mm512_maskz_loadu_epi64(mask, src1 + i);
+                const auto b = _mm512_maskz_loadu_epi64(mask, src2 + i);
+                const auto v = op::avx512(a, b);
+                if constexpr (store) _mm512_mask_storeu_epi64(dest + i, mask, v);
+                acc1 = _mm512_add_epi64(acc1, _mm512_maskz_popcnt_epi64(mask, v));
+            }
+
+            return static_cast<std::size_t>(_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1)));
+        }
+
+        INSTRUCTIONS_AVX512VPOPCNTDQ static std::size_t store_count(
+            std::uint64_t* __restrict dest,
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<true>(dest, src1, src2, n);
+        }
+
+        INSTRUCTIONS_AVX512VPOPCNTDQ static std::size_t count(
+            const std::uint64_t* __restrict src1,
+            const std::uint64_t* __restrict src2,
+            const std::size_t n
+        ) noexcept {
+            return kernel<false>(nullptr, src1, src2, n);
+        }
+    };
+
+    INSTRUCTIONS_AVX512VPOPCNTDQ inline std::size_t popcount_vpopcntdq(const std::uint64_t* src, const std::size_t n) noexcept {
+        auto acc0 = _mm512_setzero_si512();
+        auto acc1 = _mm512_setzero_si512();
+
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(src + i)));
+            acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_loadu_si512(src + i + 8)));
+        }
+        for (; i + 8 <= n; i += 8)
+            acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(src + i)));
+        if (i < n) {
+            const __mmask8 mask = (1u << (n - i)) - 1;
+            acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(mask, src + i)));
+        }
+
+        return static_cast<std::size_t>(_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1)));
+    }
+
+    // vpcompressb packs the indices of the set bits of a block (iota masked by the block itself)
+    // into the low bytes, then they are widened to 32 bits 16 at a time.
+    // the work per block doesn't depend on its popcount: no branch mispredictions on dense blocks
+    INSTRUCTIONS_AVX512VBMI2 inline std::size_t extract_vbmi2(
+        const std::uint64_t* __restrict src,
+        const std::size_t n,
+        std::uint32_t base,
+        std::uint32_t* __restrict dest
+    ) noexcept {
+        alignas(64) static constexpr std::uint8_t iota[64] = {
+             0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+            16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+            32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+            48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+        };
+        const auto indices = _mm512_load_si512(iota);
+
+        std::size_t size = 0;
+        for (std::size_t i = 0; i < n; ++i, base += 64) {
+            const auto block = src[i];
+            if (block == 0) continue;
+
+            alignas(64) std::uint8_t packed[64];
+            _mm512_store_si512(packed, _mm512_maskz_compress_epi8(block, indices));
+
+            const auto offset = _mm512_set1_epi32(static_cast<int>(base));
+            const auto count = static_cast<std::size_t>(_mm_popcnt_u64(block));
+            for (std::size_t j = 0; j < count; j += 16) {
+                const auto v = _mm512_add_epi32(_mm512_cvtepu8_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(packed + j))), offset);
+                const __mmask16 mask = count - j >= 16 ? 0xFFFF : (1u << (count - j)) - 1;
+                _mm512_mask_storeu_epi32(dest + size + j, mask, v);
+            }
+            size += count;
+        }
+
+        return size;
+    }
+
+    // 4 blocks are tested at once, the nonzero one is then found by the scalar loop
+    INSTRUCTIONS_AVX2 inline std::size_t find_first_avx2(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t i = 0;
+
+        for (; i + 4 <= n; i += 4) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            if (!_mm256_testz_si256(v, v)) break;
+        }
+        for (; i < n; ++i)
+            if (src[i] != 0) return i;
+
+        return n;
+    }
+
+    INSTRUCTIONS_AVX2 inline std::size_t find_last_avx2(const std::uint64_t* src, const std::size_t n) noexcept {
+        std::size_t i = n;
+
+        for (; i >= 4; i -= 4) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i - 4));
+            if (!_mm256_testz_si256(v, v)) break;
+        }
+        while (i-- > 0)
+            if (src[i] != 0) return i;
+
+        return n;
+    }
+}
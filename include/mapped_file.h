@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// read-only view of a whole file, for the parsers: a private mapping on linux (the kernel pages it in
+// while the threads parse it), a plain read into memory on other systems.
+// copy_on_write maps it writable too (snapshots): written pages become private copies, the file never changes
+class mapped_file {
+    char* _data = nullptr;
+    std::size_t _size = 0;
+    bool _mapped = false;
+    std::string _buffer;
+
+public:
+    explicit mapped_file(const std::string& filename, bool copy_on_write = false);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    [[nodiscard]] std::string_view view() const noexcept { return {_data, _size}; }
+    // writable with copy_on_write only
+    [[nodiscard]] char* data() noexcept { return _data; }
+    [[nodiscard]] std::size_t size() const noexcept { return _size; }
+};
+
+inline mapped_file::mapped_file(const std::string& filename, const bool copy_on_write) {
+#if defined(__linux__)
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("mapped_file: cannot open " + filename);
+
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        _size = static_cast<std::size_t>(st.st_size);
+        // an empty file can't be mapped, the view is empty anyway
+        if (_size == 0) {
+            ::close(fd);
+            return;
+        }
+
+        void* p = ::mmap(nullptr, _size, copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("mapped_file: cannot map " + filename);
+
+        // the parsers read it once front to back, a snapshot stays and is read all over
+        ::madvise(p, _size, copy_on_write ? MADV_WILLNEED : MADV_SEQUENTIAL);
+        _data = static_cast<char*>(p);
+        _mapped = true;
+        return;
+    }
+    ::close(fd);
+#endif
+
+    // not a regular file (or not linux): read it all
+    std::ifstream inf(filename, std::ios::binary);
+    if (!inf) throw std::runtime_error("mapped_file: cannot open " + filename);
+    _buffer.assign(std::istreambuf_iterator<char>(inf), std::istreambuf_iterator<char>());
+    _data = _buffer.data();
+    _size = _buffer.size();
+}
+
+inline mapped_file::~mapped_file() {
+#if defined(__linux__)
+    if (_mapped) ::munmap(_data, _size);
+#endif
+}
+
+// text split in at most parts pieces of about the same size, every piece but the last ends with a '\n'
+// (a line is never split between two pieces)
+inline std::vector<std::string_view> split_lines(const std::string_view text, const std::size_t parts) {
+    std::vector<std::string_view> pieces;
+    std::size_t begin = 0;
+
+    for (std::size_t i = 1; i <= parts && begin < text.size(); ++i) {
+        auto end = i == parts ? text.size() : std::max(begin, text.size() / parts * i);
+        if (end < text.size()) {
+            end = text.find('\n', end);
+            end = end == std::string_view::npos ? text.size() : end+1;
+        }
+        if (end > begin) pieces.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return pieces;
+}
+
+// bytes of an input read a piece at a time (stdin, a pipe, a decompressor): read(dst, max) stores up to max
+// bytes in dst and returns how many, 0 only at the end
+using byte_reader = std::function<std::size_t(char*, std::size_t)>;
+
+// bytes of data (a mapped file), data must outlive the reader
+inline byte_reader view_reader(std::string_view data) {
+    return [data](char* dst, const std::size_t max) mutable {
+        const auto bytes = std::min(max, data.size());
+        std::copy_n(data.data(), bytes, dst);
+        data.remove_prefix(bytes);
+        return bytes;
+    };
+}
+
+// bytes of filename as they arrive, "-" is stdin
+inline byte_reader file_reader(const std::string& filename) {
+    std::shared_ptr<std::FILE> file;
+    if (filename == "-") {
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        file.reset(stdin, [](std::FILE*) {});
+    } else {
+        file.reset(std::fopen(filename.c_str(), "rb"), [](std::FILE* f) { if (f) std::fclose(f); });
+        if (!file) throw std::runtime_error("file_reader: cannot open " + filename);
+    }
+
+    return [file, filename](char* dst, const std::size_t max) {
+        const auto bytes = std::fread(dst, 1, max, file.get());
+        if (bytes == 0 && std::ferror(file.get())) throw std::runtime_error("file_reader: cannot read " + filename);
+        return bytes;
+    };
+}
+
+// prefix (bytes already taken from rest to look at them), then the rest of rest
+inline byte_reader prefix_reader(std::string prefix, byte_reader rest) {
+    return [prefix = std::move(prefix), rest = std::move(rest), pos = std::size_t{0}](char* dst, const std::size_t max) mutable {
+        if (pos == prefix.size()) return rest(dst, max);
+        const auto bytes = std::min(max, prefix.size() - pos);
+        std::copy_n(prefix.data() + pos, bytes, dst);
+        pos += bytes;
+        return bytes;
+    };
+}
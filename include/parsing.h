@@ -1,196 +1,341 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "csr_graph.h"
 #include "custom_graph.h"
+#include "gzip.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+namespace parsing_detail {
+    // files smaller than this are parsed by the calling thread only
+    inline constexpr std::size_t parallel_min_bytes = std::size_t{1} << 20;
+
+    // next line of text from pos on, without its '\n' (and '\r'), pos goes past it
+    inline std::string_view next_line(const std::string_view text, std::size_t& pos) {
+        auto end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        auto line = text.substr(pos, end - pos);
+        pos = std::min(end+1, text.size());
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return line;
+    }
 
-/* In this function we are reading chunks of 8196 bytes from the file
- * based on the line type we do 3 things:
- *  - line type 'c' is a comment, skip
- *  - line type 'p edge' is the graph node and edges count, parse only the third and fourth elements
- *  - line type 'e' is and edge, parse only the second and third elements (node1 and node2)
- *  - line type '\n' is an empty line
- *
- *  We introduced a new extension to the DIMACS format, adding "p clique" problem type
- *  In "p clique" we specify number of nodes, number of edges to read and number of cliques to read.
- *  Then we add a new type of line 'q', that specify as second element the number n of nodes of the clique
- *  and as the n elements if specify the nodes of a clique
- */
-inline custom_graph parse_dimacs_extended(const std::string& filename, const bool complementary = false) {
-    // possible improvement: memory mapped files (mmap)
-    
-    custom_graph G;
-    
-    std::ifstream inf(filename);
-    char buf[0x2000];
-    char line_type = 'c';
-    bool first_char = true;
-    bool last_space_tab = false;
-    std::size_t num1 = 0;
-    std::size_t num2 = 0;
-    std::size_t num3 = 0;
-    std::string type;
-    int spaces = 0;
-    custom_bitset numbers;
-
-    std::size_t remaining_edges = 1;
-    std::size_t remaining_cliques = 1;
-
-    while (inf) {
-        if ((remaining_edges + remaining_cliques) == 0) break;
-        inf.read(buf, sizeof(buf));
-        std::streamsize bytes_read = inf.gcount();
-        if (bytes_read <= 0) break;
-
-        for (int i = 0; i < bytes_read; ++i) {
-            auto c = buf[i];
-            if (c == '\r') continue;
-            if (c == '\n') {
-                // avoid empty lines
-                if (first_char == true) continue;
-
-                first_char = true;
-                switch (line_type) {
-                    case 'c':
-                        break;
-                    case 'p':
-                        // num1 == nodes
-                        // num2 == edges
-                        // num3 == cliques
+    // next space/tab separated token of line from pos on, empty at the end of the line
+    inline std::string_view next_token(const std::string_view line, std::size_t& pos) {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) ++pos;
+        const auto begin = pos;
+        while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t') ++pos;
+        return line.substr(begin, pos - begin);
+    }
+
+    inline std::size_t to_number(const std::string_view token, const char* error) {
+        std::size_t value = 0;
+        const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (ec != std::errc() || end != token.data() + token.size()) throw std::runtime_error(error);
+        return value;
+    }
 
-                        G.resize(num1, complementary);
-                        numbers.resize(num1);
+    // 1-based vertex of a graph with size vertices, 0-based on return
+    inline csr_graph::vertex_type to_vertex(const std::string_view token, const std::size_t size, const char* error) {
+        const auto v = to_number(token, error);
+        if (v == 0 || v > size) throw std::runtime_error(error);
+        return static_cast<csr_graph::vertex_type>(v-1);
+    }
 
-                        remaining_edges = num2;
-                        remaining_cliques = num3;
+    inline std::size_t max_threads() {
+        return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
 
-                        /*
-                        for (size_type j = 0; j < num1; ++j) {
-                            G[j].reset(j);
-                        }
-                        */
+    // runs parse(i) for every i < parts, on up to hardware_concurrency threads when there is more than one part.
+    // parse catches its own exceptions, the callers decide which error comes first in the file
+    template <typename Fn>
+    void parse_parts(const std::size_t parts, Fn&& parse) {
+        if (parts <= 1) {
+            if (parts == 1) parse(std::size_t{0});
+            return;
+        }
 
-                        num1 = 0;
-                        num2 = 0;
-                        num3 = 0;
+        thread_pool pool(std::min(parts, max_threads()));
+        for (std::size_t i = 0; i < parts; ++i) pool.submit([&parse, i] { parse(i); });
+        pool.wait_until_idle();
+    }
 
-                        break;
-                    case 'e':
-                        // num1 == node1
-                        // num2 == node2
-                        // num3 == nothing
-                        if (num1 <= 0 || num1 > G.size() || num2 <= 0 || num2 > G.size()) {
-                            throw std::runtime_error("parse_dimacs_extended: wrong edge");
-                        }
-                        
-                        if (complementary) G.remove_edge(num1-1, num2-1);
-                        else G.add_edge(num1-1, num2-1);
-                        remaining_edges--;
-
-                        num1 = 0;
-                        num2 = 0;
-                        break;
-                    case 'q':
-                        // num1 == numbers of nodes in clique
-                        // num2 == last node read
-                        // num3 == number of nodes read
-
-                        // if last number
-                        if (num3 < num1) {
-                            if (last_space_tab || num3+1 < num1) {
-                                throw std::runtime_error("parse_dimacs_extended: incomplete clique");
-                            }
-                            if (num2 <= 0 || num2 > G.size()) {
-                                throw std::runtime_error("parse_dimacs_extended: wrong node in clique");
-                            }
-                            numbers.set(num2-1);
-                            num3++;
-                        } else if (!last_space_tab) {
-                            throw std::runtime_error("parse_dimacs_extended: too many nodes in clique");
-                        }
-
-                        auto first = numbers.front();
-                        auto last = numbers.back();
-                        
-                        for (auto v = first; v != custom_bitset::npos; v = numbers.next(v)) {
-                            if (complementary) {
-                                custom_bitset::DIFF(G[v], numbers, first, last);
-                            }
-                            else {
-                                custom_bitset::OR(G[v], numbers, first, last);
-                                G[v].reset(v);
-                            }
-                        }
-                        remaining_cliques--;
-
-                        num1 = 0;
-                        num2 = 0;
-                        num3 = 0;
-                        numbers.reset();
-                        break;
-                }
+    inline std::size_t parse_threads(const std::size_t bytes) {
+        if (bytes < parallel_min_bytes) return 1;
+        return max_threads();
+    }
+
+    // the edges of every part, in file order
+    using edge_buffers = std::span<const std::span<const csr_graph::edge_type>>;
+
+    inline csr_graph build_csr(const std::size_t size, const edge_buffers buffers) {
+        return {size, buffers};
+    }
 
-                // nothing to read
-                if ((remaining_edges + remaining_cliques) == 0) break;
+    inline custom_graph build_dense(const std::size_t size, const edge_buffers buffers) {
+        return custom_graph(size, buffers);
+    }
+
+    /* Every format is read by a parser with:
+     *  - header(text, end): position of the body in text, nullopt if text (whole lines only) ends before the
+     *    header does and more may come (!end)
+     *  - parse(piece, part): the lines of a piece of the body into part, part.error is set if it throws
+     *  - finish(parts, pieces, build): build(size, buffers), the graph from the edge buffers of the parts
+     *
+     *  build makes the graph the caller wants (a csr_graph, a bit matrix) straight from the buffers.
+     */
+    template <typename Parser>
+    void parse_part(const Parser& parser, const std::string_view piece, typename Parser::part& part) {
+        try {
+            parser.parse(piece, part);
+        } catch (...) {
+            part.error = std::current_exception();
+        }
+    }
+
+    // the whole text is there (a mapped file): the body is split at line boundaries, one piece per thread
+    template <typename Parser, typename Build>
+    auto parse_whole(Parser parser, const std::string_view text, const Build& build) {
+        const auto body = text.substr(*parser.header(text, true));
+        const auto pieces = split_lines(body, parse_threads(body.size()));
+        std::vector<typename Parser::part> parts(pieces.size());
+        parse_parts(pieces.size(), [&](const std::size_t i) { parse_part(parser, pieces[i], parts[i]); });
+        return parser.finish(parts, pieces, build);
+    }
+
+    // stream input is read and parsed in chunks of about this size
+    inline constexpr std::size_t stream_chunk_bytes = std::size_t{4} << 20;
+
+    // up to bytes more of in at the end of text, false at the end of the input
+    inline bool read_more(const byte_reader& in, std::string& text, const std::size_t bytes) {
+        const auto size = text.size();
+        text.resize(size + bytes);
+        const auto read = in(text.data() + size, bytes);
+        text.resize(size + read);
+        return read > 0;
+    }
+
+    // text up to its last '\n', unless the input is over
+    inline std::string_view whole_lines(const std::string_view text, const bool end) {
+        return end ? text : text.substr(0, text.rfind('\n') + 1);
+    }
 
-                continue;
+    // the text arrives from in (text holds what is already read): the header is read first, then the body a chunk
+    // of whole lines at a time, every chunk parsed by a pool thread while the next one is read.
+    // the chunks are kept until the end, as the parts refer to them
+    template <typename Parser, typename Build>
+    auto parse_chunks(Parser parser, const byte_reader& in, std::string text, bool end, const Build& build) {
+        std::optional<std::size_t> body;
+        while (!(body = parser.header(whole_lines(text, end), end))) end = !read_more(in, text, stream_chunk_bytes);
+
+        std::deque<std::string> chunks;
+        std::deque<typename Parser::part> stream_parts;
+        std::vector<std::string_view> pieces;
+        std::string next = text.substr(*body);
+        text = {};
+
+        {
+            thread_pool pool(max_threads());
+            for (auto target = stream_chunk_bytes; !end || !next.empty();) {
+                while (!end && next.size() < target) end = !read_more(in, next, target - next.size());
+
+                const auto lines = whole_lines(next, end).size();
+                // a line longer than the chunk: read on until it ends
+                if (lines == 0 && !end) {
+                    target = 2 * next.size();
+                    continue;
+                }
+                target = stream_chunk_bytes;
+
+                std::string rest = next.substr(lines);
+                next.resize(lines);
+                auto& chunk = chunks.emplace_back(std::move(next));
+                auto& part = stream_parts.emplace_back();
+                pieces.emplace_back(chunk);
+                pool.submit([&parser, &chunk, &part] { parse_part(parser, chunk, part); });
+                next = std::move(rest);
             }
+            pool.wait_until_idle();
+        }
+
+        std::vector<typename Parser::part> parts(std::make_move_iterator(stream_parts.begin()), std::make_move_iterator(stream_parts.end()));
+        return parser.finish(parts, pieces, build);
+    }
+
+    // edges of a piece of the DIMACS body (the lines after 'p')
+    struct dimacs_part {
+        std::vector<csr_graph::edge_type> edges;
+        std::size_t edge_lines = 0;
+        std::size_t clique_lines = 0;
+        std::exception_ptr error;
+    };
 
-            // skip spaces/tabs
-            if ((c == ' ' || c == '\t')) {
-                if (!last_space_tab) {
-                    switch(line_type) {
-                        case 'p':
-                            if (spaces == 1 && type != "edge" && type != "clique") {
-                                throw std::runtime_error("parse_dimacs_extended: unknown problem type");
-                            }
-                            break;
-                        case 'q':
-                            if (spaces >= 2 && num3 < num1) {
-                                if (num2 <= 0 || num2 > G.size()) {
-                                    throw std::runtime_error("parse_dimacs_extended: wrong node");
-                                }
-                                numbers.set(num2-1);
-                                num3++;
-                                num2 = 0;
-                            }
-                            break;
+    // parses the 'c', 'e' and 'q' lines of text into part. with stop, it returns true at the line where
+    // edge_lines and clique_lines become equal to it: the rest of the file is not read, as the declared counts are done
+    inline bool parse_dimacs_lines(const std::string_view text, const std::size_t size, dimacs_part& part, const std::pair<std::size_t, std::size_t>* stop) {
+        std::vector<csr_graph::vertex_type> clique;
+
+        for (std::size_t pos = 0; pos < text.size();) {
+            const auto line = next_line(text, pos);
+            std::size_t at = 0;
+            const auto type = next_token(line, at);
+
+            // avoid empty lines
+            if (type.empty()) continue;
+
+            switch (type.front()) {
+                case 'c':
+                    continue;
+                case 'p':
+                    throw std::runtime_error("parse_dimacs_extended: more than one problem line");
+                case 'e': {
+                    const auto u = to_vertex(next_token(line, at), size, "parse_dimacs_extended: wrong edge");
+                    const auto v = to_vertex(next_token(line, at), size, "parse_dimacs_extended: wrong edge");
+                    part.edges.emplace_back(u, v);
+                    part.edge_lines++;
+                    break;
+                }
+                case 'q': {
+                    const auto n = to_number(next_token(line, at), "parse_dimacs_extended: incomplete clique");
+                    clique.clear();
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const auto token = next_token(line, at);
+                        if (token.empty()) throw std::runtime_error("parse_dimacs_extended: incomplete clique");
+                        clique.push_back(to_vertex(token, size, "parse_dimacs_extended: wrong node in clique"));
                     }
-                    spaces++;
-                    last_space_tab = true;
+                    if (!next_token(line, at).empty()) throw std::runtime_error("parse_dimacs_extended: too many nodes in clique");
+
+                    for (std::size_t a = 0; a < clique.size(); ++a)
+                        for (std::size_t b = a+1; b < clique.size(); ++b)
+                            part.edges.emplace_back(clique[a], clique[b]);
+                    part.clique_lines++;
+                    break;
                 }
-                continue;
+                default:
+                    throw std::runtime_error("parse_dimacs_extended: invalid line format");
             }
 
-            if (first_char) {
-                line_type = c;
-                if (line_type != 'c' && line_type != 'p' && line_type != 'e' && line_type != 'q') {
-                    throw std::runtime_error("parse_dimacs_extended: invalid line format");
-                }
-                //first_char = (c == '\n');
-                first_char = false;
-                last_space_tab = false;
-                spaces = 0;
-                continue;
+            if (stop && part.edge_lines == stop->first && part.clique_lines == stop->second) return true;
+        }
+
+        return false;
+    }
+
+    struct dimacs_parser {
+        using part = dimacs_part;
+
+        std::size_t size = 0;
+        std::pair<std::size_t, std::size_t> declared; // edges, cliques
+
+        // comments up to the problem line. without one the graph is empty
+        std::optional<std::size_t> header(const std::string_view text, const bool end) {
+            for (std::size_t pos = 0;;) {
+                if (pos == text.size()) return end ? std::optional(pos) : std::nullopt;
+
+                const auto line = next_line(text, pos);
+                std::size_t at = 0;
+                const auto type = next_token(line, at);
+                if (type.empty() || type.front() == 'c') continue;
+                if (type.front() == 'e' || type.front() == 'q') throw std::runtime_error("parse_dimacs_extended: wrong edge");
+                if (type.front() != 'p') throw std::runtime_error("parse_dimacs_extended: invalid line format");
+
+                const auto problem = next_token(line, at);
+                if (problem != "edge" && problem != "clique") throw std::runtime_error("parse_dimacs_extended: unknown problem type");
+
+                size = to_number(next_token(line, at), "parse_dimacs_extended: wrong problem line");
+                declared.first = to_number(next_token(line, at), "parse_dimacs_extended: wrong problem line");
+                if (problem == "clique") declared.second = to_number(next_token(line, at), "parse_dimacs_extended: wrong problem line");
+                return pos;
             }
+        }
+
+        void parse(const std::string_view piece, part& part) const {
+            parse_dimacs_lines(piece, size, part, nullptr);
+        }
+
+        template <typename Build>
+        auto finish(std::vector<part>& parts, const std::vector<std::string_view>& pieces, const Build& build) const {
+            // nothing to read
+            if (declared.first + declared.second == 0) return build(size, edge_buffers());
 
-            if (line_type == 'c') continue;
-
-            last_space_tab = false;
-            if (line_type == 'p') {
-                if (spaces == 1) type += c;
-                else if (spaces == 2) num1 = num1*10 + (c - '0');
-                else if (spaces == 3) num2 = num2*10 + (c - '0');
-                else if (type == "clique" && spaces == 4) num3 = num3*10 + (c - '0');
-            } else if (line_type == 'e') {
-                if (spaces == 1) num1 = num1*10 + (c - '0');
-                else if (spaces == 2) num2 = num2*10 + (c - '0');
-            } else if (line_type == 'q') {
-                if (spaces == 1) num1 = num1*10 + (c - '0');
-                else num2 = num2*10 + (c - '0');
+            // the pieces in file order, until the one where the declared counts are reached
+            std::vector<std::span<const csr_graph::edge_type>> buffers;
+            std::size_t edge_lines = 0;
+            std::size_t clique_lines = 0;
+
+            for (std::size_t i = 0; i < parts.size(); ++i) {
+                auto& part = parts[i];
+                const auto total_edges = edge_lines + part.edge_lines;
+                const auto total_cliques = clique_lines + part.clique_lines;
+
+                const bool reached = edge_lines <= declared.first && clique_lines <= declared.second
+                                  && total_edges >= declared.first && total_cliques >= declared.second;
+
+                // exactly at the last line read, nothing else in the piece counts
+                if (!part.error && total_edges == declared.first && total_cliques == declared.second) {
+                    buffers.emplace_back(part.edges);
+                    break;
+                }
+
+                // the stop (or the error) is somewhere inside the piece: parse it again, stopping there
+                if (part.error || reached) {
+                    const bool can_stop = edge_lines <= declared.first && clique_lines <= declared.second;
+                    const std::pair remaining(declared.first - edge_lines, declared.second - clique_lines);
+
+                    part = {};
+                    // throws again if the error comes before the stop
+                    if (parse_dimacs_lines(pieces[i], size, part, can_stop ? &remaining : nullptr)) {
+                        buffers.emplace_back(part.edges);
+                        break;
+                    }
+                }
+
+                buffers.emplace_back(part.edges);
+                edge_lines = total_edges;
+                clique_lines = total_cliques;
             }
+
+            return build(size, buffers);
         }
-    }
+    };
+}
 
-    return G;
+/* The text (the memory mapped file, or the chunks of a stream) is read in 2 steps:
+ *  - the lines before 'p' are read sequentially: 'c' is a comment, skip. Empty lines are skipped too
+ *  - line type 'p edge' is the graph node and edges count, parse only the third and fourth elements
+ *  - the body is split at line boundaries, one piece per thread (or chunk), and every thread parses its lines
+ *    into its own edge buffer:
+ *    - line type 'e' is and edge, parse only the second and third elements (node1 and node2)
+ *
+ *  We introduced a new extension to the DIMACS format, adding "p clique" problem type
+ *  In "p clique" we specify number of nodes, number of edges to read and number of cliques to read.
+ *  Then we add a new type of line 'q', that specify as second element the number n of nodes of the clique
+ *  and as the n elements if specify the nodes of a clique
+ *
+ *  Reading stops at the line where all the declared edges and cliques have been read (anything after it
+ *  is ignored): the pieces are parsed to the end, then the one where that line falls is parsed again up to it.
+ *  Every clique is expanded into its edges, the graph is built from all the buffers.
+ */
+inline csr_graph parse_dimacs_text(const std::string_view text) {
+    return parsing_detail::parse_whole(parsing_detail::dimacs_parser{}, text, parsing_detail::build_csr);
 }
 
 struct MTX_header {
@@ -226,180 +371,477 @@ struct MTX_header {
     }
 };
 
-// Garbage parser!
-// USE AT YOUR OWN RISK
-inline custom_graph parse_matrix_market(const std::string& filename, const bool complementary = false) {
-    // possible improvement: memory mapped files (mmap)
-
-    custom_graph G;
-
-    std::ifstream inf(filename);
-    char buf[0x2000];
-    bool first_char = true;
-    bool line_has_percentage = false;
-    int spaces = 0;
-    bool last_space_tab = false;
-    std::size_t num1 = 0;
-    std::size_t num2 = 0;
-    std::size_t num3 = 0;
-
-    MTX_header header;
-    bool header_read = false;
-    bool is_header = true;
-    bool metadata_read = false;
-    std::string header_tmp;
-
-
-    while (inf) {
-        inf.read(buf, sizeof(buf));
-        std::streamsize bytes_read = inf.gcount();
-        if (bytes_read <= 0) break;
-
-        for (int i = 0; i < bytes_read; ++i) {
-            auto c = buf[i];
-            if (c == '\r') continue;
-            if (c == '\n') {
-                if (line_has_percentage) {
-                    if (is_header && spaces == 4) {
-                        if (header_tmp == "general") header.symmetry = MTX_header::symmetry_enum::GENERAL;
-                        else if (header_tmp == "symmetric") header.symmetry = MTX_header::symmetry_enum::SYMMETRIC;
-                        else if (header_tmp == "skew-symmetric") header.symmetry = MTX_header::symmetry_enum::SKEW_SYMMETRIC;
-                        else if (header_tmp == "hermitian") header.symmetry = MTX_header::symmetry_enum::HERMITIAN;
-
-                        if (!header.is_valid()) {
-                            throw std::runtime_error("parse_matrix_market: invalid MTX header");
-                        }
-                        header_read = true;
-
-                        header_tmp.clear();
-                    }
-                } else if (metadata_read) {
-                    // TODO: improve
-                    if (num1 != num2) G.add_edge(num1-1, num2-1);
-                } else { // metadata line
-                    G.resize(num1);
-                    metadata_read = true;
-                }
+namespace parsing_detail {
+    inline bool equals_ignore_case(const std::string_view a, const std::string_view b) {
+        return std::ranges::equal(a, b, [](const char x, const char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+    }
+
+    // "%%MatrixMarket matrix coordinate <field> <symmetry>", the keywords are case insensitive
+    inline MTX_header parse_mtx_banner(const std::string_view line) {
+        MTX_header header;
+        std::size_t at = 0;
+        if (!equals_ignore_case(next_token(line, at), "%%MatrixMarket")) throw std::runtime_error("parse_matrix_market: missing %%MatrixMarket banner");
+
+        const auto object = next_token(line, at);
+        if (equals_ignore_case(object, "matrix")) header.object = MTX_header::object_enum::MATRIX;
+        else if (equals_ignore_case(object, "vector")) header.object = MTX_header::object_enum::VECTOR;
+
+        const auto format = next_token(line, at);
+        if (equals_ignore_case(format, "coordinate")) header.format = MTX_header::format_enum::COORDINATE;
+        else if (equals_ignore_case(format, "array")) header.format = MTX_header::format_enum::ARRAY;
+
+        const auto field = next_token(line, at);
+        if (equals_ignore_case(field, "real")) header.field = MTX_header::field_enum::REAL;
+        else if (equals_ignore_case(field, "double")) header.field = MTX_header::field_enum::DOUBLE;
+        else if (equals_ignore_case(field, "complex")) header.field = MTX_header::field_enum::COMPLEX;
+        else if (equals_ignore_case(field, "integer")) header.field = MTX_header::field_enum::INTEGER;
+        else if (equals_ignore_case(field, "pattern")) header.field = MTX_header::field_enum::PATTERN;
+
+        const auto symmetry = next_token(line, at);
+        if (equals_ignore_case(symmetry, "general")) header.symmetry = MTX_header::symmetry_enum::GENERAL;
+        else if (equals_ignore_case(symmetry, "symmetric")) header.symmetry = MTX_header::symmetry_enum::SYMMETRIC;
+        else if (equals_ignore_case(symmetry, "skew-symmetric")) header.symmetry = MTX_header::symmetry_enum::SKEW_SYMMETRIC;
+        else if (equals_ignore_case(symmetry, "hermitian")) header.symmetry = MTX_header::symmetry_enum::HERMITIAN;
+
+        if (!header.is_valid()) throw std::runtime_error("parse_matrix_market: invalid MTX header");
+        // a dense array has no structure to read a graph from
+        if (header.object != MTX_header::object_enum::MATRIX || header.format != MTX_header::format_enum::COORDINATE) {
+            throw std::runtime_error("parse_matrix_market: only coordinate matrices are graphs");
+        }
+
+        return header;
+    }
 
-                first_char = true;
-                line_has_percentage = false;
-                spaces = 0;
-                last_space_tab = false;
-                is_header = !header_read;
-                num1 = 0;
-                num2 = 0;
-                num3 = 0;
-                continue;
+    // value tokens after "i j" in an entry
+    inline std::size_t mtx_values(const MTX_header& header) {
+        switch (header.field) {
+            case MTX_header::field_enum::PATTERN: return 0;
+            case MTX_header::field_enum::COMPLEX: return 2;
+            default: return 1;
+        }
+    }
+
+    struct mtx_part {
+        std::vector<csr_graph::edge_type> edges;
+        std::size_t entries = 0;
+        std::exception_ptr error;
+    };
+
+    // entries "i j [values]" of text into part: every stored entry is an edge, whatever its value
+    // (weights are checked to be numbers and dropped). '%' lines and empty lines are skipped
+    inline void parse_mtx_entries(const std::string_view text, const std::size_t size, const std::size_t values, mtx_part& part) {
+        for (std::size_t pos = 0; pos < text.size();) {
+            const auto line = next_line(text, pos);
+            std::size_t at = 0;
+            const auto first = next_token(line, at);
+            if (first.empty() || first.front() == '%') continue;
+
+            const auto i = to_vertex(first, size, "parse_matrix_market: wrong entry");
+            const auto j = to_vertex(next_token(line, at), size, "parse_matrix_market: wrong entry");
+            for (std::size_t k = 0; k < values; ++k) {
+                double value;
+                const auto token = next_token(line, at);
+                const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+                if (token.empty() || ec != std::errc() || end != token.data() + token.size()) throw std::runtime_error("parse_matrix_market: wrong value");
             }
+            if (!next_token(line, at).empty()) throw std::runtime_error("parse_matrix_market: too many values in entry");
+
+            part.entries++;
+            // the diagonal would be a self loop. general matrices may store both (i,j) and (j,i), csr_graph drops the copy
+            if (i != j) part.edges.emplace_back(i, j);
+        }
+    }
 
-            // skip spaces/tabs
-            if ((c == ' ' || c == '\t')) {
-                if (!last_space_tab) {
-                    if (line_has_percentage) {
-                        if (header_read) continue;
-                        switch (spaces) {
-                            case 0:
-                                if (header_tmp != "MatrixMarket") is_header = false;
-                                header_tmp.clear();
-                                break;
-                            case 1:
-                                if (!is_header) continue;
-
-                                if (header_tmp == "matrix") header.object = MTX_header::object_enum::MATRIX;
-                                else if (header_tmp == "vector") header.object = MTX_header::object_enum::VECTOR;
-
-                                header_tmp.clear();
-                                break;
-                            case 2:
-                                if (!is_header) continue;
-
-                                if (header_tmp == "coordinate") header.format = MTX_header::format_enum::COORDINATE;
-                                else if (header_tmp == "array") header.format = MTX_header::format_enum::ARRAY;
-
-                                header_tmp.clear();
-                                break;
-                            case 3:
-                                if (!is_header) continue;
-
-                                if (header_tmp == "real") header.field= MTX_header::field_enum::REAL;
-                                else if (header_tmp == "double") header.field= MTX_header::field_enum::DOUBLE;
-                                else if (header_tmp == "complex") header.field= MTX_header::field_enum::COMPLEX;
-                                else if (header_tmp == "integer") header.field= MTX_header::field_enum::INTEGER;
-                                else if (header_tmp == "pattern") header.field= MTX_header::field_enum::PATTERN;
-
-                                header_tmp.clear();
-                                break;
-                        }
-                    } else if (metadata_read) {
-
-                    } else { // metadata line
+    struct mtx_parser {
+        using part = mtx_part;
 
-                    }
-                    spaces++;
-                    last_space_tab = true;
+        MTX_header banner;
+        std::size_t size = 0;
+        std::size_t entries = 0;
+
+        // banner, '%' comments, then "rows cols entries". blank lines before the banner are skipped, as sniff_format does
+        std::optional<std::size_t> header(const std::string_view text, const bool end) {
+            std::size_t pos = 0;
+            for (;;) {
+                if (pos == text.size()) {
+                    if (!end) return std::nullopt;
+                    throw std::runtime_error("parse_matrix_market: missing %%MatrixMarket banner");
                 }
-                continue;
+                const auto line = next_line(text, pos);
+                if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+                banner = parse_mtx_banner(line);
+                break;
             }
 
-            if (first_char) {
-                first_char = false;
-                last_space_tab = false;
+            for (;;) {
+                if (pos == text.size()) {
+                    if (!end) return std::nullopt;
+                    throw std::runtime_error("parse_matrix_market: missing size line");
+                }
+
+                const auto line = next_line(text, pos);
+                std::size_t at = 0;
+                const auto rows = next_token(line, at);
+                if (rows.empty() || rows.front() == '%') continue;
 
-                if (c == '%') {
-                    line_has_percentage = true;
-                } else {
-                    num1 = c - '0';
+                size = to_number(rows, "parse_matrix_market: wrong size line");
+                if (to_number(next_token(line, at), "parse_matrix_market: wrong size line") != size) {
+                    throw std::runtime_error("parse_matrix_market: the matrix is not square");
                 }
+                entries = to_number(next_token(line, at), "parse_matrix_market: wrong size line");
+                return pos;
+            }
+        }
 
-                continue;
+        void parse(const std::string_view piece, part& part) const {
+            parse_mtx_entries(piece, size, mtx_values(banner), part);
+        }
+
+        template <typename Build>
+        auto finish(const std::vector<part>& parts, const std::vector<std::string_view>&, const Build& build) const {
+            std::vector<std::span<const csr_graph::edge_type>> buffers;
+            std::size_t read = 0;
+            for (const auto& part : parts) {
+                // the first error in the file
+                if (part.error) std::rethrow_exception(part.error);
+                buffers.emplace_back(part.edges);
+                read += part.entries;
             }
+            if (read != entries) throw std::runtime_error("parse_matrix_market: " + std::to_string(read) + " entries, " + std::to_string(entries) + " declared");
+
+            return build(size, buffers);
+        }
+    };
+}
+
+// banner, '%' comments, then "rows cols entries" and the entries, one per line.
+// rows must be equal to cols, the graph has an edge {i,j} for every stored (i,j) whatever the symmetry
+// (symmetric/skew-symmetric/hermitian ones store the lower triangle only, general ones both triangles).
+// the entries are split at line boundaries, one piece per thread (or chunk), each into its own edge buffer
+inline csr_graph parse_matrix_market_text(const std::string_view text) {
+    return parsing_detail::parse_whole(parsing_detail::mtx_parser{}, text, parsing_detail::build_csr);
+}
+
+namespace parsing_detail {
+    // vertex id as written in the file (0 or 1-based, not known yet)
+    inline csr_graph::vertex_type to_id(const std::string_view token, const char* error) {
+        const auto id = to_number(token, error);
+        if (id >= std::numeric_limits<csr_graph::vertex_type>::max()) throw std::runtime_error(error);
+        return static_cast<csr_graph::vertex_type>(id);
+    }
+
+    struct edge_list_part {
+        std::vector<csr_graph::edge_type> edges;
+        csr_graph::vertex_type max_id = 0;
+        bool zero = false; // vertex 0 appears
+        std::exception_ptr error;
+    };
+
+    // "u v [anything]" lines of text into part, the ids as they are. '#' and '%' lines and empty lines are skipped
+    inline void parse_edge_list_lines(const std::string_view text, edge_list_part& part) {
+        for (std::size_t pos = 0; pos < text.size();) {
+            const auto line = next_line(text, pos);
+            std::size_t at = 0;
+            const auto first = next_token(line, at);
+            if (first.empty() || first.front() == '#' || first.front() == '%') continue;
+
+            const auto u = to_id(first, "parse_edge_list: wrong edge");
+            const auto v = to_id(next_token(line, at), "parse_edge_list: wrong edge");
+            part.max_id = std::max({part.max_id, u, v});
+            part.zero |= u == 0 || v == 0;
+            part.edges.emplace_back(u, v);
+        }
+    }
 
-            last_space_tab = false;
+    struct metis_format {
+        bool vertex_sizes = false;
+        std::size_t vertex_weights = 0;
+        bool edge_weights = false;
+    };
 
-            if (line_has_percentage) {
-                if (header_tmp.empty() && c == '%') continue;
+    struct metis_part {
+        std::vector<csr_graph::edge_type> edges; // (row in the part, neighbour)
+        std::size_t rows = 0;
+        std::size_t used_rows = 0; // up to the last non empty row
+        std::size_t entries = 0;
+        std::exception_ptr error;
+    };
 
-                if (is_header) header_tmp += c;
-            } else if (metadata_read) {
-                if (spaces == 0) num1 = num1*10 + (c - '0');
-                else if (spaces == 1) num2 = num2*10 + (c - '0');
-                else if (spaces == 2) num3 = num3*10 + (c - '0');
-            } else { // metadata line
-                if (spaces == 0) num1 = num1*10 + (c - '0');
-                else if (spaces == 1) num2 = num2*10 + (c - '0');
-                else if (spaces == 2) num3 = num3*10 + (c - '0');
+    // vertex lines of text into part: every line that isn't a '%' comment is the next vertex, an empty one has no
+    // neighbours. the rows are counted from the start of text, the caller adds the rows of the pieces before it
+    inline void parse_metis_lines(const std::string_view text, const std::size_t size, const metis_format& format, metis_part& part) {
+        for (std::size_t pos = 0; pos < text.size();) {
+            const auto line = next_line(text, pos);
+            std::size_t at = 0;
+            auto token = next_token(line, at);
+            if (!token.empty() && token.front() == '%') continue;
+
+            const auto row = static_cast<csr_graph::vertex_type>(part.rows++);
+            if (token.empty()) continue;
+            part.used_rows = part.rows;
+
+            for (std::size_t k = format.vertex_sizes + format.vertex_weights; k > 0; --k) {
+                to_number(token, "parse_metis: wrong vertex weight");
+                token = next_token(line, at);
+            }
+            for (; !token.empty(); token = next_token(line, at)) {
+                part.edges.emplace_back(row, to_vertex(token, size, "parse_metis: wrong neighbour"));
+                if (format.edge_weights) to_number(next_token(line, at), "parse_metis: wrong edge weight");
+                part.entries++;
             }
         }
     }
 
-    if (complementary) G.complement();
+    struct edge_list_parser {
+        using part = edge_list_part;
 
-    return G;
-}
+        // no header, comments are skipped with the edges
+        std::optional<std::size_t> header(const std::string_view, const bool) const {
+            return 0;
+        }
 
-inline custom_graph parse_graph(const std::string& filename, const bool complementary = false) {
-    // list of parser attempts
-    using parser_t = custom_graph(*)(const std::string&, bool);
+        void parse(const std::string_view piece, part& part) const {
+            parse_edge_list_lines(piece, part);
+        }
+
+        template <typename Build>
+        auto finish(std::vector<part>& parts, const std::vector<std::string_view>&, const Build& build) const {
+            csr_graph::vertex_type max_id = 0;
+            bool zero = false;
+            bool empty = true;
+            for (const auto& part : parts) {
+                // the first error in the file
+                if (part.error) std::rethrow_exception(part.error);
+                max_id = std::max(max_id, part.max_id);
+                zero |= part.zero;
+                empty &= part.edges.empty();
+            }
+            if (empty) return build(0, edge_buffers());
+
+            // 1-based: every id goes down by one, still a buffer per thread
+            if (!zero) {
+                parse_parts(parts.size(), [&](const std::size_t i) {
+                    for (auto& [u, v] : parts[i].edges) --u, --v;
+                });
+            }
 
-    static const parser_t parsers[] = {
-        &parse_dimacs_extended,
-        &parse_matrix_market
+            std::vector<std::span<const csr_graph::edge_type>> buffers;
+            for (const auto& part : parts) buffers.emplace_back(part.edges);
+            return build(static_cast<std::size_t>(max_id) + zero, buffers);
+        }
     };
 
-    std::vector<std::string> errors;
+    struct metis_parser {
+        using part = metis_part;
 
-    for (auto p : parsers) {
-        try {
-            return p(filename, complementary);
-        } catch (const std::exception& e) {
-            errors.emplace_back(e.what());
+        std::size_t size = 0;
+        std::size_t edges = 0;
+        metis_format format;
+
+        // '%' comments, then "n m [fmt [ncon]]"
+        std::optional<std::size_t> header(const std::string_view text, const bool end) {
+            for (std::size_t pos = 0;;) {
+                if (pos == text.size()) {
+                    if (!end) return std::nullopt;
+                    throw std::runtime_error("parse_metis: missing header");
+                }
+
+                const auto line = next_line(text, pos);
+                std::size_t at = 0;
+                const auto first = next_token(line, at);
+                if (first.empty() || first.front() == '%') continue;
+
+                size = to_number(first, "parse_metis: wrong header");
+                if (size >= std::numeric_limits<csr_graph::vertex_type>::max()) throw std::runtime_error("parse_metis: too many vertices");
+                edges = to_number(next_token(line, at), "parse_metis: wrong header");
+
+                if (const auto fmt = next_token(line, at); !fmt.empty()) {
+                    if (fmt.size() > 3 || fmt.find_first_not_of("01") != std::string_view::npos) throw std::runtime_error("parse_metis: wrong fmt");
+                    const auto digit = [&](const std::size_t i) { return i < fmt.size() && fmt[fmt.size()-1 - i] == '1'; };
+                    format.edge_weights = digit(0);
+                    format.vertex_weights = digit(1);
+                    format.vertex_sizes = digit(2);
+                }
+                if (const auto ncon = next_token(line, at); !ncon.empty()) {
+                    format.vertex_weights = format.vertex_weights ? to_number(ncon, "parse_metis: wrong header") : 0;
+                }
+                return pos;
+            }
+        }
+
+        void parse(const std::string_view piece, part& part) const {
+            parse_metis_lines(piece, size, format, part);
+        }
+
+        template <typename Build>
+        auto finish(std::vector<part>& parts, const std::vector<std::string_view>&, const Build& build) const {
+            std::vector<std::size_t> first_row(parts.size());
+            std::size_t rows = 0;
+            std::size_t entries = 0;
+            for (std::size_t i = 0; i < parts.size(); ++i) {
+                const auto& part = parts[i];
+                // the first error in the file
+                if (part.error) std::rethrow_exception(part.error);
+                // empty lines after the last vertex are fine
+                if (part.used_rows > 0 && rows + part.used_rows > size) throw std::runtime_error("parse_metis: more vertex lines than vertices");
+                first_row[i] = rows;
+                rows += part.rows;
+                entries += part.entries;
+            }
+            if (rows < size) throw std::runtime_error("parse_metis: " + std::to_string(rows) + " vertex lines, " + std::to_string(size) + " vertices");
+            if (entries != 2*edges) throw std::runtime_error("parse_metis: " + std::to_string(entries) + " neighbours, " + std::to_string(2*edges) + " expected");
+
+            parse_parts(parts.size(), [&](const std::size_t i) {
+                for (auto& [u, v] : parts[i].edges) u += static_cast<csr_graph::vertex_type>(first_row[i]);
+            });
+
+            std::vector<std::span<const csr_graph::edge_type>> buffers;
+            for (const auto& part : parts) buffers.emplace_back(part.edges);
+            return build(size, buffers);
+        }
+    };
+}
+
+// whitespace separated edges "u v", one per line, as SNAP and most graph collections write them: any other column
+// (weights, timestamps) is ignored, '#' and '%' lines are comments. the ids are 0-based if vertex 0 appears,
+// 1-based otherwise, and the graph has max id (+1 if 0-based) vertices. the lines are split at line boundaries,
+// one piece per thread (or chunk), each into its own edge buffer
+inline csr_graph parse_edge_list_text(const std::string_view text) {
+    return parsing_detail::parse_whole(parsing_detail::edge_list_parser{}, text, parsing_detail::build_csr);
+}
+
+/* METIS graph file:
+ *  - '%' lines are comments
+ *  - the header is "n m [fmt [ncon]]": n vertices, m edges. fmt (up to 3 digits) tells whether every vertex line
+ *    starts with its size (hundreds) and ncon weights (tens, one weight if ncon is missing), and whether every
+ *    neighbour is followed by the weight of the edge (units). weights are checked to be numbers and dropped
+ *  - then a line per vertex, with the 1-based neighbours (an empty line is a vertex with none)
+ *
+ *  Every edge is listed by both its ends, so 2m neighbours are expected.
+ *  The vertex lines are split at line boundaries, one piece per thread (or chunk): each piece numbers its rows
+ *  from 0 and they are moved to their place once the rows of the pieces before it are known.
+ */
+inline csr_graph parse_metis_text(const std::string_view text) {
+    return parsing_detail::parse_whole(parsing_detail::metis_parser{}, text, parsing_detail::build_csr);
+}
+
+enum class graph_format { DIMACS, MATRIX_MARKET, EDGE_LIST, METIS };
+
+// from the header: MatrixMarket starts with its "%%MatrixMarket" banner, DIMACS with 'c' or 'p' lines, edge lists
+// with numbers or '#'/'%' comments. METIS looks like an edge list, it's told apart by the name (.graph or .metis,
+// also followed by .gz)
+inline graph_format sniff_format(const std::string_view text, std::string_view name = {}) {
+    const auto first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return graph_format::DIMACS;
+
+    constexpr std::string_view banner = "%%MatrixMarket";
+    if (parsing_detail::equals_ignore_case(text.substr(first, banner.size()), banner)) return graph_format::MATRIX_MARKET;
+
+    if (name.ends_with(".gz")) name.remove_suffix(3);
+    if (name.ends_with(".graph") || name.ends_with(".metis")) return graph_format::METIS;
+
+    const auto c = text[first];
+    if (c == '#' || c == '%' || std::isdigit(static_cast<unsigned char>(c))) return graph_format::EDGE_LIST;
+    return graph_format::DIMACS;
+}
+
+namespace parsing_detail {
+    // fn(parser) with the parser of format
+    template <typename Fn>
+    auto with_parser(const graph_format format, Fn&& fn) {
+        switch (format) {
+            case graph_format::MATRIX_MARKET: return fn(mtx_parser{});
+            case graph_format::EDGE_LIST: return fn(edge_list_parser{});
+            case graph_format::METIS: return fn(metis_parser{});
+            case graph_format::DIMACS: break;
+        }
+        return fn(dimacs_parser{});
+    }
+
+    // the graph in the bytes of in (gzip compressed or not), in the given format or the one sniffed from the header
+    template <typename Build>
+    auto parse_stream(byte_reader in, const std::string_view name, const std::optional<graph_format> format, const Build& build) {
+        std::string text;
+        bool end = false;
+        while (!end && text.size() < 2) end = !read_more(in, text, stream_chunk_bytes);
+
+        if (is_gzip(text)) {
+            in = gunzip_reader(prefix_reader(std::move(text), std::move(in)));
+            text = {};
+            end = false;
+        }
+
+        // the first non blank character and the banner that may follow it
+        constexpr std::size_t banner_bytes = 14;
+        for (auto first = text.find_first_not_of(" \t\r\n"); !end && (first == std::string::npos || text.size() < first + banner_bytes);) {
+            end = !read_more(in, text, stream_chunk_bytes);
+            first = text.find_first_not_of(" \t\r\n");
+        }
+
+        return with_parser(format.value_or(sniff_format(text, name)), [&](auto parser) {
+            return parse_chunks(parser, in, std::move(text), end, build);
+        });
+    }
+
+    // filename is "-" for stdin. a regular file is mapped and parsed all at once (unless it's compressed),
+    // anything else (stdin, a named pipe) is parsed as it arrives
+    template <typename Build>
+    auto parse_input(const std::string& filename, const std::optional<graph_format> format, const Build& build) {
+        std::error_code ec;
+        if (filename == "-" || !std::filesystem::is_regular_file(filename, ec)) {
+            return parse_stream(file_reader(filename), filename == "-" ? std::string_view() : filename, format, build);
         }
+
+        const mapped_file file(filename);
+        if (is_gzip(file.view())) return parse_stream(view_reader(file.view()), filename, format, build);
+        return with_parser(format.value_or(sniff_format(file.view(), filename)), [&](auto parser) {
+            return parse_whole(parser, file.view(), build);
+        });
     }
+}
+
+inline csr_graph parse_text(const std::string_view text, const std::string_view name = {}) {
+    return parsing_detail::with_parser(sniff_format(text, name), [&](auto parser) {
+        return parsing_detail::parse_whole(parser, text, parsing_detail::build_csr);
+    });
+}
+
+// every file parser takes "-" for stdin, named pipes, and gzip compressed files
+
+inline csr_graph parse_dimacs_extended(const std::string& filename) {
+    return parsing_detail::parse_input(filename, graph_format::DIMACS, parsing_detail::build_csr);
+}
 
-    // If we reach this point, all failed
-    std::string msg = "parse_graph: all parsing attempts failed:\n";
-    for (auto& e : errors)
-        msg += "  - " + e + "\n";
+inline csr_graph parse_matrix_market(const std::string& filename) {
+    return parsing_detail::parse_input(filename, graph_format::MATRIX_MARKET, parsing_detail::build_csr);
+}
+
+inline csr_graph parse_edge_list(const std::string& filename) {
+    return parsing_detail::parse_input(filename, graph_format::EDGE_LIST, parsing_detail::build_csr);
+}
+
+inline csr_graph parse_metis(const std::string& filename) {
+    return parsing_detail::parse_input(filename, graph_format::METIS, parsing_detail::build_csr);
+}
+
+// the format is chosen from the file header (and name), the file is read once
+inline csr_graph parse_sparse_graph(const std::string& filename) {
+    return parsing_detail::parse_input(filename, std::nullopt, parsing_detail::build_csr);
+}
+
+// the bit matrix when dense(size) (the number of vertices, known once the file is read), the csr_graph otherwise.
+// only one of them is built, from the edge buffers of the parser threads
+template <typename Dense>
+std::variant<custom_graph, csr_graph> parse_any_graph(const std::string& filename, const Dense& dense) {
+    return parsing_detail::parse_input(filename, std::nullopt, [&](const std::size_t size, const parsing_detail::edge_buffers buffers) {
+        if (dense(size)) return std::variant<custom_graph, csr_graph>(std::in_place_type<custom_graph>, size, buffers);
+        return std::variant<custom_graph, csr_graph>(std::in_place_type<csr_graph>, size, buffers);
+    });
+}
 
-    throw std::runtime_error(msg);
+// bit matrix of the graph (of its complement for MISP)
+inline custom_graph parse_graph(const std::string& filename, const bool complementary = false) {
+    auto G = parsing_detail::parse_input(filename, std::nullopt, parsing_detail::build_dense);
+    if (complementary) G.complement();
+    return G;
 }
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// free resources of one kind kept by a worker, used by that worker only (held is read by anyone, for statistics)
+struct resource_cache {
+    std::vector<std::uint32_t> free;
+    std::atomic_size_t held = 0;
+};
+
+/* Objects of type R, all built as R(arg) and known by their index, borrowed and given back by any thread:
+ *  - the objects live in chunks of doubling size that never move, so get() needs no lock while the pool grows.
+ *    the growth is the only locked path, and happens only when no free object is left
+ *  - the free objects are a Treiber stack of indices, the head tagged with a counter against ABA
+ *  - a worker can go through its own resource_cache: it borrows from and gives back to its cache, refilled and
+ *    emptied a batch at a time (one CAS per batch) from the shared stack
+ */
+template<typename R>
+class resource_pool {
+    static constexpr std::size_t first_chunk = 64;  // chunk k holds first_chunk << k objects
+    static constexpr std::size_t max_chunks = 32;
+    static constexpr std::uint32_t batch = 8;
+    static constexpr std::uint32_t none = UINT32_MAX;
+
+    struct node {
+        R value;
+        std::atomic<std::uint32_t> next = none;
+
+        explicit node(const std::size_t arg) : value(arg) {}
+    };
+
+    const std::size_t arg;
+    std::array<std::atomic<node*>, max_chunks> chunks{};
+    std::atomic<std::uint32_t> created = 0;
+    std::mutex grow;
+    // low 32 bits: first free index, high 32 bits: pushes and pops so far
+    std::atomic<std::uint64_t> head = none;
+
+    static std::size_t chunk_of(const std::size_t index) {
+        return std::bit_width(index / first_chunk + 1) - 1;
+    }
+
+    static std::size_t chunk_start(const std::size_t chunk) {
+        return first_chunk * ((std::size_t{1} << chunk) - 1);
+    }
+
+    node& at(const std::size_t index) const {
+        const auto chunk = chunk_of(index);
+        return chunks[chunk].load(std::memory_order_acquire)[index - chunk_start(chunk)];
+    }
+
+    static std::uint64_t tagged(const std::uint64_t old, const std::uint32_t index) {
+        return ((old >> 32) + 1) << 32 | index;
+    }
+
+    std::uint32_t create() {
+        std::lock_guard lg(grow);
+        const auto index = created.load(std::memory_order_relaxed);
+        const auto chunk = chunk_of(index);
+        if (index == chunk_start(chunk)) {
+            chunks[chunk].store(std::allocator<node>().allocate(first_chunk << chunk), std::memory_order_release);
+        }
+        std::construct_at(&at(index), arg);
+        created.store(index + 1, std::memory_order_relaxed);
+        return index;
+    }
+
+    // first ... last already linked
+    void push(const std::uint32_t first, const std::uint32_t last) {
+        auto old = head.load(std::memory_order_relaxed);
+        do {
+            at(last).next.store(static_cast<std::uint32_t>(old), std::memory_order_release);
+        } while (!head.compare_exchange_weak(old, tagged(old, first), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // up to count indices, linked from the one returned. count becomes the number taken.
+    // a stale walk is harmless, the CAS fails if anyone pushed or popped in the meantime (the links are released
+    // by the pushers, so even a stale one is an index whose chunk is visible)
+    std::uint32_t pop(std::uint32_t& count) {
+        auto old = head.load(std::memory_order_acquire);
+        std::uint32_t taken;
+        std::uint32_t next;
+        do {
+            taken = 0;
+            next = static_cast<std::uint32_t>(old);
+            while (taken < count && next != none) {
+                next = at(next).next.load(std::memory_order_acquire);
+                ++taken;
+            }
+        } while (taken > 0 && !head.compare_exchange_weak(old, tagged(old, next), std::memory_order_acquire, std::memory_order_acquire));
+
+        count = taken;
+        return static_cast<std::uint32_t>(old);
+    }
+
+public:
+    explicit resource_pool(const std::size_t arg) : arg(arg) {}
+
+    resource_pool(const resource_pool&) = delete;
+    resource_pool& operator=(const resource_pool&) = delete;
+
+    ~resource_pool() {
+        const auto size = created.load(std::memory_order_relaxed);
+        for (std::size_t chunk = 0; chunk < max_chunks && chunk_start(chunk) < size; ++chunk) {
+            auto* objects = chunks[chunk].load(std::memory_order_relaxed);
+            std::destroy_n(objects, std::min(first_chunk << chunk, size - chunk_start(chunk)));
+            std::allocator<node>().deallocate(objects, first_chunk << chunk);
+        }
+    }
+
+    // builds count objects up front, free for anyone
+    void reserve(const std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto index = create();
+            push(index, index);
+        }
+    }
+
+    std::size_t size() const {
+        return created.load(std::memory_order_relaxed);
+    }
+
+    void prepare(resource_cache& cache) const {
+        cache.free.reserve(2*batch);
+    }
+
+    std::size_t borrow(resource_cache* cache) {
+        if (!cache) {
+            std::uint32_t count = 1;
+            const auto index = pop(count);
+            return count > 0 ? index : create();
+        }
+
+        if (cache->free.empty()) {
+            auto count = batch;
+            for (auto index = pop(count); count > 0; --count) {
+                cache->free.push_back(index);
+                index = at(index).next.load(std::memory_order_acquire);
+            }
+        }
+        if (cache->free.empty()) return create();
+
+        const auto index = cache->free.back();
+        cache->free.pop_back();
+        cache->held.store(cache->free.size(), std::memory_order_relaxed);
+        return index;
+    }
+
+    void give_back(const std::size_t index, resource_cache* cache) {
+        assert(index < size());
+        const auto free = static_cast<std::uint32_t>(index);
+        if (!cache) {
+            push(free, free);
+            return;
+        }
+
+        cache->free.push_back(free);
+        if (cache->free.size() == 2*batch) {
+            // the oldest half goes back to the others, linked here and pushed at once
+            for (std::uint32_t i = 0; i+1 < batch; ++i) {
+                at(cache->free[i]).next.store(cache->free[i+1], std::memory_order_release);
+            }
+            push(cache->free[0], cache->free[batch-1]);
+            cache->free.erase(cache->free.begin(), cache->free.begin() + batch);
+        }
+        cache->held.store(cache->free.size(), std::memory_order_relaxed);
+    }
+
+    R& get(const std::size_t index) {
+        assert(index < size());
+        return at(index).value;
+    }
+};
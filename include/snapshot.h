@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "csr_graph.h"
+#include "custom_graph.h"
+#include "mapped_file.h"
+
+// binary snapshot of a parsed graph, written by `CliSAT convert`: a header with the statistics printed
+// at startup, then page aligned sections with either the bit matrix (the custom_graph slab as it is in
+// memory) or the two csr_graph arrays, and optionally an ordering (order[new] = input vertex) with the
+// sorting method it was made with. the bit matrix is loaded by mapping the file copy-on-write and
+// pointing the rows at it: no parsing and no copy, pages are read in as the solver touches them
+namespace snapshot {
+    inline constexpr std::array<char, 8> magic = {'C', 'L', 'I', 'S', 'A', 'T', 'S', 'N'};
+    inline constexpr std::uint32_t version = 1;
+    // sections start on a page, so the slab is as aligned as an allocated one
+    inline constexpr std::uint64_t section_alignment = 4096;
+    inline constexpr std::uint32_t block_bits = std::numeric_limits<custom_bitset::block_type>::digits;
+
+    enum class kind : std::uint32_t { matrix, csr };
+
+    struct stats {
+        std::uint64_t size = 0;
+        std::uint64_t n_edges = 0;
+        double density = 0;
+        std::uint64_t degeneracy = 0;
+        std::uint64_t max_degree = 0;
+    };
+
+    template <typename Graph>
+    [[nodiscard]] stats stats_of(const Graph& G) {
+        return {G.size(), G.get_n_edges(), G.get_density(), G.get_degeneracy(), G.get_max_degree()};
+    }
+
+    struct header {
+        std::array<char, 8> magic = snapshot::magic;
+        std::uint32_t version = snapshot::version;
+        kind type = kind::matrix;
+        stats graph;
+        // SORTING_METHOD of the ordering, -1 without one
+        std::int32_t ordering_method = -1;
+        std::uint32_t block_bits = snapshot::block_bits;
+        std::uint64_t stride = 0; // blocks per row of the bit matrix
+        // matrix: the slab. csr: the offsets, then the adjacency
+        std::uint64_t data_offset = 0;
+        std::uint64_t data_bytes = 0;
+        std::uint64_t adjacency_offset = 0;
+        std::uint64_t adjacency_bytes = 0;
+        std::uint64_t ordering_offset = 0;
+    };
+
+    inline std::uint64_t align(const std::uint64_t offset) {
+        return (offset + section_alignment-1) / section_alignment * section_alignment;
+    }
+
+    // true if filename starts with the snapshot magic (any version). stdin and pipes are never snapshots:
+    // they can't be read twice
+    [[nodiscard]] inline bool is_snapshot(const std::string& filename) {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(filename, ec)) return false;
+        std::ifstream inf(filename, std::ios::binary);
+        std::array<char, 8> start{};
+        return inf.read(start.data(), start.size()) && start == magic;
+    }
+
+    namespace detail {
+        inline void write_section(std::ofstream& out, const std::uint64_t offset, const void* data, const std::uint64_t bytes) {
+            out.seekp(static_cast<std::streamoff>(offset));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        }
+
+        inline void write(const std::string& filename, header& h, std::span<const std::size_t> ordering,
+                          const void* data, const void* adjacency) {
+            std::uint64_t end = align(sizeof(header));
+            h.data_offset = end;
+            end = align(end + h.data_bytes);
+            if (h.adjacency_bytes) {
+                h.adjacency_offset = end;
+                end = align(end + h.adjacency_bytes);
+            }
+            if (h.ordering_method >= 0) h.ordering_offset = end;
+
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("snapshot: cannot write " + filename);
+
+            write_section(out, 0, &h, sizeof(header));
+            write_section(out, h.data_offset, data, h.data_bytes);
+            if (h.adjacency_bytes) write_section(out, h.adjacency_offset, adjacency, h.adjacency_bytes);
+            if (h.ordering_method >= 0) {
+                const std::vector<std::uint64_t> order(ordering.begin(), ordering.end());
+                write_section(out, h.ordering_offset, order.data(), order.size() * sizeof(std::uint64_t));
+            }
+
+            if (!out) throw std::runtime_error("snapshot: cannot write " + filename);
+        }
+    }
+
+    // the bit matrix of G, with ordering (of G.size() vertices) if ordering_method >= 0
+    inline void write(const std::string& filename, const custom_graph& G, const stats& graph, std::span<const std::size_t> ordering = {}, const int ordering_method = -1) {
+        header h;
+        h.type = kind::matrix;
+        h.graph = graph;
+        h.ordering_method = ordering_method;
+        h.stride = G.stride();
+        h.data_bytes = G.size() * G.stride() * sizeof(custom_bitset::block_type);
+        detail::write(filename, h, ordering, G.data(), nullptr);
+    }
+
+    inline void write(const std::string& filename, const csr_graph& S, const stats& graph) {
+        header h;
+        h.type = kind::csr;
+        h.graph = graph;
+        h.data_bytes = S.offsets().size_bytes();
+        h.adjacency_bytes = S.adjacency().size_bytes();
+        detail::write(filename, h, {}, S.offsets().data(), S.adjacency().data());
+    }
+
+    class file {
+        std::shared_ptr<mapped_file> _file;
+        header _header;
+
+        template <typename T>
+        [[nodiscard]] const T* section(const std::uint64_t offset, const std::uint64_t bytes) const {
+            if (offset > _file->size() || bytes > _file->size() - offset || bytes % sizeof(T)) throw std::runtime_error("snapshot: truncated file");
+            return reinterpret_cast<const T*>(_file->view().data() + offset);
+        }
+
+    public:
+        explicit file(const std::string& filename);
+
+        [[nodiscard]] bool is_sparse() const noexcept { return _header.type == kind::csr; }
+        [[nodiscard]] const stats& graph_stats() const noexcept { return _header.graph; }
+        [[nodiscard]] int ordering_method() const noexcept { return _header.ordering_method; }
+
+        // the bit matrix over the mapping, only for !is_sparse()
+        [[nodiscard]] custom_graph graph() const;
+        // the arrays are copied, the solver reorders the csr_graph in place
+        [[nodiscard]] csr_graph sparse_graph() const;
+        // empty when ordering_method() < 0
+        [[nodiscard]] std::vector<std::size_t> ordering() const;
+    };
+
+    inline file::file(const std::string& filename) : _file(std::make_shared<mapped_file>(filename, true)) {
+        if (_file->size() < sizeof(header)) throw std::runtime_error("snapshot: truncated file");
+        std::memcpy(&_header, _file->view().data(), sizeof(header));
+
+        if (_header.magic != magic) throw std::runtime_error("snapshot: not a snapshot");
+        if (_header.version != version) throw std::runtime_error("snapshot: version " + std::to_string(_header.version) + ", this build reads version " + std::to_string(version));
+        if (_header.block_bits != block_bits) throw std::runtime_error("snapshot: written with another block size");
+    }
+
+    inline custom_graph file::graph() const {
+        if (is_sparse()) throw std::runtime_error("snapshot: no bit matrix in a csr snapshot");
+
+        const auto size = _header.graph.size;
+        if (_header.data_bytes != size * _header.stride * sizeof(custom_bitset::block_type)) throw std::runtime_error("snapshot: wrong matrix size");
+        const auto slab = section<custom_bitset::block_type>(_header.data_offset, _header.data_bytes);
+
+        // the mapping is page aligned, a file read into memory (no mmap) may not be: then the rows get their own copy
+        if (reinterpret_cast<std::uintptr_t>(slab) % 64) {
+            custom_graph G(size);
+            for (std::size_t v = 0; v < size; ++v)
+                for (std::size_t b = 0; b < _header.stride; ++b)
+                    for (auto bits = slab[v*_header.stride + b]; bits; bits &= bits-1)
+                        G[v].set(b*block_bits + std::countr_zero(bits));
+            return G;
+        }
+
+        return custom_graph::borrow(const_cast<custom_bitset::block_type*>(slab), size, _header.stride, _file);
+    }
+
+    inline csr_graph file::sparse_graph() const {
+        if (!is_sparse()) throw std::runtime_error("snapshot: no csr_graph in a matrix snapshot");
+
+        const auto size = _header.graph.size;
+        if (size >= _file->size() / sizeof(csr_graph::size_type) || _header.data_bytes != (size+1) * sizeof(csr_graph::size_type)) throw std::runtime_error("snapshot: wrong offsets size");
+        const auto offsets = section<csr_graph::size_type>(_header.data_offset, _header.data_bytes);
+        const auto adjacency = section<csr_graph::vertex_type>(_header.adjacency_offset, _header.adjacency_bytes);
+        const auto n_adjacency = _header.adjacency_bytes / sizeof(csr_graph::vertex_type);
+
+        // the csr_graph accessors only assert: a corrupt or mismatched file must not get that far
+        if (offsets[0] != 0 || offsets[size] != n_adjacency) throw std::runtime_error("snapshot: offsets don't match the adjacency");
+        for (std::size_t v = 0; v < size; ++v)
+            if (offsets[v] > offsets[v+1]) throw std::runtime_error("snapshot: offsets not monotone");
+        for (std::size_t i = 0; i < n_adjacency; ++i)
+            if (adjacency[i] >= size) throw std::runtime_error("snapshot: neighbour out of range");
+
+        return {std::vector(offsets, offsets + size+1), std::vector(adjacency, adjacency + n_adjacency)};
+    }
+
+    inline std::vector<std::size_t> file::ordering() const {
+        if (_header.ordering_method < 0) return {};
+
+        const auto size = _header.graph.size;
+        if (size > _file->size() / sizeof(std::uint64_t)) throw std::runtime_error("snapshot: truncated file");
+        const auto order = section<std::uint64_t>(_header.ordering_offset, size * sizeof(std::uint64_t));
+
+        // the solver ranks vertices by it: every vertex exactly once
+        std::vector<bool> seen(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            if (order[i] >= size || seen[order[i]]) throw std::runtime_error("snapshot: ordering is not a permutation");
+            seen[order[i]] = true;
+        }
+        return {order, order + size};
+    }
+}
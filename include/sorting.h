@@ -5,17 +5,28 @@
 #pragma once
 
 #include "custom_graph.h"
+#include <algorithm>
 #include <chrono>
+#include <numeric>
 #include <set>
+#include <tuple>
 
 // DEG_SORT
+// both sorts take out, n-1 times, the vertex of minimum (degree, support) among vertices[0..i] and swap it
+// to vertices[i]: ties go to the first one in vertices. instead of scanning vertices[0..i] at every step,
+// the vertices left sit in buckets by degree (Batagelj-Zaversnik): taking one out only moves its neighbours
+// one bucket down, so the minimum degree goes down by at most one per step.
+// buckets are unordered, the (support, position) tie-break scans the minimum one only
+
 // Minimum Weight Sort with Initial sorting
 static std::vector<std::size_t> MWSI(const custom_graph& G, const int p) {
     std::vector<std::size_t> vertices(G.size());
+    std::vector<std::size_t> position(G.size());
     std::vector<std::size_t> degrees(G.size());
     std::vector<std::size_t> support(G.size());
 	custom_bitset is_node_processed(G.size());
     std::iota(vertices.begin(), vertices.end(), 0);
+    std::iota(position.begin(), position.end(), 0);
 
     for (std::size_t i = 0; i < G.size(); i++) {
         degrees[i] = G[i].count();
@@ -30,38 +41,58 @@ static std::vector<std::size_t> MWSI(const custom_graph& G, const int p) {
 
     const int k = static_cast<int>(G.size()/p);
 
+    std::vector<std::vector<std::size_t>> buckets(G.size() ? std::ranges::max(degrees)+1 : 0);
+    std::vector<std::size_t> slot(G.size());
+    for (std::size_t v = 0; v < G.size(); v++) {
+        slot[v] = buckets[degrees[v]].size();
+        buckets[degrees[v]].push_back(v);
+    }
+
+    const auto bucket_erase = [&](const std::size_t v) {
+        auto& bucket = buckets[degrees[v]];
+        slot[bucket.back()] = slot[v];
+        bucket[slot[v]] = bucket.back();
+        bucket.pop_back();
+    };
+
     custom_bitset neighbors_min(G.size());
-    custom_bitset neighbors_v(G.size());
+    custom_bitset two_hop(G.size());
+    std::size_t min_degree = 0;
 
     for (std::ptrdiff_t i = G.size()-1; i > 0; i--) {
-        auto min_idx = 0;
-        for (int j = 1; j <= i; j++) {
-            const auto node = vertices[j];
-			const auto v_min = vertices[min_idx];
-
-            if (degrees[node] != degrees[v_min]) {
-                if (degrees[node] < degrees[v_min]) min_idx = j;
-            } else if (support[node] < support[v_min]) {
-                min_idx = j;
-            }
-        }
+        while (buckets[min_degree].empty()) min_degree++;
 
-		const auto min = vertices[min_idx];
+        auto min = buckets[min_degree].front();
+        for (const auto v : buckets[min_degree]) {
+            if (std::tie(support[v], position[v]) < std::tie(support[min], position[min])) min = v;
+        }
+        bucket_erase(min);
 
         is_node_processed.set(min);
         custom_bitset::DIFF(neighbors_min, G[min], is_node_processed);
+        two_hop.reset();
         for (auto v : neighbors_min) {
             // update neigh_degree (we are going to remove v_min)
+            bucket_erase(v);
             degrees[v]--;
+            slot[v] = buckets[degrees[v]].size();
+            buckets[degrees[v]].push_back(v);
+            min_degree = std::min(min_degree, degrees[v]);
 
             support[v] -= degrees[min];
-			custom_bitset::DIFF(neighbors_v, G[v], is_node_processed);
-            for (auto u: neighbors_v) {
-                support[u]--;
-            }
+            two_hop |= G[v];
         }
 
+        // every vertex left loses one support for each of its neighbours in neighbors_min
+        two_hop -= is_node_processed;
+        for (auto u : two_hop) {
+            support[u] -= G[u].and_count(neighbors_min);
+        }
+
+        const auto min_idx = position[min];
         std::swap(vertices[min_idx], vertices[i]);
+        position[vertices[min_idx]] = min_idx;
+        position[min] = i;
     }
 
     // non-descending order based on original degree
@@ -75,10 +106,12 @@ static std::vector<std::size_t> MWSI(const custom_graph& G, const int p) {
 
 static std::vector<std::size_t> MWSSI(const custom_graph& G, const int p) {
     std::vector<std::size_t> vertices(G.size());
+    std::vector<std::size_t> position(G.size());
     std::vector<std::size_t> degrees(G.size());
     std::vector<std::size_t> support(G.size());
     custom_bitset is_node_processed(G.size());
     std::iota(vertices.begin(), vertices.end(), 0);
+    std::iota(position.begin(), position.end(), 0);
 
     for (std::size_t i = 0; i < G.size(); i++) {
         degrees[i] = G[i].count();
@@ -93,32 +126,47 @@ static std::vector<std::size_t> MWSSI(const custom_graph& G, const int p) {
 
     const int k = static_cast<int>(G.size()/p);
 
+    std::vector<std::vector<std::size_t>> buckets(G.size() ? std::ranges::max(degrees)+1 : 0);
+    std::vector<std::size_t> slot(G.size());
+    for (std::size_t v = 0; v < G.size(); v++) {
+        slot[v] = buckets[degrees[v]].size();
+        buckets[degrees[v]].push_back(v);
+    }
+
+    const auto bucket_erase = [&](const std::size_t v) {
+        auto& bucket = buckets[degrees[v]];
+        slot[bucket.back()] = slot[v];
+        bucket[slot[v]] = bucket.back();
+        bucket.pop_back();
+    };
+
     custom_bitset neighbors_min(G.size());
-    custom_bitset neighbors_v(G.size());
+    std::size_t min_degree = 0;
 
     for (std::ptrdiff_t i = G.size()-1; i > 0; i--) {
-        auto min_idx = 0;
-        for (int j = 1; j <= i; j++) {
-            const auto node = vertices[j];
-			const auto v_min = vertices[min_idx];
-
-            if (degrees[node] != degrees[v_min]) {
-                if (degrees[node] < degrees[v_min]) min_idx = j;
-            } else if (support[node] < support[v_min]) {
-                min_idx = j;
-            }
-        }
+        while (buckets[min_degree].empty()) min_degree++;
 
-		const auto min = vertices[min_idx];
+        auto min = buckets[min_degree].front();
+        for (const auto v : buckets[min_degree]) {
+            if (std::tie(support[v], position[v]) < std::tie(support[min], position[min])) min = v;
+        }
+        bucket_erase(min);
 
         is_node_processed.set(min);
         custom_bitset::DIFF(neighbors_min, G[min], is_node_processed);
         for (auto v : neighbors_min) {
             // update neigh_degree (we are going to remove v_min)
+            bucket_erase(v);
             degrees[v]--;
+            slot[v] = buckets[degrees[v]].size();
+            buckets[degrees[v]].push_back(v);
+            min_degree = std::min(min_degree, degrees[v]);
         }
 
+        const auto min_idx = position[min];
         std::swap(vertices[min_idx], vertices[i]);
+        position[vertices[min_idx]] = min_idx;
+        position[min] = i;
     }
 
     // non-descending order based on original degree
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "instructions.h"
+
+// fixed width bitset for small (re-indexed) subproblems, N is a multiple of 64.
+// no heap, no size field: every loop has a compile time trip count, so the compiler keeps
+// the whole set in a few registers. same operation set of custom_bitset, but positions are
+// plain indices (npos is the maximum size_type) and size() is always N
+template <std::size_t N>
+class static_bitset {
+    static_assert(N > 0 && N % 64 == 0, "static_bitset width must be a multiple of 64");
+
+public:
+    typedef std::uint64_t block_type;
+    typedef std::size_t size_type;
+
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    class const_iterator {
+        const static_bitset* bs;
+        size_type pos;
+
+    public:
+        using value_type = size_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+        using iterator_concept  = std::forward_iterator_tag;
+
+        explicit const_iterator() : bs(nullptr), pos(npos) {}
+        const_iterator(const static_bitset* bitset, const size_type pos) : bs(bitset), pos(pos) {}
+
+        size_type operator*() const { return pos; }
+
+        const_iterator& operator++() { pos = bs->next(pos); return *this; }
+        const_iterator operator++(int) { const auto tmp = *this; ++(*this); return tmp; }
+
+        bool operator==(const const_iterator& other) const { return bs == other.bs && pos == other.pos; }
+    };
+
+    [[nodiscard]] const_iterator begin() const { return {this, front()}; }
+    [[nodiscard]] const_iterator end() const { return {this, npos}; }
+
+private:
+    static constexpr size_type block_size = std::numeric_limits<block_type>::digits;
+    static constexpr size_type n_blocks = N / block_size;
+
+    alignas(32) std::array<block_type, n_blocks> _bits{};
+
+    static constexpr size_type get_block(const size_type pos) noexcept { return pos / block_size; }
+    static constexpr size_type get_block_bit(const size_type pos) noexcept { return pos % block_size; }
+    static constexpr block_type mask_bit(const size_type pos) noexcept { return block_type{1} << get_block_bit(pos); }
+
+public:
+    static_bitset() = default;
+    // same shape of custom_bitset(size), the width is fixed anyway
+    explicit static_bitset(const size_type size) { assert(size <= N); }
+
+    bool operator==(const static_bitset& other) const = default;
+    static_bitset& copy_same_size(const static_bitset& other) { return *this = other; }
+
+    static_bitset& operator&=(const static_bitset& other) { for (size_type i = 0; i < n_blocks; ++i) _bits[i] &= other._bits[i]; return *this; }
+    static_bitset& operator|=(const static_bitset& other) { for (size_type i = 0; i < n_blocks; ++i) _bits[i] |= other._bits[i]; return *this; }
+    static_bitset& operator^=(const static_bitset& other) { for (size_type i = 0; i < n_blocks; ++i) _bits[i] ^= other._bits[i]; return *this; }
+    static_bitset& operator-=(const static_bitset& other) { for (size_type i = 0; i < n_blocks; ++i) _bits[i] &= ~other._bits[i]; return *this; }
+
+    static void AND(static_bitset& dest, const static_bitset& src1, const static_bitset& src2) { for (size_type i = 0; i < n_blocks; ++i) dest._bits[i] = src1._bits[i] & src2._bits[i]; }
+    static void OR(static_bitset& dest, const static_bitset& src1, const static_bitset& src2) { for (size_type i = 0; i < n_blocks; ++i) dest._bits[i] = src1._bits[i] | src2._bits[i]; }
+    static void NOR(static_bitset& dest, const static_bitset& src1, const static_bitset& src2) { for (size_type i = 0; i < n_blocks; ++i) dest._bits[i] = ~(src1._bits[i] | src2._bits[i]); }
+    static void DIFF(static_bitset& dest, const static_bitset& src1, const static_bitset& src2) { for (size_type i = 0; i < n_blocks; ++i) dest._bits[i] = src1._bits[i] & ~src2._bits[i]; }
+
+    // same as AND/DIFF, but they also return dest.count()
+    static size_type AND_count(static_bitset& dest, const static_bitset& src1, const static_bitset& src2) { AND(dest, src1, src2); return dest.count(); }
+    static size_type DIFF_count(static_bitset& dest, const static_bitset& src1, const static_bitset& src2) { DIFF(dest, src1, src2); return dest.count(); }
+
+    bool operator[](const size_type pos) const { return test(pos); };
+
+    void set(const size_type pos) { assert(pos < N); _bits[get_block(pos)] |= mask_bit(pos); }
+    void set(const size_type pos, const bool value) { if (value) set(pos); else reset(pos); }
+    void reset(const size_type pos) { assert(pos < N); _bits[get_block(pos)] &= ~mask_bit(pos); }
+    void flip(const size_type pos) { assert(pos < N); _bits[get_block(pos)] ^= mask_bit(pos); }
+    [[nodiscard]] bool test(const size_type pos) const { assert(pos < N); return _bits[get_block(pos)] & mask_bit(pos); }
+
+    [[nodiscard]] size_type front() const noexcept;
+    [[nodiscard]] size_type next(size_type pos) const;
+    [[nodiscard]] size_type back() const noexcept;
+    [[nodiscard]] size_type prev(size_type pos) const;
+
+    // same as custom_bitset: fn(pos) for every set bit, a fn returning bool stops the scan on false
+    template <typename Fn>
+    void for_each_set_bit(Fn&& fn) const;
+
+    void set() noexcept { _bits.fill(std::numeric_limits<block_type>::max()); }
+    void reset() noexcept { _bits.fill(0); }
+    void flip() noexcept { for (auto& block : _bits) block = ~block; }
+
+    [[nodiscard]] static constexpr size_type size() noexcept { return N; }
+    [[nodiscard]] size_type count() const noexcept;
+    [[nodiscard]] bool any() const noexcept;
+    [[nodiscard]] bool none() const noexcept { return !any(); }
+    [[nodiscard]] bool intersects(const static_bitset& other) const noexcept;
+};
+
+template <std::size_t N>
+typename static_bitset<N>::size_type static_bitset<N>::front() const noexcept {
+    for (size_type i = 0; i < n_blocks; ++i)
+        if (_bits[i]) return i*block_size + instructions::bit_scan_forward(_bits[i]);
+
+    return npos;
+}
+
+template <std::size_t N>
+typename static_bitset<N>::size_type static_bitset<N>::next(const size_type pos) const {
+    assert(pos < N);
+
+    auto block = get_block(pos);
+    // shift by 64 is undefined, ~1 is already shifted by one
+    const auto masked = _bits[block] & (~block_type{1} << get_block_bit(pos));
+    if (masked) return block*block_size + instructions::bit_scan_forward(masked);
+
+    while (++block < n_blocks)
+        if (_bits[block]) return block*block_size + instructions::bit_scan_forward(_bits[block]);
+
+    return npos;
+}
+
+template <std::size_t N>
+typename static_bitset<N>::size_type static_bitset<N>::back() const noexcept {
+    for (size_type i = n_blocks; i-- > 0;)
+        if (_bits[i]) return i*block_size + instructions::bit_scan_reverse(_bits[i]);
+
+    return npos;
+}
+
+template <std::size_t N>
+typename static_bitset<N>::size_type static_bitset<N>::prev(const size_type pos) const {
+    assert(pos < N);
+
+    auto block = get_block(pos);
+    const auto masked = _bits[block] & (mask_bit(pos) - 1);
+    if (masked) return block*block_size + instructions::bit_scan_reverse(masked);
+
+    while (block-- > 0)
+        if (_bits[block]) return block*block_size + instructions::bit_scan_reverse(_bits[block]);
+
+    return npos;
+}
+
+template <std::size_t N>
+template <typename Fn>
+void static_bitset<N>::for_each_set_bit(Fn&& fn) const {
+    for (size_type i = 0; i < n_blocks; ++i) {
+        for (auto bits = _bits[i]; bits != 0; bits &= bits - 1) {
+            const size_type pos = i*block_size + instructions::bit_scan_forward(bits);
+            if constexpr (std::is_same_v<std::invoke_result_t<Fn&, size_type>, bool>) {
+                if (!fn(pos)) return;
+            } else {
+                fn(pos);
+            }
+        }
+    }
+}
+
+template <std::size_t N>
+typename static_bitset<N>::size_type static_bitset<N>::count() const noexcept {
+    size_type sum = 0;
+    for (const auto block : _bits) sum += std::popcount(block);
+    return sum;
+}
+
+template <std::size_t N>
+bool static_bitset<N>::any() const noexcept {
+    block_type any = 0;
+    for (const auto block : _bits) any |= block;
+    return any != 0;
+}
+
+template <std::size_t N>
+bool static_bitset<N>::intersects(const static_bitset& other) const noexcept {
+    block_type any = 0;
+    for (size_type i = 0; i < n_blocks; ++i) any |= _bits[i] & other._bits[i];
+    return any != 0;
+}
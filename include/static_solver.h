@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <span>
+#include <vector>
+
+#include "coloring.h"
+#include "custom_bitset.h"
+#include "custom_graph.h"
+#include "static_bitset.h"
+
+// subgraph induced by a set of vertices, re-indexed to 0..|V|-1 (in the same order of the original graph)
+template <std::size_t N>
+class static_graph {
+    typedef std::size_t size_type;
+
+    std::array<static_bitset<N>, N> _graph;
+    std::vector<int> _vertices; // local vertex -> original vertex
+    size_type _size = 0;
+
+public:
+    // local_index is a scratch array of G.size() elements, only the entries of V are written
+    void assign(const custom_graph& G, const custom_bitset& V, std::span<int> local_index, custom_bitset& tmp);
+
+    [[nodiscard]] size_type size() const noexcept { return _size; }
+    [[nodiscard]] const static_bitset<N>& get_neighbor_set(const size_type v) const { assert(v < _size); return _graph[v]; }
+    [[nodiscard]] int get_vertex(const size_type v) const { assert(v < _size); return _vertices[v]; }
+};
+
+template <std::size_t N>
+void static_graph<N>::assign(const custom_graph& G, const custom_bitset& V, std::span<int> local_index, custom_bitset& tmp) {
+    _vertices.resize(V.count());
+    _size = V.extract(std::span(_vertices));
+    assert(_size <= N);
+    for (size_type i = 0; i < _size; ++i) local_index[_vertices[i]] = static_cast<int>(i);
+
+    for (size_type i = 0; i < _size; ++i) {
+        _graph[i].reset();
+        custom_bitset::AND(tmp, G.get_neighbor_set(_vertices[i]), V);
+        tmp.for_each_set_bit([&](const auto w) { _graph[i].set(local_index[w]); });
+    }
+}
+
+// branch and bound on a static_graph<N>, same scheme of FindMaxClique (ISEQ_branching bound,
+// branching on the vertices that don't fit in the first k colour classes) but without the SAT
+// filters: on small subproblems the cheaper nodes are worth more than the stronger pruning
+template <std::size_t N>
+class static_solver {
+    static_graph<N> _G;
+    std::vector<std::vector<static_bitset<N>>> _ISs; // colour classes for every depth
+    std::vector<int> _color_class;
+    std::vector<int> _clique;
+    std::size_t _steps = 0;
+
+    template <typename Stop>
+    bool expand(static_bitset<N>& P, int size, std::size_t depth, Stop& should_stop);
+
+public:
+    // a level never holds more than N vertices, so depth < N: _ISs is never reallocated during the search
+    static_solver() : _ISs(N), _color_class(N) {}
+
+    // true if V holds a clique of size vertices, clique() returns it (vertices of G)
+    template <typename Stop>
+    bool find_clique(const custom_graph& G, const custom_bitset& V, int size, std::span<int> local_index, custom_bitset& tmp, Stop&& should_stop);
+
+    [[nodiscard]] const std::vector<int>& clique() const noexcept { return _clique; }
+    [[nodiscard]] std::size_t steps() const noexcept { return _steps; }
+};
+
+template <std::size_t N>
+template <typename Stop>
+bool static_solver<N>::find_clique(const custom_graph& G, const custom_bitset& V, const int size, std::span<int> local_index, custom_bitset& tmp, Stop&& should_stop) {
+    assert(size > 0);
+
+    _G.assign(G, V, local_index, tmp);
+    _clique.clear();
+    _steps = 0;
+
+    static_bitset<N> P;
+    for (std::size_t v = 0; v < _G.size(); ++v) P.set(v);
+
+    if (!expand(P, size, 0, should_stop)) return false;
+
+    for (auto& v : _clique) v = _G.get_vertex(v);
+    return true;
+}
+
+template <std::size_t N>
+template <typename Stop>
+bool static_solver<N>::expand(static_bitset<N>& P, const int size, const std::size_t depth, Stop& should_stop) {
+    ++_steps;
+
+    if (size == 1) {
+        _clique.push_back(static_cast<int>(P.front()));
+        return true;
+    }
+
+    auto& ISs = _ISs[depth];
+    if (ISs.size() < static_cast<std::size_t>(size)) ISs.resize(size);
+
+    // a clique of size vertices needs at least size colours
+    const int k = size-1;
+    if (ISEQ_branching(_G, P, ISs, _color_class, k) <= k) return false;
+
+    // every clique of size vertices has a vertex in ISs[k]
+    static_bitset<N> P_new;
+    for (auto v = ISs[k].front(); v != static_bitset<N>::npos; v = ISs[k].next(v)) {
+        if (should_stop()) return false;
+
+        if (static_cast<int>(static_bitset<N>::AND_count(P_new, P, _G.get_neighbor_set(v))) >= k && expand(P_new, k, depth+1, should_stop)) {
+            _clique.push_back(static_cast<int>(v));
+            return true;
+        }
+        P.reset(v);
+    }
+
+    return false;
+}
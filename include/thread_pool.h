@@ -3,19 +3,25 @@
 //
 
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <thread>
+#include <utility>
 
 #include "threadsafe_priority_queue.h"
 #include "threadsafe_queue.h"
-#include "threadsafe_stack.h"
 #include "fixed_vector.h"
+#include "inplace_function.h"
+#include "resource_pool.h"
+#include "work_stealing_deque.h"
 
 class thread_pool {
 public:
     struct Task {
-        std::function<void()> func;
+        inplace_function<void(), 12*sizeof(void*)> func;
     };
 
 private:
@@ -75,7 +81,7 @@ public:
 
     template<typename FunctionType>
     void submit(FunctionType f) {
-        work_queue.push(Task(std::function<void()>(f)));
+        work_queue.push(Task(std::move(f)));
     }
 
     void wait_until_idle() {
@@ -107,13 +113,40 @@ public:
     }
 };
 
+/* Work stealing pool for the branch and bound:
+ *  - every worker has its own Chase-Lev deque: the tasks it submits go to the bottom and it takes them back from
+ *    the bottom (the deepest, depth first), idle workers steal from the top of the others (the shallowest ones,
+ *    the largest subtrees). no lock is shared by the workers
+ *  - tasks submitted by other threads (the roots, all the tasks of a pool without threads) go to a priority queue,
+ *    deepest first and FIFO for the same depth, read by the workers when there is nothing to steal
+ *  - idle workers sleep on a condition variable, woken by a submit only when someone is sleeping
+ *  - submitting doesn't allocate: the lambda is stored in the Task itself (inplace_function) and the Tasks of the
+ *    deques are records of a slab of the submitting worker, given back to it by whoever runs them
+ *  - the scratch sets of the tasks (bitsets, u, alpha, K, ...) are borrowed from lock-free resource_pools, through
+ *    a cache of the worker when borrowed by a worker
+ */
 template<typename T>
 class thread_pool_CliSAT {
 public:
+    // a task submitted with a group and all the ones submitted while they run: done() runs after the last of them
+    struct task_group {
+        std::atomic_size_t pending = 0;
+        inplace_function<void(), 4*sizeof(void*)> done;
+    };
+
     struct Task {
         int depth;
         size_t sequence;
-        std::function<void(T&, size_t)> func;
+        // the biggest lambdas are the FindMaxClique ones, about 20 captures
+        inplace_function<void(T&, size_t), 24*sizeof(void*)> func;
+        task_group* group = nullptr;
+
+        void run(T& state) {
+            auto* outer = std::exchange(current_group, group);
+            func(state, sequence);
+            current_group = outer;
+            if (group && --group->pending == 0) group->done();
+        }
     };
 
 private:
@@ -125,96 +158,273 @@ private:
         }
     };
 
+    struct worker;
+
+    // a Task of the deques
+    struct record : Task {
+        worker* home = nullptr; // the worker that made it
+        record* next = nullptr; // free list
+    };
+
+    static constexpr size_t records_per_chunk = 64;
+
+    struct alignas(64) worker {
+        const thread_pool_CliSAT* pool;
+        work_stealing_deque<record*> tasks;
+        size_t sequence = 0;    // orders the tasks of this deque only
+        std::uint64_t seed;     // first victim to steal from
+        // records made by this worker: the free ones, the ones the other workers gave back, all of them
+        record* free = nullptr;
+        alignas(64) std::atomic<record*> returned = nullptr;
+        std::vector<std::unique_ptr<record[]>> slab;
+        // free resources of each kind
+        resource_cache bitsets, ISs, color_classes, Ks, us, alphas;
+
+        // owner only, allocates only when all the records made so far are in use
+        record* make_record() {
+            if (!free) free = returned.exchange(nullptr, std::memory_order_acquire);
+            if (!free) {
+                const auto& chunk = slab.emplace_back(std::make_unique<record[]>(records_per_chunk));
+                for (size_t i = 0; i < records_per_chunk; ++i) {
+                    chunk[i].home = this;
+                    chunk[i].next = i+1 < records_per_chunk ? &chunk[i+1] : nullptr;
+                }
+                free = chunk.get();
+            }
+            return std::exchange(free, free->next);
+        }
+    };
+
+    // the worker running on this thread, of any pool
+    static inline thread_local worker* current_worker = nullptr;
+    // the group of the task running on this thread
+    static inline thread_local task_group* current_group = nullptr;
+
     std::atomic_bool done = false;
     const size_t G_size;
     threadsafe_priority_queue<Task, std::vector<Task>, TaskCompare> work_queue;
-    std::vector<std::jthread> threads;
+    const size_t worker_count;
+    std::unique_ptr<worker[]> workers;
+    // looking for a task or running one
     std::atomic_uint64_t threads_working = 0;
+    std::atomic_uint64_t threads_sleeping = 0;
     std::atomic_uint64_t curr_sequence = 0;
-    std::mutex bitset_borrow;
-    std::deque<custom_bitset> bitset_pool;
-    threadsafe_stack<size_t> bitset_stack;
-    std::mutex ISs_borrow;
-    std::deque<std::vector<custom_bitset>> ISs_pool;
-    threadsafe_stack<size_t> ISs_stack;
-    std::mutex color_class_borrow;
-    std::deque<std::vector<int>> color_class_pool;
-    threadsafe_stack<size_t> color_class_stack;
-    std::mutex K_borrow;
-    std::deque<fixed_vector<int>> K_pool;
-    threadsafe_stack<size_t> K_stack;
-    std::mutex u_borrow;
-    std::deque<std::vector<int>> u_pool;
-    threadsafe_stack<size_t> u_stack;
-    std::mutex alpha_borrow;
-    std::deque<fixed_vector<int>> alpha_pool;
-    threadsafe_stack<size_t> alpha_stack;
+    resource_pool<custom_bitset> bitset_pool;
+    resource_pool<std::vector<custom_bitset>> ISs_pool;
+    resource_pool<std::vector<int>> color_class_pool;
+    resource_pool<fixed_vector<int>> K_pool;
+    resource_pool<std::vector<int>> u_pool;
+    resource_pool<fixed_vector<int>> alpha_pool;
 
     std::condition_variable work_done_cv;
     std::mutex work_done_m;
+    std::condition_variable sleep_cv;
+    std::mutex sleep_m;
 
-    void worker_thread() {
+    // last: the workers are joined before anything else goes
+    std::vector<std::jthread> threads;
+
+    worker* own_worker() const {
+        return current_worker && current_worker->pool == this ? current_worker : nullptr;
+    }
+
+    // the cache of the calling worker, none from other threads
+    resource_cache* cache(resource_cache worker::* kind) const {
+        auto* self = own_worker();
+        return self ? &(self->*kind) : nullptr;
+    }
+
+    static bool higher_priority(const Task& task, const int depth, const size_t sequence) {
+        if (task.depth == depth) return task.sequence < sequence;
+        return task.depth > depth;
+    }
+
+    // the Task is moved out, the record goes back to the worker that made it
+    static void take(record* from, Task& task) {
+        task = std::move(static_cast<Task&>(*from));
+
+        auto& home = *from->home;
+        if (current_worker == &home) {
+            from->next = std::exchange(home.free, from);
+            return;
+        }
+        // the home worker takes the whole list at once, no ABA
+        from->next = home.returned.load(std::memory_order_relaxed);
+        while (!home.returned.compare_exchange_weak(from->next, from, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    // own deque first, then the others (from a random one), then the tasks submitted from outside
+    bool find_task(worker& self, Task& task) {
+        record* next;
+        if (self.tasks.pop(next)) {
+            take(next, task);
+            return true;
+        }
+
+        self.seed ^= self.seed << 13;
+        self.seed ^= self.seed >> 7;
+        self.seed ^= self.seed << 17;
+        for (size_t i = 0, first = self.seed % worker_count; i < worker_count; ++i) {
+            auto& victim = workers[(first + i) % worker_count];
+            if (&victim != &self && victim.tasks.steal(next)) {
+                take(next, task);
+                return true;
+            }
+        }
+
+        return work_queue.try_pop(task);
+    }
+
+    bool has_work() const {
+        for (size_t i = 0; i < worker_count; ++i) {
+            if (!workers[i].tasks.empty()) return true;
+        }
+        return !work_queue.empty();
+    }
+
+    // a task was just made visible: wake a sleeping worker, if any.
+    // pairs with the fence in wait_for_work, either the sleeper sees the task or we see the sleeper
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (threads_sleeping.load(std::memory_order_relaxed) == 0) return;
+
+        std::lock_guard lg(sleep_m);
+        sleep_cv.notify_one();
+    }
+
+    void wait_for_work() {
+        std::unique_lock lock(sleep_m);
+        ++threads_sleeping;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!done && !has_work()) sleep_cv.wait(lock);
+        --threads_sleeping;
+    }
+
+    void worker_thread(worker& self) {
+        current_worker = &self;
         T state = T(G_size);
 
         Task task;
 
-        // we set thread to work before popping
-        // important, we could quit before finishing if we don't set thread_working!
-        while (work_queue.wait_and_pop(task, done, [this]() {
-            ++threads_working;
-        })) {
-            task.func(state, task.sequence);
-            --threads_working;
-
-            if (!working()) {
-                std::lock_guard lg(work_done_m);
-                work_done_cv.notify_all();
+        // we count as working while looking for a task
+        // important, wait_until_idle could return between the pop and the run otherwise!
+        ++threads_working;
+        while (!done) {
+            if (find_task(self, task)) {
+                task.run(state);
+                continue;
             }
+
+            // only running tasks submit to the deques: the last worker to find nothing leaves them empty.
+            // the others wake wait_until too, a worker is free
+            --threads_working;
+            notify_waiting();
+            wait_for_work();
+            ++threads_working;
         }
     }
 
     bool working() const {
-        if (!work_queue.empty() || threads_working) return true;
+        if (threads_working || has_work()) return true;
         return false;
     }
 
 public:
     std::atomic_bool stop_threads = false;
-    explicit thread_pool_CliSAT(const size_t G_size, const size_t thread_count) : G_size(G_size) {
+    // a pool without threads, drained by the Solver that owns it (re-indexed subproblems), stops with its parent too
+    const thread_pool_CliSAT* parent = nullptr;
+    explicit thread_pool_CliSAT(const size_t G_size, const size_t thread_count)
+        : G_size(G_size), worker_count(thread_count), workers(std::make_unique<worker[]>(thread_count)),
+          bitset_pool(G_size), ISs_pool(0), color_class_pool(G_size), K_pool(G_size), u_pool(G_size), alpha_pool(G_size) {
+        for (size_t i = 0; i < worker_count; i++) {
+            auto& self = workers[i];
+            self.pool = this;
+            self.seed = 0x9e3779b97f4a7c15 * (i+1);
+            bitset_pool.prepare(self.bitsets);
+            ISs_pool.prepare(self.ISs);
+            color_class_pool.prepare(self.color_classes);
+            K_pool.prepare(self.Ks);
+            u_pool.prepare(self.us);
+            alpha_pool.prepare(self.alphas);
+        }
+
+        // every worker keeps up to min(workers, 2) tasks in its deque and runs one, each with two bitsets
+        const size_t in_flight = worker_count * (std::min<size_t>(worker_count, 2) + 1);
+        bitset_pool.reserve(2*in_flight);
+        K_pool.reserve(in_flight);
+        u_pool.reserve(in_flight);
+        alpha_pool.reserve(in_flight);
+
         try {
-            for (unsigned i = 0; i < thread_count; i++) {
-                threads.emplace_back(&thread_pool_CliSAT::worker_thread, this);
+            for (size_t i = 0; i < thread_count; i++) {
+                threads.emplace_back(&thread_pool_CliSAT::worker_thread, this, std::ref(workers[i]));
             }
         } catch (...) {
             done = true;
+            std::lock_guard lg(sleep_m);
+            sleep_cv.notify_all();
             throw;
         }
     }
 
     ~thread_pool_CliSAT() {
         done = true;
-        work_queue.wake_all();
+        std::lock_guard lg(sleep_m);
+        sleep_cv.notify_all();
+    }
+
+    bool stopped() const {
+        return stop_threads || (parent && parent->stopped());
     }
 
     bool get_task(Task& task) {
+        if (auto* self = own_worker()) {
+            record* next;
+            if (!self->tasks.pop(next)) return false;
+            take(next, task);
+            return true;
+        }
         return work_queue.try_pop(task);
     }
 
+    // a worker looks at the bottom of its own deque only: the tasks it submitted last, the deepest
     bool get_higher_priority_task(Task& task, const int depth, const size_t sequence) {
+        if (auto* self = own_worker()) {
+            record* next;
+            if (!self->tasks.pop(next)) return false;
+            if (!higher_priority(*next, depth, sequence)) {
+                self->tasks.push(next);
+                return false;
+            }
+            take(next, task);
+            return true;
+        }
         return work_queue.try_pop_condition(task, [depth, sequence](const Task& new_task) {
-            if (new_task.depth == depth) return new_task.sequence < sequence;
-            return new_task.depth > depth;
+            return higher_priority(new_task, depth, sequence);
         });
     }
 
     size_t get_new_sequence() {
+        if (auto* self = own_worker()) return self->sequence++;
         return curr_sequence++;
     }
 
     template<typename FunctionType>
     void submit(const int depth, FunctionType f) {
-        work_queue.push(Task(depth, curr_sequence, std::function<void(T&, size_t)>(f)));
-        ++curr_sequence;
+        submit(current_group, depth, std::move(f));
+    }
+
+    template<typename FunctionType>
+    void submit(task_group* group, const int depth, FunctionType f) {
+        if (group) ++group->pending;
+        if (auto* self = own_worker()) {
+            auto* next = self->make_record();
+            static_cast<Task&>(*next) = Task(depth, self->sequence++, std::move(f), group);
+            self->tasks.push(next);
+        } else {
+            work_queue.push(Task(depth, curr_sequence++, std::move(f), group));
+        }
+        wake_one();
     }
 
     void wait_until_idle() {
@@ -223,126 +433,120 @@ public:
         stop_threads = false;
     }
 
+    // waits until ready() holds, checked whenever a worker runs out of tasks or a task calls notify_waiting
+    template<typename Fn>
+    void wait_until(Fn&& ready) {
+        std::unique_lock lock(work_done_m);
+        work_done_cv.wait(lock, std::forward<Fn>(ready));
+    }
+
+    void notify_waiting() {
+        std::lock_guard lg(work_done_m);
+        work_done_cv.notify_all();
+    }
+
     bool all_threads_working() const {
         return threads_working == threads.size();
     }
 
+    // a worker is waiting for tasks and there are none to take
+    bool has_idle_worker() const {
+        return threads_working < threads.size() && !has_work();
+    }
+
+    // a worker keeps one task of its own for the thieves, the rest runs in place. without other workers, or from
+    // outside, as many tasks as threads
     bool is_queue_full() {
+        if (const auto* self = own_worker()) return self->tasks.size() >= std::min<size_t>(worker_count, 2);
         if (work_queue.size() >= threads.size()) return true;
         return false;
     }
 
-    size_t borrow_bitset() {
-        size_t idx;
-        if (bitset_stack.try_pop(idx)) return idx;
+    // free resources in the cache of each worker (all kinds), the rest are borrowed or in the shared stacks
+    std::vector<size_t> cached_resources() const {
+        std::vector<size_t> cached(worker_count);
+        for (size_t i = 0; i < worker_count; ++i) {
+            const auto& self = workers[i];
+            for (const auto* kind : {&self.bitsets, &self.ISs, &self.color_classes, &self.Ks, &self.us, &self.alphas}) {
+                cached[i] += kind->held.load(std::memory_order_relaxed);
+            }
+        }
+        return cached;
+    }
 
-        std::unique_lock lock(bitset_borrow);
-        bitset_pool.emplace_back(G_size);
-        return bitset_pool.size() - 1;
+    size_t resources_created() const {
+        return bitset_pool.size() + ISs_pool.size() + color_class_pool.size() + K_pool.size() + u_pool.size() + alpha_pool.size();
+    }
+
+    size_t borrow_bitset() {
+        return bitset_pool.borrow(cache(&worker::bitsets));
     }
 
     void give_back_bitset(const size_t index) {
-        assert(index < bitset_pool.size());
-        bitset_stack.push(index);
+        bitset_pool.give_back(index, cache(&worker::bitsets));
     }
 
     custom_bitset& get_bitset(const size_t index) {
-        assert(index < bitset_pool.size());
-        return bitset_pool[index];
+        return bitset_pool.get(index);
     }
 
     size_t borrow_ISs() {
-        size_t idx;
-        if (ISs_stack.try_pop(idx)) return idx;
-
-        std::unique_lock lock(ISs_borrow);
-        ISs_pool.emplace_back();
-        return ISs_pool.size() - 1;
+        return ISs_pool.borrow(cache(&worker::ISs));
     }
 
     void give_back_ISs(const size_t index) {
-        assert(index < ISs_pool.size());
-        ISs_stack.push(index);
+        ISs_pool.give_back(index, cache(&worker::ISs));
     }
 
     std::vector<custom_bitset>& get_ISs(const size_t index) {
-        assert(index < ISs_pool.size());
-        return ISs_pool[index];
+        return ISs_pool.get(index);
     }
 
     size_t borrow_color_class() {
-        size_t idx;
-        if (color_class_stack.try_pop(idx)) return idx;
-
-        std::unique_lock lock(color_class_borrow);
-        color_class_pool.emplace_back(G_size);
-        return color_class_pool.size() - 1;
+        return color_class_pool.borrow(cache(&worker::color_classes));
     }
 
     void give_back_color_class(const size_t index) {
-        assert(index < color_class_pool.size());
-        color_class_stack.push(index);
+        color_class_pool.give_back(index, cache(&worker::color_classes));
     }
 
     std::vector<int>& get_color_class(const size_t index) {
-        assert(index < color_class_pool.size());
-        return color_class_pool[index];
+        return color_class_pool.get(index);
     }
 
     size_t borrow_K() {
-        size_t idx;
-        if (K_stack.try_pop(idx)) return idx;
-
-        std::unique_lock lock(K_borrow);
-        K_pool.emplace_back(G_size);
-        return K_pool.size() - 1;
+        return K_pool.borrow(cache(&worker::Ks));
     }
 
     void give_back_K(const size_t index) {
-        assert(index < K_pool.size());
-        K_stack.push(index);
+        K_pool.give_back(index, cache(&worker::Ks));
     }
 
     fixed_vector<int>& get_K(const size_t index) {
-        assert(index < K_pool.size());
-        return K_pool[index];
+        return K_pool.get(index);
     }
 
     size_t borrow_u() {
-        size_t idx;
-        if (u_stack.try_pop(idx)) return idx;
-
-        std::unique_lock lock(u_borrow);
-        u_pool.emplace_back(G_size);
-        return u_pool.size() - 1;
+        return u_pool.borrow(cache(&worker::us));
     }
 
     void give_back_u(const size_t index) {
-        assert(index < u_pool.size());
-        u_stack.push(index);
+        u_pool.give_back(index, cache(&worker::us));
     }
 
     std::vector<int>& get_u(const size_t index) {
-        assert(index < u_pool.size());
-        return u_pool[index];
+        return u_pool.get(index);
     }
 
     size_t borrow_alpha() {
-        size_t idx;
-        if (alpha_stack.try_pop(idx)) return idx;
-
-        std::unique_lock lock(alpha_borrow);
-        alpha_pool.emplace_back(G_size);
-        return alpha_pool.size() - 1;
+        return alpha_pool.borrow(cache(&worker::alphas));
     }
 
     void give_back_alpha(const size_t index) {
-        assert(index < alpha_pool.size());
-        alpha_stack.push(index);
+        alpha_pool.give_back(index, cache(&worker::alphas));
     }
 
     fixed_vector<int>& get_alpha(const size_t index) {
-        assert(index < alpha_pool.size());
-        return alpha_pool[index];
+        return alpha_pool.get(index);
     }
 };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev deque, as in Lê et al. "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013):
+// the owner thread pushes and pops at the bottom, every other thread steals from the top, no locks.
+// the items go through atomics, so T must be trivially copyable (a pointer to the actual item)
+template<typename T>
+class work_stealing_deque {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    struct ring {
+        const std::int64_t capacity; // power of 2
+        const std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit ring(const std::int64_t capacity) : capacity(capacity), slots(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+        T load(const std::int64_t i) const { return slots[i & (capacity-1)].load(std::memory_order_relaxed); }
+        void store(const std::int64_t i, const T value) { slots[i & (capacity-1)].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<std::int64_t> top = 0;
+    alignas(64) std::atomic<std::int64_t> bottom = 0;
+    std::atomic<ring*> array;
+    // a thief may still read an outgrown ring, they all go with the deque
+    std::vector<std::unique_ptr<ring>> rings;
+
+    ring* grow(const ring* old, const std::int64_t t, const std::int64_t b) {
+        const auto& bigger = rings.emplace_back(std::make_unique<ring>(2*old->capacity));
+        for (auto i = t; i < b; ++i) bigger->store(i, old->load(i));
+        return bigger.get();
+    }
+
+public:
+    explicit work_stealing_deque(const std::int64_t capacity = 32) {
+        rings.emplace_back(std::make_unique<ring>(capacity));
+        array.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // owner only
+    void push(const T value) {
+        const auto b = bottom.load(std::memory_order_relaxed);
+        const auto t = top.load(std::memory_order_acquire);
+        auto* a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+            array.store(a, std::memory_order_release);
+        }
+        a->store(b, value);
+        // a release store rather than fence + relaxed store (same code on x86), thread sanitizer doesn't model fences
+        bottom.store(b+1, std::memory_order_release);
+    }
+
+    // owner only: the last item pushed, false if empty
+    bool pop(T& value) {
+        const auto b = bottom.load(std::memory_order_relaxed) - 1;
+        const auto* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b+1, std::memory_order_relaxed);
+            return false;
+        }
+
+        value = a->load(b);
+        if (t < b) return true;
+
+        // the last item, a thief may be taking it too
+        const bool taken = top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b+1, std::memory_order_relaxed);
+        return taken;
+    }
+
+    // any thread: the first item pushed still there, false if empty or another thread got it first
+    bool steal(T& value) {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        const auto* a = array.load(std::memory_order_acquire);
+        value = a->load(t);
+        return top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // exact for the owner only, a hint for the others
+    std::size_t size() const {
+        const auto b = bottom.load(std::memory_order_relaxed);
+        const auto t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
@@ -2,20 +2,30 @@
 // Created by benia on 15/09/2025.
 //
 
+#include <cassert>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <print>
 #include <iostream>
 #include <numeric>
+#include <optional>
 #include <random>
+#include <deque>
+#include <memory>
+#include <variant>
 
+#include "csr_graph.h"
 #include "custom_graph.h"
 #include "custom_bitset.h"
 #include "CliSAT.h"
+#include "huge_pages.h"
 #include "sorting.h"
 #include "AMTS.h"
 #include "parsing.h"
+#include "snapshot.h"
 #include "solution.h"
 
 
@@ -90,13 +100,15 @@ std::vector<int> CliSAT_no_sorting(const custom_graph& G, thread_pool_CliSAT<Sol
 
         size_t local_u_idx = pool.borrow_u();
         std::vector<int>& local_u = pool.get_u(local_u_idx);
-        for (int j = 0; j < u.size(); j++) local_u[j] = u[j];
+        // the subtree only reads the bounds of its vertices, P and B
+        P.for_each_set_bit([&](const auto v) { local_u[v] = u[v]; });
+        B.for_each_set_bit([&](const auto v) { local_u[v] = u[v]; });
 
         size_t alpha_idx = pool.borrow_alpha();
         fixed_vector<int>& alpha = pool.get_alpha(alpha_idx);
 
-        pool.submit(0, [local_u_idx, alpha_idx, &G, &K_max, &pool, &K, &local_u, max_time, &alpha](Solver& solver, const size_t sequence) {
-            solver.FindMaxClique(G, K, K_max, P, B, local_u, max_time, pool, sequence, alpha);
+        pool.submit(0, [local_u_idx, alpha_idx, i, &G, &K_max, &pool, &K, &local_u, max_time, &alpha](Solver& solver, const size_t sequence) {
+            solver.FindMaxClique(G, K, K_max, P, B, i, local_u, max_time, pool, sequence, alpha);
             pool.give_back_u(local_u_idx);
             pool.give_back_alpha(alpha_idx);
         });
@@ -110,73 +122,372 @@ std::vector<int> CliSAT_no_sorting(const custom_graph& G, thread_pool_CliSAT<Sol
     return K_max;
 }
 
-// MISP indicates if the program needs to resolve the maximum independent set problem (1)
-// sorting can be:
-//  - 0: no sorting
-//  - 1: NEW_SORT
-//  - 2: DEG_SORT
-//  - 3: COLOUR_SORT
-std::vector<int> CliSAT(
-    const std::string& filename,
+// MCP on a csr_graph, for graphs whose bit matrix doesn't fit in memory.
+// the vertices are sorted in degeneracy order, so every root i has at most d (degeneracy) earlier neighbours:
+// the branch of i runs the usual FindMaxClique on the bit matrix of the subgraph induced by them and i itself,
+// which has at most d+1 vertices. roots with no more than |K_max|-1 earlier neighbours can't improve K_max
+// and are skipped without building it
+std::vector<int> CliSAT_sparse(
+    csr_graph& S,
     const std::chrono::milliseconds time_limit,
-    const std::chrono::milliseconds cs_time_limit,
-    const bool MISP,
-    const SORTING_METHOD sorting_method,
-    const bool AMTS_enabled,
     const size_t threads,
     const bool verbose
 ) {
     auto begin = std::chrono::steady_clock::now();
-    custom_graph G = parse_graph(filename, MISP);
-    std::cout << "N: " << G.size() << " M: " << G.get_n_edges() << " D: " << G.get_density() << " d: " << G.get_degeneracy() << " max degree: " << G.get_max_degree() << std::endl;
-    thread_pool_CliSAT<Solver> pool(G.size(), threads);
+    const auto ordering = S.degeneracy_ordering();
+    S.change_order(ordering);
+
+    std::size_t degeneracy = 0;
+    for (std::size_t v = 0; v < S.size(); ++v) degeneracy = std::max(degeneracy, S.get_prev_neighbors(v).size());
+    std::cout << "N: " << S.size() << " M: " << S.get_n_edges() << " D: " << S.get_density() << " d: " << degeneracy << " max degree: " << S.get_max_degree() << std::endl;
+
+    // every subgraph is a (degeneracy+1)-vertex bit matrix, the pool and the solvers are sized for it
+    const auto local_size = degeneracy + 1;
+    thread_pool_CliSAT<Solver> pool(local_size, threads);
+    custom_graph L(local_size);
+    std::vector<csr_graph::vertex_type> vertices;
+    vertices.reserve(local_size);
+    std::vector local_index(S.size(), -1);
+
     auto end = std::chrono::steady_clock::now();
-    auto seconds_double = std::chrono::duration<double, std::chrono::seconds::period>(end - begin).count();
-    std::cout << "Parsing = " << seconds_double << "[s]" << std::endl;
+    std::cout << "Preprocessing = " << std::chrono::duration<double, std::chrono::seconds::period>(end - begin).count() << "[s]" << std::endl;
 
-    std::vector<std::size_t> ordering(G.size());
-    begin = std::chrono::steady_clock::now();
+    auto begin_CliSAT = std::chrono::steady_clock::now();
+    auto max_time = std::chrono::steady_clock::now() + time_limit;
+
+    // vertices of S (in degeneracy order)
+    solution<int> K_max;
+    K_max.push_back(0);
+    fixed_vector<int> K(local_size);
+    // sets of the current root, sized for the subgraph of this call
+    custom_bitset B(local_size);
+    custom_bitset P(local_size);
+    std::vector u(S.size(), 1);
+
+    steps = 0;
+    pruned = 0;
+
+    bool delete_last = false;
+
+    for (std::size_t i = K_max.size(); i < S.size(); ++i) {
+        if (std::chrono::steady_clock::now() > max_time) {
+            std::cout << "Exit on timeout" << std::endl;
+            delete_last = false;
+            break;
+        }
+
+        const auto prev = S.get_prev_neighbors(i);
+        const int lb = static_cast<int>(K_max.size());
+        if (static_cast<int>(prev.size()) < lb) {
+            u[i] = lb;
+            continue;
+        }
+
+        begin = std::chrono::steady_clock::now();
+
+        // local vertex j is prev[j], the root is the last one
+        vertices.assign(prev.begin(), prev.end());
+        vertices.push_back(static_cast<csr_graph::vertex_type>(i));
+        L.assign_induced(S, vertices, local_index);
+        const auto root = prev.size();
+
+        B.reset();
+        B.set_before(root);
+        P.reset();
+
+        // same as the dense roots, the first lb-1 vertices can't improve the solution on their own
+        auto count = 1;
+        for (const auto v : B) {
+            if (count == lb) break;
+            B.reset(v);
+            P.set(v);
+            count++;
+        }
+
+        uint64_t old_steps = steps;
+        uint64_t old_pruned = pruned;
+
+        // only its size is read until a bigger clique (of local vertices) replaces it
+        solution<int> local_K_max(lb);
+        K.push_back(static_cast<int>(root));
+
+        size_t local_u_idx = pool.borrow_u();
+        std::vector<int>& local_u = pool.get_u(local_u_idx);
+        // the local order is the global one, so the bounds of the earlier vertices still hold. the subtree only reads
+        // the ones of P and B
+        P.for_each_set_bit([&](const auto v) { local_u[v] = u[vertices[v]]; });
+        B.for_each_set_bit([&](const auto v) { local_u[v] = u[vertices[v]]; });
+
+        size_t alpha_idx = pool.borrow_alpha();
+        fixed_vector<int>& alpha = pool.get_alpha(alpha_idx);
+
+        pool.submit(0, [local_u_idx, alpha_idx, root, &L, &local_K_max, &pool, &K, &P, &B, &local_u, max_time, &alpha](Solver& solver, const size_t sequence) {
+            solver.FindMaxClique(L, K, local_K_max, P, B, root, local_u, max_time, pool, sequence, alpha);
+            pool.give_back_u(local_u_idx);
+            pool.give_back_alpha(alpha_idx);
+        });
+        pool.wait_until_idle();
+        K.pop_back();
+
+        if (static_cast<int>(local_K_max.size()) > lb) {
+            std::vector<int> clique;
+            for (const auto v : std::vector<int>(local_K_max)) clique.push_back(static_cast<int>(vertices[v]));
+            K_max = clique;
+        }
+
+        u[i] = K_max.size();
+
+        end = std::chrono::steady_clock::now();
+
+        if (delete_last && !verbose) eraseLines(2);
+        std::print("{}/{} (max {}) {}ms -> {} steps {} pruned (total: {} [s])\n",
+                   i+1, S.size(), K_max.size(),
+                   std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count(),
+                   steps-old_steps, pruned-old_pruned,
+                   std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::steady_clock::now() - begin_CliSAT).count()
+        );
+        delete_last = true;
+    }
+    if (delete_last && !verbose) eraseLines(2);
+
+    auto end_CliSAT = std::chrono::steady_clock::now();
+    std::cout << "Branching time: " << std::chrono::duration<double, std::chrono::seconds::period>(end_CliSAT - begin_CliSAT).count() << " [s]" << std::endl;
+
+    std::cout << "Steps: " << steps << std::endl;
+    std::cout << "Pruned: " << pruned << std::endl;
+    if (huge_pages::enabled()) std::cout << huge_pages::report() << std::endl;
+
+    const std::vector<int> clique(K_max);
+    for (std::size_t a = 0; a < clique.size(); ++a) {
+        for (std::size_t b = a+1; b < clique.size(); ++b) {
+            if (!S.adjacent(clique[a], clique[b])) {
+                std::cout << "Error: wrong solution (" << custom_bitset(std::vector<int>(custom_graph::convert_back_set(clique, ordering))) << ")" << std::endl;
+                exit(1);
+            }
+        }
+    }
+
+    return custom_graph::convert_back_set(clique, ordering);
+}
+
+// parse throughput, for --verbose
+void print_parsing_rate(const std::string& filename, const std::chrono::steady_clock::time_point begin) {
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::error_code ec;
+    const auto mb = static_cast<double>(std::filesystem::file_size(filename, ec)) / (1 << 20);
+    if (ec) return;
+    std::print("Read {:.1f} MB at {:.1f} MB/s\n", mb, seconds > 0 ? mb / seconds : 0);
+}
+
+// K_max in input vertices. exits if it's not a clique of G
+std::vector<int> verified_clique(const custom_graph& G, const std::vector<int>& K_max, const std::vector<std::size_t>& ordering) {
+    if (!is_clique(G, custom_bitset(K_max, G.size()))) {
+        std::cout << "Error: wrong solution (" << custom_bitset(std::vector<int>(G.convert_back_set(K_max, ordering))) << ")" << std::endl;
+        exit(1);
+    }
+    return custom_graph::convert_back_set(K_max, ordering);
+}
+
+// an improving clique has |K_max|+1 vertices, |K_max| neighbours each: the vertices out of the |K_max|-core can't be
+// in it. when at least 1/core_shrink_ratio of the vertices go, G keeps only the core (in the same order), ordering,
+// u and next (the next root) follow it. next is at least |K_max| (the roots before it can't improve K_max on their
+// own), also when the core drops the vertices before next. K_max is saved in best and becomes a placeholder of the
+// same size. false if the core is too small for an improving clique, K_max is optimal
+bool shrink_to_core(custom_graph& G, solution<int>& K_max, std::vector<int>& best, std::vector<std::size_t>& ordering, std::vector<int>& u, std::size_t& next) {
+    const auto lb = K_max.size();
+    const auto core = G.get_core(lb);
+    const auto core_size = core.count();
+    if (core_size <= lb) return false;
+    if ((G.size() - core_size) * core_shrink_ratio < G.size()) return true;
+
+    if (K_max.size() > best.size()) best = verified_clique(G, K_max, ordering);
+    K_max = std::vector<int>(lb, 0);
+
+    // change_order wants a permutation, the core first
+    std::vector<std::size_t> order;
+    order.reserve(G.size());
+    for (const auto v : core) order.push_back(v);
+    for (std::size_t v = 0; v < G.size(); ++v) if (!core.test(v)) order.push_back(v);
+
+    // the roots before next are over, their bounds still hold on the core
+    const auto done = next < G.size() ? core.count(next) : core_size;
+    next = std::max<std::size_t>(done, lb);
+    G.change_order(order);
+    G.resize(core_size);
+
+    order.resize(core_size);
+    ordering = custom_graph::convert_back_set(order, ordering);
+    std::vector<int> core_u(core_size);
+    for (std::size_t v = 0; v < core_size; ++v) core_u[v] = u[order[v]];
+    u = std::move(core_u);
+    // the skipped roots up to next: a clique of the first v+1 vertices has at most v+1 of them, one more than one of
+    // the first v
+    for (auto v = done; v < next; ++v) u[v] = std::min(static_cast<int>(v) + 1, v > 0 ? u[v-1] + 1 : 1);
+
+    return true;
+}
+
+// order[new] = old for sorting_method, nullopt for an unknown method. G is not reordered
+std::optional<std::vector<std::size_t>> initial_order(custom_graph& G, const SORTING_METHOD sorting_method, thread_pool_CliSAT<Solver>& pool, const std::chrono::milliseconds cs_time_limit) {
+    std::vector<std::size_t> order(G.size());
 
     switch (sorting_method) {
         case NO_SORT:
-            std::iota(ordering.begin(), ordering.end(), 0);
+            std::iota(order.begin(), order.end(), 0);
             break;
         case NEW_SORT:
-            ordering = new_sort(G, pool, cs_time_limit);
-            G.change_order(ordering);
+            order = new_sort(G, pool, cs_time_limit);
             break;
         case DEG_SORT:
-            ordering = deg_sort(G);
-            G.change_order(ordering);
+            order = deg_sort(G);
             break;
         case COLOUR_SORT:
-            ordering = colour_sort(G, pool, cs_time_limit).first;
-            G.change_order(ordering);
+            order = colour_sort(G, pool, cs_time_limit).first;
             break;
         case RANDOM_SORT:
-            std::iota(ordering.begin(), ordering.end(), 0);
+            std::iota(order.begin(), order.end(), 0);
             {
                 std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
-                std::shuffle(ordering.begin(), ordering.end(), rng);
+                std::shuffle(order.begin(), order.end(), rng);
             }
 
             std::cout << "ordering: [";
-            for (int i = 0; i < ordering.size()-1; i++) std::cout << ordering[i] << ", ";
-            std::cout << ordering.back() << "]" << std::endl;
-
-            G.change_order(ordering);
+            for (int i = 0; i < order.size()-1; i++) std::cout << order[i] << ", ";
+            std::cout << order.back() << "]" << std::endl;
             break;
         default:
-            return {};
-            break;
+            return std::nullopt;
     }
 
-    auto begin_CliSAT = std::chrono::steady_clock::now();
-    auto max_time = std::chrono::steady_clock::now() + time_limit;
+    return order;
+}
+
+// the snapshot ordering (of the input graph) restricted to the vertices left in G, ordering maps them to input vertices
+std::vector<std::size_t> snapshot_order(const snapshot::file& snap, const std::vector<std::size_t>& ordering) {
+    const auto stored = snap.ordering();
+    std::vector<std::size_t> rank(stored.size());
+    for (std::size_t k = 0; k < stored.size(); ++k) rank[stored[k]] = k;
+
+    std::vector<std::size_t> order(ordering.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, {}, [&](const std::size_t v) { return rank[ordering[v]]; });
+    return order;
+}
+
+void convert(
+    const std::string& filename,
+    const std::string& output,
+    const SORTING_METHOD sorting_method,
+    const std::chrono::milliseconds cs_time_limit,
+    const size_t threads,
+    const bool sparse
+) {
+    auto parsed = parse_any_graph(filename, [&](const std::size_t size) { return !sparse && size <= dense_max_size; });
+    if (const auto* S = std::get_if<csr_graph>(&parsed)) {
+        const auto stats = snapshot::stats_of(*S);
+        snapshot::write(output, *S, stats);
+        std::cout << "csr snapshot: N: " << stats.size << " M: " << stats.n_edges << std::endl;
+        return;
+    }
+
+    auto G = std::get<custom_graph>(std::move(parsed));
+    const auto stats = snapshot::stats_of(G);
+
+    // a random order is different at every run, no point in saving one
+    std::optional<std::vector<std::size_t>> order;
+    if (sorting_method != NO_SORT && sorting_method != RANDOM_SORT) {
+        thread_pool_CliSAT<Solver> pool(G.size(), threads);
+        order = initial_order(G, sorting_method, pool, cs_time_limit);
+    }
+
+    if (order) snapshot::write(output, G, stats, *order, sorting_method);
+    else snapshot::write(output, G, stats);
+    std::cout << "matrix snapshot: N: " << stats.size << " M: " << stats.n_edges << (order ? " with ordering" : "") << std::endl;
+}
+
+// a root of the main loop: its sets and what is known when its search is over (all the tasks of its group)
+struct root_task {
+    std::size_t vertex = 0;
+    fixed_vector<int> K;
+    custom_bitset P;
+    custom_bitset B;
+    thread_pool_CliSAT<Solver>::task_group group;
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point end;
+    std::atomic_bool finished = false;
+    bool stopped = false;   // cut short (a new clique, the time limit), the search may be incomplete
+    std::size_t bound = 0;  // |K_max| at the end: a clique with vertex (among the ones before it) isn't bigger
+
+    explicit root_task(const std::size_t size) : K(size), P(size), B(size) {}
+};
+
+// MISP indicates if the program needs to resolve the maximum independent set problem (1)
+// sorting can be:
+//  - 0: no sorting
+//  - 1: NEW_SORT
+//  - 2: DEG_SORT
+//  - 3: COLOUR_SORT
+std::vector<int> CliSAT(
+    const std::string& filename,
+    const std::chrono::milliseconds time_limit,
+    const std::chrono::milliseconds cs_time_limit,
+    const bool MISP,
+    const SORTING_METHOD sorting_method,
+    const bool AMTS_enabled,
+    const size_t threads,
+    const bool verbose,
+    const bool sparse
+) {
+    auto begin = std::chrono::steady_clock::now();
+
+    // a snapshot (CliSAT convert) instead of a text file: a bit matrix is used where it's mapped
+    std::optional<snapshot::file> snap;
+    if (snapshot::is_snapshot(filename)) snap.emplace(filename);
+
+    // MISP needs the bit matrix (of the complement)
+    const auto dense = [&](const std::size_t size) { return MISP || (!sparse && size <= dense_max_size); };
+
+    custom_graph G;
+    if (snap && !snap->is_sparse()) {
+        G = snap->graph();
+    } else {
+        // a text file goes straight to the bit matrix when it's dense, the csr_graph is built only for CliSAT_sparse
+        auto parsed = snap ? std::variant<custom_graph, csr_graph>(snap->sparse_graph()) : parse_any_graph(filename, dense);
+        if (verbose && !snap) print_parsing_rate(filename, begin);
+        if (auto* S = std::get_if<csr_graph>(&parsed)) {
+            if (!dense(S->size())) {
+                std::cout << "Parsing = " << std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::steady_clock::now() - begin).count() << "[s]" << std::endl;
+                return CliSAT_sparse(*S, time_limit, threads, verbose);
+            }
+            G = custom_graph(*S);
+        } else {
+            G = std::get<custom_graph>(std::move(parsed));
+        }
+    }
+
+    if (MISP) G.complement();
+    // the snapshot statistics are the ones of the input graph, not of its complement
+    if (snap && !MISP) {
+        const auto& stats = snap->graph_stats();
+        std::cout << "N: " << stats.size << " M: " << stats.n_edges << " D: " << stats.density << " d: " << stats.degeneracy << " max degree: " << stats.max_degree << std::endl;
+    } else {
+        std::cout << "N: " << G.size() << " M: " << G.get_n_edges() << " D: " << G.get_density() << " d: " << G.get_degeneracy() << " max degree: " << G.get_max_degree() << std::endl;
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto seconds_double = std::chrono::duration<double, std::chrono::seconds::period>(end - begin).count();
+    std::cout << "Parsing = " << seconds_double << "[s]" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+
+    // vertex of G -> vertex of the input graph, through every shrink and the sorting
+    std::vector<std::size_t> ordering(G.size());
+    std::iota(ordering.begin(), ordering.end(), 0);
+    // K_max as it was before the last shrink, in input vertices (K_max is then a placeholder of its size)
+    std::vector<int> best;
 
     solution<int> K_max;
-    fixed_vector<int> K(G.size());
 
+    // before the sorting, so that it works on the core only
     if (AMTS_enabled) {
         K_max = run_AMTS(G); // lb <- |K|    ->     AMTS Tabu search
         std::cout << "AMTS found clique of size " << K_max.size() << std::endl;
@@ -184,6 +495,41 @@ std::vector<int> CliSAT(
         K_max.push_back(0);
     }
 
+    std::vector u(G.size(), 1);
+    std::size_t next = 0;
+    const auto input_size = G.size();
+    // the core is too small for a bigger clique: K_max is optimal, no sorting and no pool for it
+    if (!shrink_to_core(G, K_max, best, ordering, u, next)) return verified_clique(G, K_max, ordering);
+    if (G.size() < input_size) std::cout << K_max.size() << "-core: " << G.size() << " vertices" << std::endl;
+
+    std::optional<thread_pool_CliSAT<Solver>> pool(std::in_place, G.size(), threads);
+    std::vector<std::size_t> order;
+    // an ordering saved by convert with the same method, made on the input graph: not valid for the complement
+    const bool reuse_ordering = snap && !MISP && sorting_method != NO_SORT && snap->ordering_method() == sorting_method;
+
+    if (reuse_ordering) {
+        order = snapshot_order(*snap, ordering);
+        if (verbose) std::cout << "Ordering from the snapshot" << std::endl;
+    } else if (auto sorted = initial_order(G, sorting_method, *pool, cs_time_limit)) {
+        order = std::move(*sorted);
+    } else {
+        return {};
+    }
+    if (sorting_method != NO_SORT) G.change_order(order);
+    ordering = custom_graph::convert_back_set(order, ordering);
+
+    // a real K_max (not a placeholder) follows the sorting too
+    if (K_max.size() > best.size()) {
+        std::vector<std::size_t> position(G.size());
+        for (std::size_t v = 0; v < G.size(); ++v) position[order[v]] = v;
+        std::vector<int> sorted(K_max);
+        for (auto& v : sorted) v = static_cast<int>(position[v]);
+        K_max = sorted;
+    }
+
+    auto begin_CliSAT = std::chrono::steady_clock::now();
+    auto max_time = std::chrono::steady_clock::now() + time_limit;
+
     /*
     for (int i = 0; i < g.size(); i++) {
         const auto neighb = g.get_neighbor_set(i).front();
@@ -196,11 +542,8 @@ std::vector<int> CliSAT(
     */
     int lb = static_cast<int>(K_max.size());
 
-    // u with default value 1 (minimum)
-    std::vector u(G.size(), 1);
-
     // first |k_max| values bounded by |K_max| (==lb)
-    for (auto i = 1; i < lb; i++) {
+    for (auto i = 1; i < lb && i < G.size(); i++) {
         for (const auto neighbor : G.get_prev_neighbor_set(i)) {
             u[i] = std::max(u[i], 1 + u[neighbor]);
         }
@@ -227,70 +570,157 @@ std::vector<int> CliSAT(
 
     bool delete_last = false;
 
-    for (std::size_t i = lb; i < G.size(); ++i) {
-        if (std::chrono::steady_clock::now() > max_time) {
-            std::cout << "Exit on timeout" << std::endl;
-            delete_last = false;
-            break;
+    /* The roots run in order, but root i+1 starts before root i is over when a worker has nothing to do (up to
+     * threads roots at once), so that cheap roots don't leave the pool idle.
+     *  - u[i] is known once root i and all the ones before it are over. Meanwhile the later roots take u[i-1]+1:
+     *    a clique of the first i+1 vertices has at most one vertex more than a clique of the first i. a looser
+     *    bound, they prune less but never cut a clique
+     *  - the roots are retired in order. a root cut short (K_max grew, every root stops) is done only if u[i-1]+1
+     *    doesn't exceed |K_max|, otherwise it runs again with all the ones after it
+     *  - nothing runs while G shrinks to the new core
+     */
+    const auto max_in_flight = std::max<std::size_t>(threads, 1);
+    std::deque<std::unique_ptr<root_task>> in_flight;
+    std::vector<std::unique_ptr<root_task>> spare;
+    next = lb;
+    uint64_t old_steps = steps;
+    uint64_t old_pruned = pruned;
+
+    const auto start_root = [&](const std::size_t i) {
+        if (spare.empty()) {
+            auto& root = *spare.emplace_back(std::make_unique<root_task>(G.size()));
+            // set once: a worker may still be in done() of the previous vertex when the root starts again
+            root.group.done = [&root, &K_max, &pool] {
+                root.stopped = pool->stopped();
+                root.bound = K_max.size();
+                root.end = std::chrono::steady_clock::now();
+                root.finished = true;
+                pool->notify_waiting();
+            };
         }
+        auto& root = *in_flight.emplace_back(std::move(spare.back()));
+        spare.pop_back();
 
-        begin = std::chrono::steady_clock::now();
-        static custom_bitset B(G.size());
-        static custom_bitset P(G.size());
-
-        custom_bitset::BEFORE(B, G.get_neighbor_set(i), i);
-        P.reset();
+        root.vertex = i;
+        root.finished = false;
+        root.begin = std::chrono::steady_clock::now();
 
-        //lb = K_max.size();
+        custom_bitset::BEFORE(root.B, G.get_neighbor_set(i), i);
+        root.P.reset();
 
         // we pruned first lb vertices of V (they can't improve the solution on they own)
         // if we set count to zero, we can't possibly improve the solution because the B set can become empty even tough
         // it should be possible to improve, lb vertices + 1 from k, but we remove every one from the lb ones
         auto count = 1;
-        for (const auto v : B) {
+        for (const auto v : root.B) {
             // if count == lower_bound
             if (count == K_max.size()) break;
-            B.reset(v);
-            P.set(v);
+            root.B.reset(v);
+            root.P.set(v);
             count++;
         }
 
-        uint64_t old_steps = steps;
-        uint64_t old_pruned = pruned;
+        root.K.clear();
+        root.K.push_back(i);
 
-        K.push_back(i);
+        // until root i is over. K_max is never empty, so root 0 is never started
+        assert(i > 0);
+        u[i] = u[i-1] + 1;
 
-        size_t local_u_idx = pool.borrow_u();
-        std::vector<int>& local_u = pool.get_u(local_u_idx);
-        for (int j = 0; j < u.size(); j++) local_u[j] = u[j];
+        size_t local_u_idx = pool->borrow_u();
+        std::vector<int>& local_u = pool->get_u(local_u_idx);
+        // the subtree only reads the bounds of its vertices, P and B
+        root.P.for_each_set_bit([&](const auto v) { local_u[v] = u[v]; });
+        root.B.for_each_set_bit([&](const auto v) { local_u[v] = u[v]; });
 
-        size_t alpha_idx = pool.borrow_alpha();
-        fixed_vector<int>& alpha = pool.get_alpha(alpha_idx);
+        size_t alpha_idx = pool->borrow_alpha();
+        fixed_vector<int>& alpha = pool->get_alpha(alpha_idx);
 
-        pool.submit(0, [local_u_idx, alpha_idx, &G, &K_max, &pool, &K, &local_u, max_time, &alpha](Solver& solver, const size_t sequence) {
-            solver.FindMaxClique(G, K, K_max, P, B, local_u, max_time, pool, sequence, alpha);
+        pool->submit(&root.group, 0, [local_u_idx, alpha_idx, i, &G, &K_max, &pool = *pool, &root, &local_u, max_time, &alpha](Solver& solver, const size_t sequence) {
+            solver.FindMaxClique(G, root.K, K_max, root.P, root.B, i, local_u, max_time, pool, sequence, alpha);
             pool.give_back_u(local_u_idx);
             pool.give_back_alpha(alpha_idx);
         });
-        pool.wait_until_idle();
-        K.pop_back();
+    };
+
+    // the finished roots at the front, in order
+    const auto retire = [&] {
+        while (!in_flight.empty() && in_flight.front()->finished) {
+            const auto& root = *in_flight.front();
+            const auto i = root.vertex;
+
+            if (root.stopped && u[i-1] + 1 > static_cast<int>(K_max.size())) {
+                // this one and the later ones run again, once they are all over
+                pool->wait_until_idle();
+                next = i;
+                for (auto& later : in_flight) spare.push_back(std::move(later));
+                in_flight.clear();
+                return;
+            }
 
-        // u[i] = lb
-        u[i] = K_max.size();
+            // u[i] = lb
+            u[i] = root.stopped ? static_cast<int>(K_max.size()) : std::max(u[i-1], static_cast<int>(root.bound));
+
+            // don't delete first line
+            if (delete_last && !verbose) eraseLines(2);
+            std::print("{}/{} (max {}) {}ms -> {} steps {} pruned (total: {} [s])\n",
+                       i+1, G.size(), K_max.size(),
+                       std::chrono::duration_cast<std::chrono::milliseconds>(root.end - root.begin).count(),
+                       steps-old_steps, pruned-old_pruned,
+                       std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::steady_clock::now() - begin_CliSAT).count()
+            );
+            delete_last = true;
+            old_steps = steps;
+            old_pruned = pruned;
+
+            spare.push_back(std::move(in_flight.front()));
+            in_flight.pop_front();
+        }
+    };
 
-        end = std::chrono::steady_clock::now();
+    while (true) {
+        // a stop (a bigger K_max, the time limit) reaches every root: they are all over before any is retired
+        if (pool->stopped()) pool->wait_until_idle();
+        retire();
 
-        // don't delete first line
-        if (delete_last && !verbose) eraseLines(2);
-        std::print("{}/{} (max {}) {}ms -> {} steps {} pruned (total: {} [s])\n",
-                   i+1, G.size(), K_max.size(),
-                   std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count(),
-                   steps-old_steps, pruned-old_pruned,
-                   std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::steady_clock::now() - begin_CliSAT).count()
-        );
-        delete_last = true;
-        // std::print("{}/{} (max {}) {}ms -> {} steps {} pruned\n", i+1, g.size(), K_max.size(), std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count(), steps-old_steps, pruned-old_pruned);
+        if (std::chrono::steady_clock::now() > max_time) {
+            pool->wait_until_idle();
+            std::cout << "Exit on timeout" << std::endl;
+            delete_last = false;
+            break;
+        }
+
+        if (K_max.size() != lb) {
+            // a bigger K_max, a smaller core: later roots get a smaller matrix (and pool)
+            pool->wait_until_idle();
+            retire();
+            lb = static_cast<int>(K_max.size());
+            const auto size = G.size();
+            if (!shrink_to_core(G, K_max, best, ordering, u, next)) break;
+            if (G.size() == size) continue;
+
+            pool.reset();
+            pool.emplace(G.size(), threads);
+            spare.clear();
+            if (verbose) std::cout << lb << "-core: " << G.size() << " vertices" << std::endl;
+            delete_last = false;
+            continue;
+        }
+
+        // the next roots, while a worker is free. a finished root is retired first: its bound is exact
+        while (next < G.size() && in_flight.size() < max_in_flight && !pool->stopped() &&
+               (in_flight.empty() || (!in_flight.front()->finished && pool->has_idle_worker()))) {
+            start_root(next++);
+        }
+        if (in_flight.empty()) break;
+
+        pool->wait_until([&] {
+            return in_flight.front()->finished || pool->stopped() ||
+                   (next < G.size() && in_flight.size() < max_in_flight && pool->has_idle_worker());
+        });
     }
+    // the roots go before the pool: a worker may still be in done() of the last one
+    pool->wait_until_idle();
     if (delete_last && !verbose) eraseLines(2);
 
     auto end_CliSAT = std::chrono::steady_clock::now();
@@ -298,11 +728,8 @@ std::vector<int> CliSAT(
 
     std::cout << "Steps: " << steps << std::endl;
     std::cout << "Pruned: " << pruned << std::endl;
+    if (huge_pages::enabled()) std::cout << huge_pages::report() << std::endl;
 
-    if (!is_clique(G, custom_bitset(std::vector<int>(K_max), G.size()))) {
-        std::cout << "Error: wrong solution (" << custom_bitset(std::vector<int>(G.convert_back_set(K_max, ordering))) << ")" << std::endl;
-        exit(1);
-    }
-
-    return G.convert_back_set(K_max, ordering);
+    if (K_max.size() > best.size()) best = verified_clique(G, K_max, ordering);
+    return best;
 }
@@ -5,13 +5,18 @@
 #include <chrono>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <string>
+#include <variant>
 #include <CLI/CLI.hpp>
 
 #include "CliSAT.h"
+#include "csr_graph.h"
 #include "custom_bitset.h"
 #include "custom_graph.h"
+#include "huge_pages.h"
 #include "parsing.h"
+#include "snapshot.h"
 
 const inline std::string PROGRAM_NAME = "CliSAT";
 
@@ -22,6 +27,7 @@ const inline std::string PROGRAM_NAME = "CliSAT";
 struct options {
     std::string graph_filename;
     std::string constraints_filename; // only for nesting
+    std::string output_filename; // only for convert
     // we set it to half the maximum rapresentable value in a steady_clock (nanoseconds), used for operations with program timer
     // if seconds or milliseconds would be used, an overflow would happen
     std::chrono::seconds time_limit = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::duration::max()/2);
@@ -31,6 +37,8 @@ struct options {
     bool AMTS_enabled = false;
     bool verbose = false;
     bool complementary = false;
+    bool huge_pages = false;
+    bool sparse = false;
 };
 
 int main(int argc, char *argv[]) {
@@ -40,6 +48,13 @@ int main(int argc, char *argv[]) {
             return "";
         }, "VALIDATOR DESCRIPTION", "Validator name");
 
+    // "-" reads the graph from stdin, anything else must exist (a file or a named pipe)
+    auto graph_file = CLI::Validator(
+        [](std::string& input) {
+            if (input == "-") return std::string();
+            return CLI::ExistingFile(input);
+        }, "FILE|-", "Graph file");
+
     CLI::App app{"Algorithm for MCP/MISP", PROGRAM_NAME};
     //app.require_subcommand(1); // exactly one of mcp/misp/nesting
 
@@ -61,10 +76,21 @@ int main(int argc, char *argv[]) {
     auto info = app.add_subcommand("info", "Graph info");
     nesting->alias("d");
 
+    auto convert_cmd = app.add_subcommand("convert", "Write a binary snapshot of the graph, loaded by mcp/misp/info without parsing");
+
+    auto parse_sorting = [&opts](const std::string& sorting_method) {
+        if (sorting_method == "NO_SORT") opts.sorting_method = NO_SORT;
+        else if (sorting_method == "NEW_SORT") opts.sorting_method = NEW_SORT;
+        else if (sorting_method == "DEG_SORT") opts.sorting_method = DEG_SORT;
+        else if (sorting_method == "COLOUR_SORT") opts.sorting_method = COLOUR_SORT;
+        else if (sorting_method == "RANDOM_SORT") opts.sorting_method = RANDOM_SORT;
+        else throw CLI::ValidationError("--sorting must be one of { NO_SORT, NEW_SORT, DEG_SORT, COLOUR_SORT, RANDOM_SORT }");
+    };
+
     for (auto cmd : {mcp, misp, nesting}) {
         // 1) filename (must exist)
-        cmd->add_option("-g, --graph", opts.graph_filename, "Input graph file (DIMACS/EXTENDED)")
-            ->check(CLI::ExistingFile)
+        cmd->add_option("-g, --graph", opts.graph_filename, "Input graph file (DIMACS/MTX/edge list/METIS, also gzip compressed, or a snapshot), - for stdin")
+            ->check(graph_file)
             ->required();
 
         // 2) time_limit (seconds, non-negative)
@@ -82,15 +108,7 @@ int main(int argc, char *argv[]) {
             ->check(CLI::Range(size_t{0}, std::numeric_limits<size_t>::max()));
 
         // 4) sorting_method: 0..3
-        cmd->add_option_function<std::string>("-s, --sorting", 
-                        [&opts](const std::string& sorting_method) {
-                            if (sorting_method == "NO_SORT") opts.sorting_method = NO_SORT;
-                            else if (sorting_method == "NEW_SORT") opts.sorting_method = NEW_SORT;
-                            else if (sorting_method == "DEG_SORT") opts.sorting_method = DEG_SORT;
-                            else if (sorting_method == "COLOUR_SORT") opts.sorting_method = COLOUR_SORT;
-                            else if (sorting_method == "RANDOM_SORT") opts.sorting_method = RANDOM_SORT;
-                            else throw CLI::ValidationError("--sorting must be one of { NO_SORT, NEW_SORT, DEG_SORT, COLOUR_SORT, RANDOM_SORT }");
-                        },
+        cmd->add_option_function<std::string>("-s, --sorting", parse_sorting,
                        "Sorting method: 0-none, 1-auto(NEW_SORT), 2-DEG_SORT, 3-COLOUR_SORT");
             //->check(CLI::IsMember({"NO_SORT", "NEW_SORT", "DEG_SORT", "COLOUR_SORT"}));
 
@@ -99,6 +117,10 @@ int main(int argc, char *argv[]) {
             ->check(CLI::Range(0, 1));
 
         cmd->add_flag("-v, --verbose", opts.verbose, "Verbose logging");
+
+        cmd->add_flag("--huge-pages", opts.huge_pages, "Back the adjacency matrix and the solver workspaces with 2 MB pages");
+
+        cmd->add_flag("--sparse", opts.sparse, std::format("MCP on the sparse graph, one small bit matrix per root (always above {} vertices)", dense_max_size));
     }
 
     // Only nesting has constraints; make them required there
@@ -107,14 +129,33 @@ int main(int argc, char *argv[]) {
            ->check(CLI::ExistingFile)
            ->required();
 
-    info->add_option("-g, --graph", opts.graph_filename, "Input graph file (DIMACS/EXTENDED)")
-        ->check(CLI::ExistingFile)
+    info->add_option("-g, --graph", opts.graph_filename, "Input graph file (DIMACS/MTX/edge list/METIS, also gzip compressed, or a snapshot), - for stdin")
+        ->check(graph_file)
         ->required();
 
 
     info->add_option("-c, --complementary", opts.complementary, "Complementary graph: 0-disabled, 1-enabled")
         ->check(CLI::Range(0, 1));
 
+    convert_cmd->add_option("-g, --graph", opts.graph_filename, "Input graph file (DIMACS/MTX/edge list/METIS, also gzip compressed), - for stdin")
+        ->check(graph_file)
+        ->required();
+
+    convert_cmd->add_option("-o, --output", opts.output_filename, "Snapshot file")
+        ->required();
+
+    convert_cmd->add_option_function<std::string>("-s, --sorting", parse_sorting,
+                       "Ordering saved in the snapshot, reused by mcp with the same method (default NEW_SORT, NO_SORT for none)");
+
+    convert_cmd->add_option("--cs-time-limit", opts.cs_time_limit, "Colour Sort Time limit in milliseconds")
+        ->check(CLI::Range(0, std::numeric_limits<int>::max()))
+        ->transform(transform_time_limit);
+
+    convert_cmd->add_option("-t, --threads", opts.threads, "Number of threads")
+        ->check(CLI::Range(size_t{0}, std::numeric_limits<size_t>::max()));
+
+    convert_cmd->add_flag("--sparse", opts.sparse, std::format("Save the csr graph instead of the bit matrix (always above {} vertices)", dense_max_size));
+
     if (argc == 1) {
         std::cout << app.help() << std::endl;
         return 0;
@@ -124,14 +165,55 @@ int main(int argc, char *argv[]) {
     argv = app.ensure_utf8(argv);
     CLI11_PARSE(app, argc, argv);
 
+    // before parsing the graph, it allocates the adjacency matrix
+    huge_pages::enable(opts.huge_pages);
+
     if (*mcp) {
-        std::cout << custom_bitset(CliSAT(opts.graph_filename, opts.time_limit, opts.cs_time_limit, false, opts.sorting_method, opts.AMTS_enabled, opts.threads, opts.verbose)) << std::endl;
+        std::cout << custom_bitset(CliSAT(opts.graph_filename, opts.time_limit, opts.cs_time_limit, false, opts.sorting_method, opts.AMTS_enabled, opts.threads, opts.verbose, opts.sparse)) << std::endl;
     } else if (*misp) {
         std::cout << custom_bitset(CliSAT(opts.graph_filename, opts.time_limit, opts.cs_time_limit, true, opts.sorting_method, opts.AMTS_enabled, opts.threads, opts.verbose)) << std::endl;
     } else if (*nesting) {
         // std::cout << custom_bitset(CliSAT(opts.graph_filename, time_limit, true, opts.sorting_method, opts.AMTS_enabled, opts.constraints_filename)) << std::endl;
+    } else if (*convert_cmd) {
+        convert(opts.graph_filename, opts.output_filename, opts.sorting_method, opts.cs_time_limit, opts.threads, opts.sparse);
     } else if (*info) {
-        const custom_graph G = parse_graph(opts.graph_filename, opts.complementary);
+        std::optional<snapshot::file> snap;
+        if (snapshot::is_snapshot(opts.graph_filename)) snap.emplace(opts.graph_filename);
+
+        // the statistics saved by convert, only c is computed (on the bit matrix)
+        if (snap && !opts.complementary) {
+            const auto& stats = snap->graph_stats();
+            std::cout << "N: " << stats.size << std::endl;
+            std::cout << "M: " << stats.n_edges << std::endl;
+            std::cout << "D: " << stats.density << std::endl;
+            std::cout << "d: " << stats.degeneracy << std::endl;
+            std::cout << "max degree: " << stats.max_degree << std::endl;
+            if (!snap->is_sparse()) std::cout << "c: " << snap->graph().get_community_degeneracy() << std::endl;
+            return 0;
+        }
+
+        custom_graph G;
+        if (snap && !snap->is_sparse()) {
+            G = snap->graph();
+        } else {
+            const auto dense = [&](const std::size_t size) { return opts.complementary || size <= dense_max_size; };
+            auto parsed = snap ? std::variant<custom_graph, csr_graph>(snap->sparse_graph()) : parse_any_graph(opts.graph_filename, dense);
+            if (const auto* S = std::get_if<csr_graph>(&parsed)) {
+                if (!dense(S->size())) {
+                    std::cout << "N: " << S->size() << std::endl;
+                    std::cout << "M: " << S->get_n_edges() << std::endl;
+                    std::cout << "D: " << S->get_density() << std::endl;
+                    std::cout << "d: " << S->get_degeneracy() << std::endl;
+                    std::cout << "max degree: " << S->get_max_degree() << std::endl;
+                    return 0;
+                }
+                G = custom_graph(*S);
+            } else {
+                G = std::get<custom_graph>(std::move(parsed));
+            }
+        }
+
+        if (opts.complementary) G.complement();
         std::cout << "N: " << G.size() << std::endl;
         std::cout << "M: " << G.get_n_edges() << std::endl;
         std::cout << "D: " << G.get_density() << std::endl;
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "custom_bitset.h"
+#include "custom_graph.h"
+
+// the quadratic versions the bucket queues replaced (full scan of the vertices left at every step),
+// kept as the reference: the bucket queue ones must give exactly the same orderings and degeneracy
+namespace reference {
+
+inline std::size_t get_degeneracy(const custom_graph& G) {
+    std::vector<std::size_t> vertices(G.size());
+    std::vector<std::size_t> degrees(G.size());
+    custom_bitset is_node_processed(G.size());
+    std::iota(vertices.begin(), vertices.end(), 0);
+
+    std::size_t max = 0;
+
+    for (std::size_t i = 0; i < G.size(); i++) {
+        degrees[i] = G[i].count();
+    }
+
+    std::vector<std::size_t> degrees_orig = degrees;
+
+    custom_bitset neighbors_min(G.size());
+
+    for (std::ptrdiff_t i = G.size()-1; i > 0; i--) {
+        auto min_idx = 0;
+        for (int j = 1; j <= i; j++) {
+            const auto node = vertices[j];
+            const auto v_min = vertices[min_idx];
+
+            if (degrees[node] < degrees[v_min]) min_idx = j;
+        }
+
+        const auto min = vertices[min_idx];
+
+        max = std::max(max, degrees[min]);
+
+        is_node_processed.set(min);
+        custom_bitset::DIFF(neighbors_min, G[min], is_node_processed);
+        for (auto v : neighbors_min) {
+            // update neigh_degree (we are going to remove v_min)
+            degrees[v]--;
+        }
+
+        std::swap(vertices[min_idx], vertices[i]);
+    }
+
+    return max;
+}
+
+// Minimum Weight Sort with Initial sorting
+inline std::vector<std::size_t> MWSI(const custom_graph& G, const int p) {
+    std::vector<std::size_t> vertices(G.size());
+    std::vector<std::size_t> degrees(G.size());
+    std::vector<std::size_t> support(G.size());
+	custom_bitset is_node_processed(G.size());
+    std::iota(vertices.begin(), vertices.end(), 0);
+
+    for (std::size_t i = 0; i < G.size(); i++) {
+        degrees[i] = G[i].count();
+    }
+
+    std::vector degrees_orig = degrees;
+    for (std::size_t i = 0; i < G.size(); i++) {
+        for (const auto v : G[i]) {
+            support[i] += degrees[v];
+        }
+    }
+
+    const int k = static_cast<int>(G.size()/p);
+
+    custom_bitset neighbors_min(G.size());
+    custom_bitset neighbors_v(G.size());
+
+    for (std::ptrdiff_t i = G.size()-1; i > 0; i--) {
+        auto min_idx = 0;
+        for (int j = 1; j <= i; j++) {
+            const auto node = vertices[j];
+			const auto v_min = vertices[min_idx];
+
+            if (degrees[node] != degrees[v_min]) {
+                if (degrees[node] < degrees[v_min]) min_idx = j;
+            } else if (support[node] < support[v_min]) {
+                min_idx = j;
+            }
+        }
+
+		const auto min = vertices[min_idx];
+
+        is_node_processed.set(min);
+        custom_bitset::DIFF(neighbors_min, G[min], is_node_processed);
+        for (auto v : neighbors_min) {
+            // update neigh_degree (we are going to remove v_min)
+            degrees[v]--;
+
+            support[v] -= degrees[min];
+			custom_bitset::DIFF(neighbors_v, G[v], is_node_processed);
+            for (auto u: neighbors_v) {
+                support[u]--;
+            }
+        }
+
+        std::swap(vertices[min_idx], vertices[i]);
+    }
+
+    // non-descending order based on original degree
+    std::ranges::sort(vertices.begin(), vertices.begin()+k,
+        [&degrees_orig](auto a, auto b) {
+            return degrees_orig[a] > degrees_orig[b];
+        });
+
+    return vertices;
+}
+
+inline std::vector<std::size_t> MWSSI(const custom_graph& G, const int p) {
+    std::vector<std::size_t> vertices(G.size());
+    std::vector<std::size_t> degrees(G.size());
+    std::vector<std::size_t> support(G.size());
+    custom_bitset is_node_processed(G.size());
+    std::iota(vertices.begin(), vertices.end(), 0);
+
+    for (std::size_t i = 0; i < G.size(); i++) {
+        degrees[i] = G[i].count();
+    }
+
+    std::vector degrees_orig = degrees;
+    for (std::size_t i = 0; i < G.size(); i++) {
+        for (const auto v : G[i]) {
+            support[i] += degrees[v];
+        }
+    }
+
+    const int k = static_cast<int>(G.size()/p);
+
+    custom_bitset neighbors_min(G.size());
+    custom_bitset neighbors_v(G.size());
+
+    for (std::ptrdiff_t i = G.size()-1; i > 0; i--) {
+        auto min_idx = 0;
+        for (int j = 1; j <= i; j++) {
+            const auto node = vertices[j];
+			const auto v_min = vertices[min_idx];
+
+            if (degrees[node] != degrees[v_min]) {
+                if (degrees[node] < degrees[v_min]) min_idx = j;
+            } else if (support[node] < support[v_min]) {
+                min_idx = j;
+            }
+        }
+
+		const auto min = vertices[min_idx];
+
+        is_node_processed.set(min);
+        custom_bitset::DIFF(neighbors_min, G[min], is_node_processed);
+        for (auto v : neighbors_min) {
+            // update neigh_degree (we are going to remove v_min)
+            degrees[v]--;
+        }
+
+        std::swap(vertices[min_idx], vertices[i]);
+    }
+
+    // non-descending order based on original degree
+    std::ranges::sort(vertices.begin(), vertices.begin()+k,
+        [&degrees_orig](auto a, auto b) {
+            return degrees_orig[a] > degrees_orig[b];
+        });
+
+    return vertices;
+}
+
+}
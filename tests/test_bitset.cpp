@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "custom_bitset.h"
+#include "hierarchical_bitset.h"
+
+namespace {
+    using size_type = custom_bitset::size_type;
+    constexpr size_type block_bits = std::numeric_limits<custom_bitset::block_type>::digits;
+
+    // the window fit_window() would compute: the first and one past the last block with a set bit, (0, 0) if none
+    std::pair<size_type, size_type> fitted_window(const custom_bitset& bs) {
+        std::pair<size_type, size_type> window = {0, 0};
+        bool any = false;
+        for (size_type pos = 0; pos < bs.size(); ++pos) {
+            if (!bs.test(pos)) continue;
+            if (!any) window.first = pos / block_bits;
+            window.second = pos / block_bits + 1;
+            any = true;
+        }
+        return window;
+    }
+
+    // every set bit is inside the window and an empty window is (0, 0). operations that fit the window leave no
+    // zero block at its ends, the others may
+    void require_window(const custom_bitset& bs, const bool fitted) {
+        const auto window = bs.window();
+        const auto expected = fitted_window(bs);
+        CAPTURE(bs.size(), window.first, window.second, expected.first, expected.second);
+        if (fitted) {
+            REQUIRE(window == expected);
+            return;
+        }
+
+        if (window.first == window.second) REQUIRE(window.first == 0);
+        if (expected.first != expected.second) {
+            REQUIRE(window.first <= expected.first);
+            REQUIRE(expected.second <= window.second);
+        }
+    }
+
+    std::vector<bool> bits_of(const custom_bitset& bs) {
+        std::vector<bool> bits(bs.size());
+        for (size_type pos = 0; pos < bs.size(); ++pos) bits[pos] = bs.test(pos);
+        return bits;
+    }
+
+    // bits only in [lo, hi), a random range: the window is narrower than the bitset
+    custom_bitset random_bitset(const size_type n, std::mt19937& rng) {
+        custom_bitset bs(n);
+        if (n == 0) return bs;
+
+        std::uniform_int_distribution<size_type> position(0, n-1);
+        auto lo = position(rng);
+        auto hi = position(rng);
+        if (lo > hi) std::swap(lo, hi);
+
+        std::bernoulli_distribution bit(0.3);
+        for (auto pos = lo; pos <= hi; ++pos) if (bit(rng)) bs.set(pos);
+        return bs;
+    }
+
+    // a few random blocks with a few bits each: long runs of zero blocks, over several summary words
+    custom_bitset scattered_bitset(const size_type n, std::mt19937& rng) {
+        custom_bitset bs(n);
+        std::uniform_int_distribution<size_type> position(0, n-1);
+        const auto blocks = std::uniform_int_distribution<int>(0, 8)(rng);
+        for (int i = 0; i < blocks; ++i) {
+            const auto first = position(rng) / block_bits * block_bits;
+            for (int j = 0; j < 3; ++j) bs.set(std::min(n-1, first + position(rng) % block_bits));
+        }
+        return bs;
+    }
+
+    template <typename Bitset>
+    std::vector<size_type> forward(const Bitset& bs) {
+        std::vector<size_type> positions;
+        for (auto ref = bs.front(); ref != custom_bitset::npos; ref = bs.next(ref)) positions.push_back(*ref);
+        return positions;
+    }
+
+    template <typename Bitset>
+    std::vector<size_type> backward(const Bitset& bs) {
+        std::vector<size_type> positions;
+        for (auto ref = bs.back(); ref != custom_bitset::npos; ref = bs.prev(ref)) positions.push_back(*ref);
+        return positions;
+    }
+
+    // the same bits as expected, and a summary that agrees with them: every search through it finds
+    // exactly the set bits (a stale summary bit would scan a zero block, a missing one would skip bits)
+    void require_same(const hierarchical_bitset& h, const custom_bitset& expected, const custom_bitset& other) {
+        REQUIRE(bits_of(h.flat()) == bits_of(expected));
+        REQUIRE(h.count() == expected.count());
+        REQUIRE(h.any() == (expected.count() > 0));
+        REQUIRE(forward(h) == forward(expected));
+        REQUIRE(backward(h) == backward(expected));
+
+        std::vector<size_type> visited;
+        h.for_each_set_bit([&](const size_type pos) { visited.push_back(pos); });
+        REQUIRE(visited == forward(expected));
+        std::vector<size_type> extracted(h.count());
+        REQUIRE(h.extract(std::span(extracted)) == extracted.size());
+        REQUIRE(extracted == visited);
+
+        REQUIRE(h.front_difference(other) == expected.front_difference(other));
+    }
+
+    std::vector<bool> combine(const std::vector<bool>& a, const std::vector<bool>& b, const std::function<bool(bool, bool)>& op) {
+        std::vector<bool> result(a.size());
+        for (size_type i = 0; i < a.size(); ++i) result[i] = op(a[i], b[i]);
+        return result;
+    }
+}
+
+TEST_CASE("single bit operations keep the window valid", "[bitset]") {
+    const size_type n = GENERATE(1, 63, 64, 65, 200, 1000);
+    std::mt19937 rng(static_cast<unsigned>(n));
+    std::uniform_int_distribution<size_type> position(0, n-1);
+    std::uniform_int_distribution op(0, 2);
+
+    custom_bitset bs(n);
+    std::vector<bool> model(n);
+    for (int i = 0; i < 2000; ++i) {
+        const auto pos = position(rng);
+        switch (op(rng)) {
+            case 0: bs.set(pos); model[pos] = true; break;
+            case 1: bs.reset(pos); model[pos] = false; break;
+            default: bs.flip(pos); model[pos] = !model[pos]; break;
+        }
+        REQUIRE(bits_of(bs) == model);
+        require_window(bs, false);
+    }
+
+    bs.flip();
+    require_window(bs, true);
+    bs.set();
+    require_window(bs, true);
+    bs.reset();
+    REQUIRE(bs.window() == std::pair<size_type, size_type>{0, 0});
+}
+
+TEST_CASE("resize fits the window", "[bitset]") {
+    const size_type n = GENERATE(1, 64, 65, 200, 1000);
+    const size_type new_size = GENERATE(0, 1, 63, 64, 130, 2000);
+    std::mt19937 rng(static_cast<unsigned>(n + new_size));
+
+    for (int i = 0; i < 20; ++i) {
+        auto bs = random_bitset(n, rng);
+        auto model = bits_of(bs);
+        model.resize(new_size);
+
+        bs.resize(new_size);
+        REQUIRE(bits_of(bs) == model);
+        require_window(bs, true);
+    }
+}
+
+TEST_CASE("set operations fit the window", "[bitset]") {
+    const size_type n = GENERATE(1, 63, 64, 65, 200, 1000);
+    std::mt19937 rng(static_cast<unsigned>(n));
+
+    for (int i = 0; i < 50; ++i) {
+        const auto a = random_bitset(n, rng);
+        const auto b = random_bitset(n, rng);
+        const auto A = bits_of(a);
+        const auto B = bits_of(b);
+
+        // dest starts with bits of its own, outside the new window too
+        const auto check = [&](const char* name, const std::function<void(custom_bitset&)>& op, const std::function<bool(bool, bool)>& model) {
+            INFO(name);
+            auto dest = random_bitset(n, rng);
+            op(dest);
+            REQUIRE(bits_of(dest) == combine(A, B, model));
+            require_window(dest, true);
+        };
+
+        check("AND", [&](auto& d) { custom_bitset::AND(d, a, b); }, std::logical_and<>());
+        check("OR", [&](auto& d) { custom_bitset::OR(d, a, b); }, std::logical_or<>());
+        check("XOR", [&](auto& d) { custom_bitset::XOR(d, a, b); }, std::not_equal_to<>());
+        check("NAND", [&](auto& d) { custom_bitset::NAND(d, a, b); }, [](bool x, bool y) { return !(x && y); });
+        check("NOR", [&](auto& d) { custom_bitset::NOR(d, a, b); }, [](bool x, bool y) { return !(x || y); });
+        check("NXOR", [&](auto& d) { custom_bitset::NXOR(d, a, b); }, std::equal_to<>());
+        check("DIFF", [&](auto& d) { custom_bitset::DIFF(d, a, b); }, [](bool x, bool y) { return x && !y; });
+        check("AND_count", [&](auto& d) { REQUIRE(custom_bitset::AND_count(d, a, b) == (a & b).count()); }, std::logical_and<>());
+        check("DIFF_count", [&](auto& d) { REQUIRE(custom_bitset::DIFF_count(d, a, b) == (a - b).count()); }, [](bool x, bool y) { return x && !y; });
+        check("&=", [&](auto& d) { d = a; d &= b; }, std::logical_and<>());
+        check("|=", [&](auto& d) { d = a; d |= b; }, std::logical_or<>());
+        check("^=", [&](auto& d) { d = a; d ^= b; }, std::not_equal_to<>());
+
+        // removing bits leaves the window as it is
+        auto dest = a;
+        dest -= b;
+        REQUIRE(bits_of(dest) == combine(A, B, [](bool x, bool y) { return x && !y; }));
+        require_window(dest, false);
+    }
+}
+
+TEST_CASE("ranged operations fit the window", "[bitset]") {
+    const size_type n = GENERATE(1, 64, 65, 200, 1000);
+    std::mt19937 rng(static_cast<unsigned>(n));
+    std::uniform_int_distribution<size_type> position(0, n-1);
+
+    for (int i = 0; i < 50; ++i) {
+        const auto a = random_bitset(n, rng);
+        const auto b = random_bitset(n, rng);
+        // both are positions: the ranged operations read the block of end too
+        const auto start = position(rng);
+        const auto end = std::uniform_int_distribution<size_type>(start, n-1)(rng);
+
+        const auto check = [&](const std::function<void(custom_bitset&)>& op, const bool fitted) {
+            auto dest = random_bitset(n, rng);
+            op(dest);
+            require_window(dest, fitted);
+        };
+
+        check([&](auto& d) { custom_bitset::AND(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::AND(d, a, b, start, end); }, true);
+        check([&](auto& d) { custom_bitset::OR(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::OR(d, a, b, start, end); }, true);
+        check([&](auto& d) { custom_bitset::XOR(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::NOR(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::NOR(d, a, b, start, end); }, true);
+        check([&](auto& d) { custom_bitset::DIFF(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::DIFF(d, a, b, start, end); }, true);
+        check([&](auto& d) { custom_bitset::AND_count(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::DIFF_count(d, a, b, end); }, true);
+        check([&](auto& d) { custom_bitset::AND(d, b, end); }, true);
+        check([&](auto& d) { custom_bitset::OR(d, b, start, end); }, true);
+        check([&](auto& d) { custom_bitset::DIFF(d, b, start, end); }, true);
+
+        // copies of a range clear the rest without trimming. AFTER(pos) clears before pos+1, a position too
+        check([&](auto& d) { custom_bitset::BEFORE(d, a, end); }, false);
+        if (n > 1) check([&](auto& d) { custom_bitset::AFTER(d, a, std::min(start, n-2)); }, false);
+        check([&](auto& d) { custom_bitset::FROM(d, a, start); }, false);
+    }
+}
+
+TEST_CASE("hierarchical_bitset single bit operations match custom_bitset", "[bitset][hierarchical]") {
+    const size_type n = GENERATE(1, 64, 65, 4096, 4097, 8297, 20000);
+    std::mt19937 rng(static_cast<unsigned>(n));
+    std::uniform_int_distribution<size_type> position(0, n-1);
+
+    hierarchical_bitset h(n);
+    custom_bitset expected(n);
+    const auto other = scattered_bitset(n, rng);
+    for (int i = 0; i < 200; ++i) {
+        const auto pos = position(rng);
+        switch (i % 4) {
+            case 0: h.set(pos); expected.set(pos); break;
+            case 1: h.flip(pos); expected.flip(pos); break;
+            // reset what is there, so that blocks go back to zero too
+            case 2: if (const auto ref = h.front(); ref != custom_bitset::npos) { h.reset(ref); expected.reset(ref); } break;
+            case 3: h.set(pos, false); expected.set(pos, false); break;
+        }
+        if (i % 10 == 0) require_same(h, expected, other);
+    }
+    require_same(h, expected, other);
+}
+
+TEST_CASE("hierarchical_bitset bulk operations rebuild the summary", "[bitset][hierarchical]") {
+    const size_type n = GENERATE(1, 64, 65, 4096, 4097, 8297, 20000);
+    std::mt19937 rng(static_cast<unsigned>(n));
+    std::uniform_int_distribution<size_type> position(0, n-1);
+
+    for (int i = 0; i < 10; ++i) {
+        const auto a = scattered_bitset(n, rng);
+        const auto b = scattered_bitset(n, rng);
+        const auto other = scattered_bitset(n, rng);
+        const auto end = position(rng);
+
+        // dest starts with bits of its own, so stale summary bits would show
+        const auto check = [&](const char* name, const std::function<void(hierarchical_bitset&)>& op, const std::function<void(custom_bitset&)>& model) {
+            INFO(name);
+            const auto start = scattered_bitset(n, rng);
+            hierarchical_bitset h(start);
+            auto expected = start;
+            op(h);
+            model(expected);
+            require_same(h, expected, other);
+        };
+
+        check("AND", [&](auto& d) { hierarchical_bitset::AND(d, a, b); }, [&](auto& d) { custom_bitset::AND(d, a, b); });
+        check("OR", [&](auto& d) { hierarchical_bitset::OR(d, a, b); }, [&](auto& d) { custom_bitset::OR(d, a, b); });
+        check("XOR", [&](auto& d) { hierarchical_bitset::XOR(d, a, b); }, [&](auto& d) { custom_bitset::XOR(d, a, b); });
+        check("NAND", [&](auto& d) { hierarchical_bitset::NAND(d, a, b); }, [&](auto& d) { custom_bitset::NAND(d, a, b); });
+        check("NOR", [&](auto& d) { hierarchical_bitset::NOR(d, a, b); }, [&](auto& d) { custom_bitset::NOR(d, a, b); });
+        check("NOR before end", [&](auto& d) { hierarchical_bitset::NOR(d, a, b, end); }, [&](auto& d) { custom_bitset::NOR(d, a, b, end); });
+        check("NXOR", [&](auto& d) { hierarchical_bitset::NXOR(d, a, b); }, [&](auto& d) { custom_bitset::NXOR(d, a, b); });
+        check("DIFF", [&](auto& d) { hierarchical_bitset::DIFF(d, a, b); }, [&](auto& d) { custom_bitset::DIFF(d, a, b); });
+        check("&=", [&](auto& d) { d &= a; }, [&](auto& d) { d &= a; });
+        check("|=", [&](auto& d) { d |= a; }, [&](auto& d) { d |= a; });
+        check("^=", [&](auto& d) { d ^= a; }, [&](auto& d) { d ^= a; });
+        check("-=", [&](auto& d) { d -= a; }, [&](auto& d) { d -= a; });
+        check("=", [&](auto& d) { d = a; }, [&](auto& d) { d = a; });
+        check("copy_same_size", [&](auto& d) { d.copy_same_size(a); }, [&](auto& d) { d.copy_same_size(a); });
+        check("set", [&](auto& d) { d.set(); }, [&](auto& d) { d.set(); });
+        check("reset", [&](auto& d) { d.reset(); }, [&](auto& d) { d.reset(); });
+        check("flip", [&](auto& d) { d.flip(); }, [&](auto& d) { d.flip(); });
+        check("set_before", [&](auto& d) { d.set_before(end); }, [&](auto& d) { d.set_before(end); });
+    }
+}
@@ -0,0 +1,113 @@
+#include <utility>
+#include <catch2/catch_test_macros.hpp>
+
+#include "inplace_function.h"
+
+namespace {
+    struct counts {
+        int copies = 0;
+        int moves = 0;
+        int destroys = 0;
+        int calls = 0;
+    };
+
+    // a callable that counts what happens to it
+    struct counted {
+        counts* c;
+
+        explicit counted(counts* c) : c(c) {}
+        counted(const counted& other) : c(other.c) { ++c->copies; }
+        counted(counted&& other) noexcept : c(other.c) { ++c->moves; }
+        ~counted() { ++c->destroys; }
+
+        int operator()(const int x) const {
+            ++c->calls;
+            return 2*x;
+        }
+    };
+
+    using function = inplace_function<int(int), 32>;
+}
+
+TEST_CASE("inplace_function copies an lvalue and moves an rvalue once", "[inplace_function]") {
+    counts c;
+    {
+        const counted fn(&c);
+        function f(fn);
+        REQUIRE(c.copies == 1);
+        REQUIRE(c.moves == 0);
+
+        function g(counted{&c});
+        REQUIRE(c.copies == 1);
+        REQUIRE(c.moves == 1);
+        REQUIRE(c.destroys == 1);   // the temporary
+
+        REQUIRE(f(3) == 6);
+        REQUIRE(g(4) == 8);
+        REQUIRE(c.calls == 2);
+    }
+    // fn, the copy in f and the one moved into g
+    REQUIRE(c.destroys == 4);
+}
+
+TEST_CASE("moving an inplace_function relocates the callable and empties the source", "[inplace_function]") {
+    counts c;
+    {
+        function f(counted{&c});
+        c = {};
+
+        function g(std::move(f));
+        REQUIRE_FALSE(f);
+        REQUIRE(g);
+        REQUIRE(c.moves == 1);
+        REQUIRE(c.destroys == 1);   // the callable left in f
+        REQUIRE(c.copies == 0);
+
+        // from an empty one: nothing to relocate
+        function h(std::move(f));
+        REQUIRE_FALSE(h);
+        REQUIRE(c.moves == 1);
+        REQUIRE(c.destroys == 1);
+
+        // assigned over a full one: its callable goes first
+        function k(counted{&c});
+        c = {};
+        k = std::move(g);
+        REQUIRE_FALSE(g);
+        REQUIRE(c.destroys == 2);   // k's own, then the one left in g
+        REQUIRE(c.moves == 1);
+        REQUIRE(k(5) == 10);
+
+        // assigning an empty one empties
+        k = std::move(g);
+        REQUIRE_FALSE(k);
+        REQUIRE(c.destroys == 3);
+
+        // to itself: nothing happens
+        function s(counted{&c});
+        c = {};
+        auto& self = s;
+        s = std::move(self);
+        REQUIRE(s);
+        REQUIRE(c.moves == 0);
+        REQUIRE(c.destroys == 0);
+        c = {};
+    }
+    // only s still held a callable
+    REQUIRE(c.destroys == 1);
+    REQUIRE(c.copies == 0);
+}
+
+TEST_CASE("reset destroys the callable once", "[inplace_function]") {
+    counts c;
+    {
+        function f(counted{&c});
+        c = {};
+        f.reset();
+        REQUIRE_FALSE(f);
+        REQUIRE(c.destroys == 1);
+        f.reset();
+        REQUIRE(c.destroys == 1);
+    }
+    REQUIRE(c.destroys == 1);
+}
@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "csr_graph.h"
+#include "custom_graph.h"
+#include "parsing.h"
+
+namespace {
+    using edge = std::pair<std::size_t, std::size_t>;
+
+    // edges {u, v} of S as u < v, sorted
+    std::vector<edge> edges_of(const csr_graph& S) {
+        std::vector<edge> edges;
+        for (std::size_t u = 0; u < S.size(); ++u)
+            for (const auto v : S.get_neighbors(u))
+                if (u < v) edges.emplace_back(u, v);
+        return edges;
+    }
+
+    // text parsed as parse_whole does, with the body split in (up to) pieces pieces as if by as many threads
+    template <typename Parser>
+    csr_graph parse_in_pieces(Parser parser, const std::string_view text, const std::size_t pieces) {
+        const auto body = text.substr(*parser.header(text, true));
+        const auto split = split_lines(body, pieces);
+        std::vector<typename Parser::part> parts(split.size());
+        for (std::size_t i = 0; i < split.size(); ++i) parsing_detail::parse_part(parser, split[i], parts[i]);
+        return parser.finish(parts, split, parsing_detail::build_csr);
+    }
+
+    csr_graph parse_dimacs_in_pieces(const std::string_view text, const std::size_t pieces) {
+        return parse_in_pieces(parsing_detail::dimacs_parser{}, text, pieces);
+    }
+
+    std::string read_file(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+}
+
+TEST_CASE("DIMACS graphs are the same in any number of pieces", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3, 5, 8, 16);
+
+    SECTION("p edge") {
+        const std::string text =
+            "c a comment\n"
+            "\n"
+            "p edge 6 7\n"
+            "e 1 2\n"
+            "c a comment in the body\n"
+            "e 2 3\r\n"
+            "e 3 1\n"
+            "\n"
+            "e\t4 5\n"
+            "e 5 4\n"
+            "e 6 6\n"
+            "e 1 6\n";
+        const auto S = parse_dimacs_in_pieces(text, pieces);
+        REQUIRE(S.size() == 6);
+        // (5, 4) is the same edge as (4, 5), (6, 6) a self loop
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {0, 2}, {0, 5}, {1, 2}, {3, 4}});
+    }
+
+    SECTION("p clique") {
+        const std::string text =
+            "p clique 7 2 2\n"
+            "e 1 7\n"
+            "q 3 1 2 3\n"
+            "e 6 7\n"
+            "q 4 4 5 6 7\n";
+        const auto S = parse_dimacs_in_pieces(text, pieces);
+        REQUIRE(S.size() == 7);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {0, 2}, {0, 6}, {1, 2}, {3, 4}, {3, 5}, {3, 6}, {4, 5}, {4, 6}, {5, 6}});
+    }
+
+    SECTION("nothing declared") {
+        const auto S = parse_dimacs_in_pieces("p edge 3 0\ne 1 2\n", pieces);
+        REQUIRE(S.size() == 3);
+        REQUIRE(S.get_n_edges() == 0);
+    }
+}
+
+TEST_CASE("DIMACS reading stops at the declared counts", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3, 4, 7);
+
+    SECTION("garbage after the last declared line is ignored") {
+        const auto S = parse_dimacs_in_pieces("p edge 4 2\ne 1 2\ne 2 3\nthis is not DIMACS\ne 9 9\np edge 1 1\n", pieces);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {1, 2}});
+    }
+
+    SECTION("more lines than declared") {
+        const auto S = parse_dimacs_in_pieces("p edge 4 2\ne 1 2\ne 2 3\ne 3 4\ne 1 4\n", pieces);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {1, 2}});
+    }
+
+    SECTION("the last clique stops it") {
+        const auto S = parse_dimacs_in_pieces("p clique 5 1 1\ne 4 5\nq 3 1 2 3\nq 2 1 5\ngarbage\n", pieces);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {0, 2}, {1, 2}, {3, 4}});
+    }
+
+    SECTION("fewer lines than declared: the graph has the ones there are") {
+        const auto S = parse_dimacs_in_pieces("p edge 4 5\ne 1 2\ne 2 3\n", pieces);
+        REQUIRE(S.size() == 4);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {1, 2}});
+    }
+}
+
+TEST_CASE("DIMACS errors before the stop throw", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3, 5);
+    const std::string text = GENERATE(
+        "p edge 4 3\ne 1 2\nx 1 2\ne 2 3\ne 3 4\n",         // unknown line
+        "p edge 4 3\ne 1 2\ne 2 5\ne 3 4\n",                // vertex out of range
+        "p edge 4 3\ne 1 2\ne 0 2\ne 3 4\n",                // vertices are 1-based
+        "p edge 4 3\ne 1 2\ne 2 three\ne 3 4\n",            // not a number
+        "p edge 4 3\ne 1 2\np edge 4 3\ne 3 4\n",           // second problem line
+        "p clique 4 0 2\nq 3 1 2\nq 2 3 4\n",               // incomplete clique
+        "p clique 4 0 2\nq 2 1 2 3\nq 2 3 4\n",             // too many nodes in clique
+        "p clique 4 0 2\nq 2 1 5\nq 2 3 4\n",               // wrong node in clique
+        "p edge 4 3\ne 1 2\ne 2 3\nthe error is here\n");   // fewer lines, the error comes before the stop
+
+    REQUIRE_THROWS_AS(parse_dimacs_in_pieces(text, pieces), std::runtime_error);
+}
+
+TEST_CASE("DIMACS header errors throw", "[parsing]") {
+    const std::string text = GENERATE(
+        "e 1 2\np edge 2 1\n",      // edge before the problem line
+        "q 2 1 2\n",
+        "x\n",
+        "p graph 2 1\ne 1 2\n",     // unknown problem
+        "p edge two 1\n",
+        "p clique 2 1\n");          // without the clique count
+
+    REQUIRE_THROWS_AS(parse_dimacs_text(text), std::runtime_error);
+}
+
+TEST_CASE("parse_graph matches a line by line reading of C250.9", "[parsing]") {
+    const auto filename = std::string(CLISAT_EXAMPLES_DIR) + "/C250.9.clq";
+
+    // the plain reading: 'p' gives the size, every 'e' line is an edge
+    custom_graph R;
+    std::ifstream in(filename);
+    for (std::string line; std::getline(in, line);) {
+        std::istringstream tokens(line);
+        std::string type;
+        tokens >> type;
+        if (type == "p") {
+            std::string problem;
+            std::size_t n;
+            tokens >> problem >> n;
+            R = custom_graph(n);
+        } else if (type == "e") {
+            std::size_t u, v;
+            tokens >> u >> v;
+            R.add_edge(u-1, v-1);
+        }
+    }
+    REQUIRE(R.size() == 250);
+
+    const auto G = parse_graph(filename);
+    REQUIRE(G.size() == R.size());
+    for (std::size_t v = 0; v < G.size(); ++v) REQUIRE(G[v] == R[v]);
+
+    // the csr_graph, from the file and from the text in several pieces
+    const auto text = read_file(filename);
+    for (const auto& S : {parse_sparse_graph(filename), parse_dimacs_in_pieces(text, 7)}) {
+        REQUIRE(S.size() == R.size());
+        REQUIRE(S.get_n_edges() == G.get_n_edges());
+        for (std::size_t v = 0; v < S.size(); ++v)
+            for (const auto w : S.get_neighbors(v)) REQUIRE(R.adjacent(v, w));
+    }
+}
+
+TEST_CASE("MTX entries of every field and symmetry become edges", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3, 6);
+    const std::vector<edge> expected = {{0, 1}, {0, 3}, {1, 2}};
+
+    SECTION("general pattern, both triangles stored") {
+        const auto S = parse_in_pieces(parsing_detail::mtx_parser{}, "%%MatrixMarket matrix coordinate pattern general\n% a comment\n\n4 4 6\n2 1\n1 2\n3 2\n2 3\n% another\n4 1\n1 4\n", pieces);
+        REQUIRE(S.size() == 4);
+        REQUIRE(edges_of(S) == expected);
+    }
+
+    SECTION("symmetric real, lower triangle") {
+        const auto S = parse_in_pieces(parsing_detail::mtx_parser{}, "%%MatrixMarket matrix coordinate real symmetric\n4 4 3\n2 1 0.5\n3 2 -1e-3\n4 1 7\n", pieces);
+        REQUIRE(edges_of(S) == expected);
+    }
+
+    SECTION("integer, any value is an edge") {
+        const auto S = parse_in_pieces(parsing_detail::mtx_parser{}, "%%MatrixMarket matrix coordinate integer general\n4 4 3\n2 1 0\n3 2 -4\n4 1 12\n", pieces);
+        REQUIRE(edges_of(S) == expected);
+    }
+
+    SECTION("complex hermitian, two values") {
+        const auto S = parse_in_pieces(parsing_detail::mtx_parser{}, "%%MatrixMarket matrix coordinate complex hermitian\n4 4 3\n2 1 1.0 -2.5\n3 2 0 0\n4 1\t3 4\n", pieces);
+        REQUIRE(edges_of(S) == expected);
+    }
+
+    SECTION("skew-symmetric, keywords in any case") {
+        const auto S = parse_in_pieces(parsing_detail::mtx_parser{}, "%%matrixmarket MATRIX Coordinate REAL Skew-Symmetric\n4 4 3\n2 1 1\n3 2 1\n4 1 1\n", pieces);
+        REQUIRE(edges_of(S) == expected);
+    }
+
+    SECTION("diagonal entries count, but are no edges") {
+        const auto S = parse_in_pieces(parsing_detail::mtx_parser{}, "%%MatrixMarket matrix coordinate pattern symmetric\n4 4 6\n1 1\n2 1\n2 2\n3 2\n4 1\n4 4\n", pieces);
+        REQUIRE(edges_of(S) == expected);
+    }
+}
+
+TEST_CASE("MTX errors throw", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 4);
+    const std::string text = GENERATE(
+        "%%MatrixMarket matrix coordinate pattern general\n4 4 3\n2 1\n3 2\n",             // fewer entries than declared
+        "%%MatrixMarket matrix coordinate pattern general\n4 4 1\n2 1\n3 2\n",             // more entries than declared
+        "%%MatrixMarket matrix coordinate pattern general\n4 3 1\n2 1\n",                  // not square
+        "%%MatrixMarket matrix coordinate pattern general\n4 4\n2 1\n",                    // no entry count
+        "%%MatrixMarket matrix coordinate pattern general\n% only comments\n",             // no size line
+        "%%MatrixMarket matrix coordinate pattern general\n4 4 1\n2 5\n",                  // vertex out of range
+        "%%MatrixMarket matrix coordinate pattern general\n4 4 1\n0 1\n",                  // vertices are 1-based
+        "%%MatrixMarket matrix coordinate pattern general\n4 4 1\n2 1 1\n",                // a value in a pattern
+        "%%MatrixMarket matrix coordinate real general\n4 4 1\n2 1\n",                     // a missing value
+        "%%MatrixMarket matrix coordinate real general\n4 4 1\n2 1 x\n",                   // not a number
+        "%%MatrixMarket matrix coordinate complex general\n4 4 1\n2 1 1\n",                // half a complex value
+        "%%MatrixMarket matrix coordinate complex general\n4 4 1\n2 1 1 2 3\n");           // too many values
+
+    REQUIRE_THROWS_AS(parse_in_pieces(parsing_detail::mtx_parser{}, text, pieces), std::runtime_error);
+}
+
+TEST_CASE("MTX banners", "[parsing]") {
+    using header = MTX_header;
+
+    const auto banner = parsing_detail::parse_mtx_banner("%%MatrixMarket matrix coordinate real symmetric");
+    REQUIRE(banner.object == header::object_enum::MATRIX);
+    REQUIRE(banner.format == header::format_enum::COORDINATE);
+    REQUIRE(banner.field == header::field_enum::REAL);
+    REQUIRE(banner.symmetry == header::symmetry_enum::SYMMETRIC);
+    REQUIRE(parsing_detail::mtx_values(banner) == 1);
+
+    REQUIRE(parsing_detail::mtx_values(parsing_detail::parse_mtx_banner("%%MatrixMarket matrix coordinate pattern general")) == 0);
+    REQUIRE(parsing_detail::mtx_values(parsing_detail::parse_mtx_banner("%%MatrixMarket matrix coordinate integer general")) == 1);
+    REQUIRE(parsing_detail::mtx_values(parsing_detail::parse_mtx_banner("%%MatrixMarket matrix coordinate complex hermitian")) == 2);
+    REQUIRE(parsing_detail::parse_mtx_banner("%%MATRIXMARKET Matrix COORDINATE Integer GENERAL").field == header::field_enum::INTEGER);
+
+    const std::string wrong = GENERATE(
+        "%MatrixMarket matrix coordinate real general",     // not the banner
+        "%%MatrixMarket matrix array real general",         // dense, no structure
+        "%%MatrixMarket vector coordinate real general",
+        "%%MatrixMarket matrix coordinate real",            // no symmetry
+        "%%MatrixMarket matrix coordinate text general",    // unknown field
+        "%%MatrixMarket matrix coordinate pattern hermitian",
+        "%%MatrixMarket matrix coordinate real hermitian",
+        "%%MatrixMarket matrix coordinate pattern skew-symmetric");
+
+    REQUIRE_THROWS_AS(parsing_detail::parse_mtx_banner(wrong), std::runtime_error);
+}
+
+TEST_CASE("sniff_format tells the formats apart", "[parsing]") {
+    const auto wiki_vote = std::string(CLISAT_EXAMPLES_DIR) + "/wiki-Vote.mtx";
+    const auto text = read_file(wiki_vote);
+    REQUIRE(sniff_format(text) == graph_format::MATRIX_MARKET);
+    REQUIRE(sniff_format(text, wiki_vote) == graph_format::MATRIX_MARKET);
+    // the banner wins over the name
+    REQUIRE(sniff_format(text, "wiki-Vote.graph") == graph_format::MATRIX_MARKET);
+
+    REQUIRE(sniff_format("\n  \r\n%%matrixmarket matrix coordinate pattern general\n") == graph_format::MATRIX_MARKET);
+    // and the parser skips the same blank lines
+    REQUIRE(parse_text("\n  \r\n%%matrixmarket matrix coordinate pattern general\n2 2 1\n2 1\n").get_n_edges() == 1);
+    REQUIRE(sniff_format("c a comment\np edge 2 1\n") == graph_format::DIMACS);
+    REQUIRE(sniff_format("p edge 2 1\n") == graph_format::DIMACS);
+    REQUIRE(sniff_format("") == graph_format::DIMACS);
+    REQUIRE(sniff_format("1 2\n") == graph_format::EDGE_LIST);
+    REQUIRE(sniff_format("# a SNAP header\n1 2\n") == graph_format::EDGE_LIST);
+    REQUIRE(sniff_format("% a KONECT header\n1 2\n") == graph_format::EDGE_LIST);
+    REQUIRE(sniff_format("3 2\n2\n1 3\n2\n", "g.graph") == graph_format::METIS);
+    REQUIRE(sniff_format("3 2\n2\n1 3\n2\n", "g.metis.gz") == graph_format::METIS);
+    REQUIRE(sniff_format("3 2\n2\n1 3\n2\n", "g.txt") == graph_format::EDGE_LIST);
+
+    // and the whole file, read by the sniffed parser
+    const auto S = parse_text(text, wiki_vote);
+    REQUIRE(S.size() == 8297);
+    REQUIRE(S.get_n_edges() == 100762);
+    REQUIRE(edges_of(parse_in_pieces(parsing_detail::mtx_parser{}, text, 5)) == edges_of(S));
+}
+
+TEST_CASE("edge lists are 0-based only if vertex 0 appears", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3, 5);
+
+    SECTION("1-based") {
+        const auto S = parse_in_pieces(parsing_detail::edge_list_parser{}, "# a SNAP header\n1 2\n2 3\t1.5\n% a comment\n\n3 1 extra columns\n5 4\n", pieces);
+        REQUIRE(S.size() == 5);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {0, 2}, {1, 2}, {3, 4}});
+    }
+
+    SECTION("0-based, vertex 0 only in the last piece") {
+        const auto S = parse_in_pieces(parsing_detail::edge_list_parser{}, "1 2\n2 3\n3 4\n4 5\n0 5\n", pieces);
+        REQUIRE(S.size() == 6);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 5}, {1, 2}, {2, 3}, {3, 4}, {4, 5}});
+    }
+
+    SECTION("a self loop on vertex 0") {
+        const auto S = parse_in_pieces(parsing_detail::edge_list_parser{}, "0 0\n", pieces);
+        REQUIRE(S.size() == 1);
+        REQUIRE(S.get_n_edges() == 0);
+    }
+
+    SECTION("no edges, no vertices") {
+        const auto S = parse_in_pieces(parsing_detail::edge_list_parser{}, "# only\n% comments\n\n", pieces);
+        REQUIRE(S.size() == 0);
+    }
+}
+
+TEST_CASE("edge list errors throw", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3);
+    const std::string text = GENERATE(
+        "1 2\n3\n4 5\n",                // one vertex only
+        "1 2\na b\n4 5\n",
+        "1 2\n-1 2\n4 5\n",
+        "1 2\n1 4294967295\n4 5\n");    // the largest id is kept for no vertex
+
+    REQUIRE_THROWS_AS(parse_in_pieces(parsing_detail::edge_list_parser{}, text, pieces), std::runtime_error);
+}
+
+TEST_CASE("METIS weights and empty vertex lines", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3, 4, 6);
+    const std::vector<edge> path = {{0, 1}, {1, 2}};
+
+    SECTION("no weights") {
+        const auto S = parse_in_pieces(parsing_detail::metis_parser{}, "% a comment\n3 2\n2\n1 3\n% a comment between vertices\n2\n", pieces);
+        REQUIRE(S.size() == 3);
+        REQUIRE(edges_of(S) == path);
+    }
+
+    SECTION("edge weights, fmt 1") {
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 1\n2 5\n1 5 3 7\n2 7\n", pieces)) == path);
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 001\n2 5\n1 5 3 7\n2 7\n", pieces)) == path);
+    }
+
+    SECTION("one vertex weight, fmt 10") {
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 10\n4 2\n4 1 3\n4 2\n", pieces)) == path);
+    }
+
+    SECTION("ncon vertex weights and edge weights, fmt 11") {
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 11 3\n1 1 1 2 5\n1 1 1 1 5 3 7\n1 1 1 2 7\n", pieces)) == path);
+    }
+
+    SECTION("ncon without vertex weights is ignored") {
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 1 3\n2 5\n1 5 3 7\n2 7\n", pieces)) == path);
+    }
+
+    SECTION("vertex sizes, fmt 100 and 111") {
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 100\n9 2\n9 1 3\n9 2\n", pieces)) == path);
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 2 111 2\n9 1 1 2 5\n9 1 1 1 5 3 7\n9 1 1 2 7\n", pieces)) == path);
+    }
+
+    SECTION("empty lines are vertices without neighbours, also at the end") {
+        const auto S = parse_in_pieces(parsing_detail::metis_parser{}, "5 2\n\n3\n2 4\n3\n\n", pieces);
+        REQUIRE(S.size() == 5);
+        REQUIRE(edges_of(S) == std::vector<edge>{{1, 2}, {2, 3}});
+
+        // more empty lines after the last vertex are fine
+        REQUIRE(edges_of(parse_in_pieces(parsing_detail::metis_parser{}, "3 1\n2\n1\n\n\n\n\n", pieces)) == std::vector<edge>{{0, 1}});
+    }
+}
+
+TEST_CASE("METIS rows are offset by the rows of the pieces before", "[parsing]") {
+    // a cycle of n vertices, with an empty line (isolated vertex n+1) in the middle of the rows
+    constexpr std::size_t n = 40;
+    std::string text = std::to_string(n+1) + " " + std::to_string(n) + "\n";
+    std::vector<edge> expected;
+    for (std::size_t v = 1; v <= n; ++v) {
+        const auto prev = v == 1 ? n : v-1;
+        const auto next = v == n ? 1 : v+1;
+        text += std::to_string(prev) + " " + std::to_string(next) + "\n";
+        if (v == n/2) text += "% the next vertex is the isolated one, moved to the end\n";
+        expected.emplace_back(std::min(v, next) - 1, std::max(v, next) - 1);
+    }
+    text += "\n";
+    std::ranges::sort(expected);
+
+    const std::size_t pieces = GENERATE(1, 2, 3, 7, 16, 50);
+    const auto S = parse_in_pieces(parsing_detail::metis_parser{}, text, pieces);
+    REQUIRE(S.size() == n+1);
+    REQUIRE(edges_of(S) == expected);
+}
+
+TEST_CASE("METIS errors throw", "[parsing]") {
+    const std::size_t pieces = GENERATE(1, 2, 3);
+    const std::string text = GENERATE(
+        "3 2\n2\n1 3\n2\n1\n",          // more vertex lines than vertices
+        "3 2\n2\n1 3\n",                // fewer
+        "3 2\n2\n1\n\n",                // fewer neighbours than 2m
+        "3 1\n2\n1 3\n2\n",             // more
+        "3 2\n2\n1 4\n2\n",             // neighbour out of range
+        "3 2\n2\n1 0\n2\n",             // neighbours are 1-based
+        "3 2 1\n2 5\n1 5 3\n2 7\n",     // a missing edge weight
+        "3 2 1\n2 x\n1 5 3 7\n2 7\n",
+        "3 2 10\nw 2\n4 1 3\n4 2\n",    // a wrong vertex weight
+        "3 2 12\n2\n1 3\n2\n",          // fmt digits are 0 or 1
+        "3 2 1111\n2\n1 3\n2\n",        // up to 3 of them
+        "3\n2\n1 3\n2\n",               // no edge count
+        "% only a comment\n",           // no header
+        "4294967295 0\n");              // too many vertices
+
+    REQUIRE_THROWS_AS(parse_in_pieces(parsing_detail::metis_parser{}, text, pieces), std::runtime_error);
+}
+
+#if defined(CLISAT_HAVE_ZLIB)
+TEST_CASE("gzip members are inflated one after the other", "[parsing]") {
+    const auto filename = std::string(CLISAT_TEST_DATA_DIR) + "/two_members.clq.gz";
+    const auto compressed = read_file(filename);
+    REQUIRE(is_gzip(compressed));
+    REQUIRE_FALSE(is_gzip("p edge 5 4\n"));
+
+    // what gunzip_reader gives, asking for max bytes a time
+    const auto inflate = [](const std::string& bytes, const std::size_t max) {
+        const auto in = gunzip_reader(view_reader(bytes));
+        std::string text(max, '\0');
+        std::string out;
+        for (std::size_t read; (read = in(text.data(), max)) > 0;) out.append(text, 0, read);
+        // and nothing more at the end
+        REQUIRE(in(text.data(), max) == 0);
+        return out;
+    };
+
+    const std::size_t max = GENERATE(1, 3, 64, 1 << 16);
+    REQUIRE(inflate(compressed, max) == "c first member\np edge 5 4\ne 1 2\ne 2 3\ne 1 3\ne 4 5\n");
+
+    SECTION("the graph spans both members") {
+        const std::vector<edge> expected = {{0, 1}, {0, 2}, {1, 2}, {3, 4}};
+        REQUIRE(edges_of(parse_dimacs_extended(filename)) == expected);
+        REQUIRE(edges_of(parse_sparse_graph(filename)) == expected);
+        REQUIRE(parse_graph(filename).get_n_edges() == 4);
+    }
+
+    SECTION("truncated") {
+        REQUIRE_THROWS_AS(inflate(compressed.substr(0, compressed.size() - 6), max), std::runtime_error);
+    }
+
+    SECTION("corrupted") {
+        auto corrupted = compressed;
+        corrupted[20] = static_cast<char>(~corrupted[20]);
+        REQUIRE_THROWS_AS(inflate(corrupted, max), std::runtime_error);
+    }
+
+    SECTION("garbage after the last member") {
+        REQUIRE_THROWS_AS(inflate(compressed + "garbage", max), std::runtime_error);
+    }
+
+    SECTION("not compressed") {
+        REQUIRE_THROWS_AS(inflate("p edge 5 4\n", max), std::runtime_error);
+    }
+}
+#endif
+
+namespace {
+    // data at most bytes a call, as a pipe may give it
+    byte_reader trickle_reader(std::string data, const std::size_t bytes) {
+        return [data = std::move(data), bytes, pos = std::size_t{0}](char* dst, const std::size_t max) mutable {
+            const auto n = std::min({bytes, max, data.size() - pos});
+            std::copy_n(data.data() + pos, n, dst);
+            pos += n;
+            return n;
+        };
+    }
+
+    // the text through parse_stream, bytes a read, and through parse_whole with the parser it sniffs
+    void require_same_as_whole(const std::string& text, const std::string_view name, const std::size_t bytes) {
+        const auto streamed = parsing_detail::parse_stream(trickle_reader(text, bytes), name, std::nullopt, parsing_detail::build_csr);
+        const auto whole = parsing_detail::with_parser(sniff_format(text, name), [&](auto parser) {
+            return parsing_detail::parse_whole(parser, text, parsing_detail::build_csr);
+        });
+        REQUIRE(streamed.size() == whole.size());
+        REQUIRE(edges_of(streamed) == edges_of(whole));
+    }
+}
+
+TEST_CASE("streams read a few bytes at a time give the graph of the whole text", "[parsing]") {
+    const std::size_t bytes = GENERATE(1, 2, 3, 7, 64);
+
+    SECTION("DIMACS, the header split across reads") {
+        require_same_as_whole("c a comment\n\np clique 7 2 2\ne 1 7\nq 3 1 2 3\ne 6 7\nq 4 4 5 6 7\ngarbage after the stop\n", {}, bytes);
+    }
+
+    SECTION("MTX, the banner after blank lines") {
+        require_same_as_whole("\n\n%%MatrixMarket matrix coordinate real symmetric\n% a comment\n4 4 3\n2 1 0.5\n3 2 -1e-3\n4 1 7\n", {}, bytes);
+    }
+
+    SECTION("edge list, no newline at the end") {
+        require_same_as_whole("# a header\n0 1\n1 2 7\n2 3", {}, bytes);
+    }
+
+    SECTION("METIS, told by the name") {
+        require_same_as_whole("5 2\n\n3\n2 4\n3\n\n", "g.graph", bytes);
+    }
+
+    SECTION("CRLF lines") {
+        require_same_as_whole("p edge 4 3\r\ne 1 2\r\ne 2 3\r\ne 3 4\r\n", {}, bytes);
+    }
+}
+
+TEST_CASE("streams of several chunks give the graph of the whole text", "[parsing]") {
+    const auto chunk = parsing_detail::stream_chunk_bytes;
+
+    SECTION("lines cut at the chunk boundaries") {
+        // about 2.5 chunks of edges, none of them at a line boundary
+        std::string text = "p edge 100000 0\n";
+        std::size_t edges = 0;
+        for (std::size_t u = 1; text.size() < 5*chunk/2; ++u, ++edges) {
+            text += "e " + std::to_string(u % 100000 + 1) + " " + std::to_string((u * 7919) % 100000 + 1) + "\n";
+        }
+        text.replace(0, text.find('\n'), "p edge 100000 " + std::to_string(edges));
+        const std::size_t bytes = GENERATE(4093, 1 << 20);
+        require_same_as_whole(text, {}, bytes);
+    }
+
+    SECTION("a line longer than a chunk") {
+        const std::string text = "1 2\n# " + std::string(chunk + chunk/2, 'x') + "\n2 3\n3 1\n";
+        require_same_as_whole(text, {}, 1 << 16);
+        require_same_as_whole("c " + std::string(2*chunk, 'c') + "\np edge 3 2\ne 1 2\ne 2 3\n", {}, 1 << 16);
+    }
+
+    SECTION("the declared counts reached in the first chunk, garbage in the others") {
+        const std::string text = "p edge 3 2\ne 1 2\ne 2 3\n" + std::string(3*chunk, 'x') + "\n";
+        const auto S = parsing_detail::parse_stream(trickle_reader(text, 1 << 20), {}, std::nullopt, parsing_detail::build_csr);
+        REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {1, 2}});
+    }
+}
+
+#if defined(CLISAT_HAVE_ZLIB)
+TEST_CASE("gzip streams read a few bytes at a time", "[parsing]") {
+    const auto compressed = read_file(std::string(CLISAT_TEST_DATA_DIR) + "/two_members.clq.gz");
+    const std::size_t bytes = GENERATE(1, 2, 5, 1 << 16);
+
+    const auto S = parsing_detail::parse_stream(trickle_reader(compressed, bytes), "two_members.clq.gz", std::nullopt, parsing_detail::build_csr);
+    REQUIRE(S.size() == 5);
+    REQUIRE(edges_of(S) == std::vector<edge>{{0, 1}, {0, 2}, {1, 2}, {3, 4}});
+}
+#endif
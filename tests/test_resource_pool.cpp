@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "resource_pool.h"
+
+namespace {
+    // marked while borrowed, so a second borrower finds it taken
+    struct resource {
+        std::size_t arg;
+        std::atomic<int> borrowers = 0;
+
+        explicit resource(const std::size_t arg) : arg(arg) {}
+    };
+}
+
+TEST_CASE("a resource_pool gives every object back out, built with its argument", "[resource_pool]") {
+    resource_pool<resource> pool(42);
+    pool.reserve(3);
+    REQUIRE(pool.size() == 3);
+
+    std::vector<std::size_t> borrowed;
+    for (int i = 0; i < 3; ++i) borrowed.push_back(pool.borrow(nullptr));
+    // the reserved ones are all out: a new one
+    borrowed.push_back(pool.borrow(nullptr));
+    REQUIRE(pool.size() == 4);
+    std::ranges::sort(borrowed);
+    REQUIRE(borrowed == std::vector<std::size_t>{0, 1, 2, 3});
+    for (const auto index : borrowed) REQUIRE(pool.get(index).arg == 42);
+
+    for (const auto index : borrowed) pool.give_back(index, nullptr);
+    for (int i = 0; i < 4; ++i) pool.borrow(nullptr);
+    REQUIRE(pool.size() == 4);
+}
+
+TEST_CASE("concurrent borrowers never hold the same object", "[resource_pool]") {
+    const std::size_t workers = GENERATE(2, 4, 8);
+    const bool cached = GENERATE(false, true);
+    constexpr int rounds = 20000;
+
+    resource_pool<resource> pool(0);
+    pool.reserve(workers);
+    std::atomic<int> shared = 0;
+
+    // failures are counted, the REQUIREs run on the main thread
+    std::vector<std::thread> threads;
+    for (std::size_t w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w] {
+            resource_cache cache;
+            pool.prepare(cache);
+            auto* const c = cached ? &cache : nullptr;
+            std::vector<std::size_t> held;
+            for (int round = 0; round < rounds; ++round) {
+                // up to 3 at once, given back in turns so that the caches fill and spill batches
+                if (held.size() < 1 + (round + w) % 3) {
+                    const auto index = pool.borrow(c);
+                    if (pool.get(index).borrowers.fetch_add(1) != 0) shared.fetch_add(1);
+                    held.push_back(index);
+                } else {
+                    for (const auto index : held) {
+                        pool.get(index).borrowers.fetch_sub(1);
+                        pool.give_back(index, c);
+                    }
+                    held.clear();
+                }
+            }
+            for (const auto index : held) {
+                pool.get(index).borrowers.fetch_sub(1);
+                pool.give_back(index, c);
+            }
+            // the cache goes with the worker: its objects back to everyone
+            while (!cache.free.empty()) {
+                pool.give_back(cache.free.back(), nullptr);
+                cache.free.pop_back();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    REQUIRE(shared == 0);
+    // every object is free again, each exactly once
+    const auto size = pool.size();
+    std::vector<int> free(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto index = pool.borrow(nullptr);
+        REQUIRE(index < size);
+        ++free[index];
+    }
+    for (const auto count : free) REQUIRE(count == 1);
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "csr_graph.h"
+#include "custom_graph.h"
+#include "snapshot.h"
+
+namespace {
+    std::string temp_snapshot(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / ("clisat_test_" + name + ".snap")).string();
+    }
+
+    snapshot::header read_header(const std::string& filename) {
+        snapshot::header h;
+        std::ifstream in(filename, std::ios::binary);
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        return h;
+    }
+
+    // overwrites the value at offset, the rest of the file is left as it is
+    template <typename T>
+    void poke(const std::string& filename, const std::uint64_t offset, const T value) {
+        std::fstream out(filename, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(static_cast<std::streamoff>(offset));
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    // the path 0 - 1 - 2 - 3
+    csr_graph path() {
+        const std::vector<csr_graph::edge_type> edges = {{0, 1}, {1, 2}, {2, 3}};
+        return {4, edges};
+    }
+}
+
+TEST_CASE("a csr snapshot reads back the graph it was written from", "[snapshot]") {
+    const auto filename = temp_snapshot("csr");
+    const auto S = path();
+    snapshot::write(filename, S, snapshot::stats_of(S));
+
+    const auto R = snapshot::file(filename).sparse_graph();
+    REQUIRE(R.size() == S.size());
+    REQUIRE(std::ranges::equal(R.offsets(), S.offsets()));
+    REQUIRE(std::ranges::equal(R.adjacency(), S.adjacency()));
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("a corrupt csr snapshot throws instead of loading", "[snapshot]") {
+    const auto filename = temp_snapshot("csr_corrupt");
+    const auto S = path();
+    snapshot::write(filename, S, snapshot::stats_of(S));
+    const auto h = read_header(filename);
+    constexpr auto offset_bytes = sizeof(csr_graph::size_type);
+
+    SECTION("offsets not monotone") {
+        poke<csr_graph::size_type>(filename, h.data_offset + offset_bytes, 4);
+    }
+    SECTION("last offset past the adjacency") {
+        poke<csr_graph::size_type>(filename, h.data_offset + 4*offset_bytes, S.adjacency().size() + 1);
+    }
+    SECTION("neighbour out of range") {
+        poke<csr_graph::vertex_type>(filename, h.adjacency_offset, 4);
+    }
+    SECTION("more vertices than offsets") {
+        poke<std::uint64_t>(filename, offsetof(snapshot::header, graph) + offsetof(snapshot::stats, size), 5);
+    }
+    SECTION("a size that overflows the offsets bytes") {
+        poke<std::uint64_t>(filename, offsetof(snapshot::header, graph) + offsetof(snapshot::stats, size), ~std::uint64_t{0});
+    }
+
+    REQUIRE_THROWS_AS(snapshot::file(filename).sparse_graph(), std::runtime_error);
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("a snapshot ordering must be a permutation of the vertices", "[snapshot]") {
+    const auto filename = temp_snapshot("ordering");
+    custom_graph G(4);
+    G.add_edge(0, 1);
+    G.add_edge(2, 3);
+    const std::vector<std::size_t> order = {2, 0, 3, 1};
+    snapshot::write(filename, G, snapshot::stats_of(G), order, 0);
+    const auto h = read_header(filename);
+
+    REQUIRE(snapshot::file(filename).ordering() == order);
+
+    SECTION("a repeated vertex") {
+        poke<std::uint64_t>(filename, h.ordering_offset + sizeof(std::uint64_t), 2);
+        REQUIRE_THROWS_AS(snapshot::file(filename).ordering(), std::runtime_error);
+    }
+    SECTION("a vertex out of range") {
+        poke<std::uint64_t>(filename, h.ordering_offset, 4);
+        REQUIRE_THROWS_AS(snapshot::file(filename).ordering(), std::runtime_error);
+    }
+    SECTION("truncated") {
+        std::filesystem::resize_file(filename, h.ordering_offset + sizeof(std::uint64_t));
+        REQUIRE_THROWS_AS(snapshot::file(filename).ordering(), std::runtime_error);
+    }
+    std::filesystem::remove(filename);
+}
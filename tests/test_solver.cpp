@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "CliSAT.h"
+#include "parsing.h"
+
+TEST_CASE("a core shrink can drop every vertex before the next root", "[solver]") {
+    // without sorting, the triangle on vertices 0-2 is found first and the 3-core drops it: the next root would be
+    // vertex 0 of the core
+    const auto filename = std::string(CLISAT_TEST_DATA_DIR) + "/prefix_triangle.clq";
+    const std::size_t threads = GENERATE(1, 2, 4);
+    const auto sorting = GENERATE(NO_SORT, DEG_SORT);
+
+    auto clique = CliSAT(filename, std::chrono::seconds(10), std::chrono::milliseconds(50), false, sorting, false, threads, false);
+    std::ranges::sort(clique);
+    REQUIRE(clique == std::vector{3, 4, 5, 6, 7});
+}
+
+TEST_CASE("cliques found on a local subgraph map back to the graph", "[solver]") {
+    const auto filename = std::string(CLISAT_TEST_DATA_DIR) + "/gnp130_75.clq";
+    const std::size_t threads = GENERATE(1, 2, 4);
+    const auto sorting = GENERATE(NO_SORT, NEW_SORT, DEG_SORT);
+
+    const auto clique = CliSAT(filename, std::chrono::seconds(30), std::chrono::milliseconds(50), false, sorting, false, threads, false);
+    REQUIRE(clique.size() == 19);
+
+    // in input vertices, all different and pairwise adjacent
+    const auto G = parse_graph(filename);
+    for (std::size_t i = 0; i < clique.size(); ++i)
+        for (std::size_t j = i+1; j < clique.size(); ++j) REQUIRE(G.adjacent(clique[i], clique[j]));
+}
+
+TEST_CASE("a graph whose core can't hold a bigger clique is solved before the search", "[solver]") {
+    const auto filename = std::string(CLISAT_TEST_DATA_DIR) + "/no_edges.clq";
+    const std::size_t threads = GENERATE(1, 4);
+
+    const auto clique = CliSAT(filename, std::chrono::seconds(10), std::chrono::milliseconds(50), false, DEG_SORT, false, threads, false);
+    REQUIRE(clique == std::vector{0});
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "CliSAT.h"
+#include "custom_graph.h"
+#include "parsing.h"
+#include "sorting.h"
+#include "reference_sorting.h"
+
+namespace {
+    custom_graph random_graph(const std::size_t n, const double density, const unsigned seed) {
+        std::mt19937 rng(seed);
+        std::bernoulli_distribution edge(density);
+
+        custom_graph G(n);
+        for (std::size_t u = 0; u < n; ++u)
+            for (std::size_t v = u+1; v < n; ++v)
+                if (edge(rng)) G.add_edge(u, v);
+        return G;
+    }
+
+    // every vertex of degree d, lots of (degree, support) ties: the order among them decides the output
+    custom_graph circulant_graph(const std::size_t n, const std::size_t d) {
+        custom_graph G(n);
+        for (std::size_t u = 0; u < n; ++u)
+            for (std::size_t j = 1; j <= d/2; ++j) G.add_edge(u, (u+j) % n);
+        return G;
+    }
+
+    void require_same_orderings(const custom_graph& G) {
+        REQUIRE(G.get_degeneracy() == reference::get_degeneracy(G));
+        for (const int p : {1, 5}) {
+            REQUIRE(MWSI(G, p) == reference::MWSI(G, p));
+            REQUIRE(MWSSI(G, p) == reference::MWSSI(G, p));
+        }
+    }
+}
+
+TEST_CASE("bucket queue sorts match the quadratic ones on the examples", "[sorting]") {
+    const std::string filename = GENERATE("C250.9.clq", "wiki-Vote.mtx");
+    const auto G = parse_graph(std::string(CLISAT_EXAMPLES_DIR) + "/" + filename);
+
+    require_same_orderings(G);
+    // the quadratic MWSI on the dense complement of wiki-Vote takes minutes
+    if (G.size() < 1000) require_same_orderings(G.get_complement());
+}
+
+TEST_CASE("bucket queue sorts match the quadratic ones on random graphs", "[sorting]") {
+    const std::size_t n = GENERATE(0, 1, 2, 63, 64, 65, 300);
+    const double density = GENERATE(0.0, 0.05, 0.5, 0.95, 1.0);
+
+    for (unsigned seed = 0; seed < 3; ++seed) require_same_orderings(random_graph(n, density, seed));
+}
+
+TEST_CASE("bucket queue sorts match the quadratic ones on regular graphs", "[sorting]") {
+    const std::size_t n = GENERATE(10, 129, 500);
+    const std::size_t d = GENERATE(2, 4, 16);
+
+    require_same_orderings(circulant_graph(n, d));
+}
+
+TEST_CASE("change_order relabels rows the same on any number of threads", "[sorting]") {
+    // below change_order_min_rows rows per thread only a forced thread count runs the parallel path.
+    // 64 rows per block: 300 rows are 5 blocks, fewer than the threads at 8
+    const std::size_t n = GENERATE(1, 65, 300, 1000, 9000);
+    const std::size_t threads = GENERATE(0, 1, 2, 3, 8);
+    const double density = n > 1000 ? 0.002 : 0.1;
+
+    std::mt19937 rng(static_cast<unsigned>(n + threads));
+    std::bernoulli_distribution edge(density);
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    custom_graph G(n);
+    for (std::size_t u = 0; u < n; ++u)
+        for (std::size_t v = u+1; v < n; ++v)
+            if (edge(rng)) {
+                G.add_edge(u, v);
+                edges.emplace_back(u, v);
+            }
+
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::shuffle(order, rng);
+    std::vector<std::size_t> position(n);
+    for (std::size_t i = 0; i < n; ++i) position[order[i]] = i;
+
+    G.change_order(order, threads);
+
+    // the relabelled edge list, edge by edge, and no other edge
+    custom_graph expected(n);
+    for (const auto& [u, v] : edges) expected.add_edge(position[u], position[v]);
+    REQUIRE(G.get_n_edges() == edges.size());
+    for (std::size_t v = 0; v < n; ++v) REQUIRE(G[v] == expected[v]);
+}
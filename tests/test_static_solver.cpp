@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "CliSAT.h"
+#include "custom_bitset.h"
+#include "custom_graph.h"
+#include "static_solver.h"
+
+namespace {
+    custom_graph random_graph(const std::size_t n, const double density, const unsigned seed) {
+        std::mt19937 rng(seed);
+        std::bernoulli_distribution edge(density);
+
+        custom_graph G(n);
+        for (std::size_t u = 0; u < n; ++u)
+            for (std::size_t v = u+1; v < n; ++v)
+                if (edge(rng)) G.add_edge(u, v);
+        return G;
+    }
+
+    // every clique that can still beat best, grown from the candidates after the last vertex added
+    void grow(const custom_graph& G, const std::vector<int>& candidates, const int size, int& best) {
+        best = std::max(best, size);
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (size + static_cast<int>(candidates.size() - i) <= best) return;
+            std::vector<int> next;
+            for (std::size_t j = i+1; j < candidates.size(); ++j)
+                if (G.adjacent(candidates[i], candidates[j])) next.push_back(candidates[j]);
+            grow(G, next, size+1, best);
+        }
+    }
+
+    // the clique number of G[V] by enumeration
+    int brute_force_omega(const custom_graph& G, const std::vector<int>& V) {
+        int best = 0;
+        grow(G, V, 0, best);
+        return best;
+    }
+
+    // size distinct vertices of V, pairwise adjacent
+    void require_clique_in(const custom_graph& G, const custom_bitset& V, const std::vector<int>& clique, const int size) {
+        REQUIRE(static_cast<int>(clique.size()) == size);
+        for (std::size_t i = 0; i < clique.size(); ++i) {
+            REQUIRE(V.test(clique[i]));
+            for (std::size_t j = i+1; j < clique.size(); ++j) REQUIRE(G.adjacent(clique[i], clique[j]));
+        }
+    }
+
+    // V: count random vertices of G. a clique of every size up to omega(G[V]) is found, one more vertex is not
+    template <std::size_t N>
+    void require_brute_force_cliques(const std::size_t n, const std::size_t count, const double density, const unsigned seed) {
+        const auto G = random_graph(n, density, seed);
+        std::mt19937 rng(seed);
+        std::vector<int> vertices(n);
+        std::iota(vertices.begin(), vertices.end(), 0);
+        std::ranges::shuffle(vertices, rng);
+        vertices.resize(count);
+        std::ranges::sort(vertices);
+
+        custom_bitset V(n), tmp(n);
+        for (const auto v : vertices) V.set(v);
+        std::vector<int> local_index(n);
+        const auto omega = brute_force_omega(G, vertices);
+        CAPTURE(N, n, count, density, seed, omega);
+
+        static_solver<N> solver;
+        for (int size = 1; size <= omega; ++size) {
+            REQUIRE(solver.find_clique(G, V, size, local_index, tmp, [] { return false; }));
+            require_clique_in(G, V, solver.clique(), size);
+        }
+        // what the solver asks when the clique has to beat a lower bound of omega
+        REQUIRE_FALSE(solver.find_clique(G, V, omega+1, local_index, tmp, [] { return false; }));
+    }
+}
+
+TEST_CASE("static_solver<64> finds the cliques brute force finds", "[static_solver]") {
+    const double density = GENERATE(0.2, 0.5, 0.8);
+    const std::size_t count = GENERATE(1, 17, 63, 64);
+    for (unsigned seed = 0; seed < 3; ++seed) require_brute_force_cliques<64>(100, count, density, seed);
+}
+
+TEST_CASE("static_solver<128> finds the cliques brute force finds", "[static_solver]") {
+    const double density = GENERATE(0.2, 0.5, 0.7);
+    const std::size_t count = GENERATE(65, 100, 128);
+    for (unsigned seed = 0; seed < 3; ++seed) require_brute_force_cliques<128>(150, count, density, seed);
+}
+
+TEST_CASE("static_solver stops when asked to", "[static_solver]") {
+    const auto G = random_graph(64, 0.5, 0);
+    custom_bitset V(64), tmp(64);
+    V.set();
+    std::vector<int> local_index(64);
+
+    static_solver<64> solver;
+    REQUIRE_FALSE(solver.find_clique(G, V, 3, local_index, tmp, [] { return true; }));
+}
+
+TEST_CASE("CliSAT hands subproblems to static_solver and keeps its cliques", "[static_solver][solver]") {
+    // G(200, 0.5) without sorting: candidate sets of up to 64 vertices, small next to them the clique to find
+    const unsigned seed = GENERATE(0u, 1u, 2u);
+    const std::size_t threads = GENERATE(1, 2);
+    const auto G = random_graph(200, 0.5, seed);
+
+    const auto filename = (std::filesystem::temp_directory_path() / ("clisat_static_" + std::to_string(seed) + "_" + std::to_string(threads) + ".clq")).string();
+    {
+        std::ofstream out(filename);
+        out << "p edge " << G.size() << ' ' << G.get_n_edges() << '\n';
+        for (std::size_t u = 0; u < G.size(); ++u)
+            for (std::size_t v = u+1; v < G.size(); ++v)
+                if (G.adjacent(u, v)) out << "e " << u+1 << ' ' << v+1 << '\n';
+    }
+
+    std::vector<int> all(G.size());
+    std::iota(all.begin(), all.end(), 0);
+    const auto omega = brute_force_omega(G, all);
+
+    const auto clique = CliSAT(filename, std::chrono::seconds(30), std::chrono::milliseconds(50), false, NO_SORT, false, threads, false);
+    std::filesystem::remove(filename);
+
+    custom_bitset V(G.size());
+    V.set();
+    require_clique_in(G, V, clique, omega);
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "work_stealing_deque.h"
+
+TEST_CASE("the owner pops the last item pushed, thieves steal the first", "[work_stealing_deque]") {
+    // capacity 4: the 100 items go through several grown rings
+    work_stealing_deque<int> deque(4);
+    for (int i = 0; i < 100; ++i) deque.push(i);
+    REQUIRE(deque.size() == 100);
+
+    int value = -1;
+    for (int i = 0; i < 50; ++i) {
+        REQUIRE(deque.steal(value));
+        REQUIRE(value == i);
+    }
+    for (int i = 99; i >= 50; --i) {
+        REQUIRE(deque.pop(value));
+        REQUIRE(value == i);
+    }
+    REQUIRE(deque.empty());
+    REQUIRE_FALSE(deque.pop(value));
+    REQUIRE_FALSE(deque.steal(value));
+
+    // empty again, the indices keep going from where they are
+    deque.push(7);
+    REQUIRE(deque.pop(value));
+    REQUIRE(value == 7);
+    REQUIRE_FALSE(deque.steal(value));
+}
+
+TEST_CASE("every item goes to exactly one of the owner and the thieves", "[work_stealing_deque]") {
+    const std::size_t thieves = GENERATE(1, 3, 7);
+    constexpr std::int64_t items = 200000;
+
+    work_stealing_deque<std::int64_t> deque(8);
+    std::vector<std::atomic<int>> taken(items);
+    std::atomic<bool> done = false;
+
+    // thieves count on their own, the REQUIREs run on the main thread
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < thieves; ++i) {
+        threads.emplace_back([&] {
+            std::int64_t value;
+            while (!done.load(std::memory_order_acquire) || !deque.empty()) {
+                if (deque.steal(value)) taken[value].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // short bursts of pushes, then as many pops or more: the owner keeps racing the thieves for the last item
+    std::int64_t value;
+    for (std::int64_t next = 0; next < items; ) {
+        const auto burst = 1 + next % 3;
+        for (std::int64_t i = 0; i < burst && next < items; ++i) deque.push(next++);
+        for (std::int64_t i = 0; i < burst + 1; ++i) {
+            if (deque.pop(value)) taken[value].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    while (deque.pop(value)) taken[value].fetch_add(1, std::memory_order_relaxed);
+    done.store(true, std::memory_order_release);
+    for (auto& thread : threads) thread.join();
+
+    std::int64_t wrong = 0;
+    for (const auto& count : taken) wrong += count.load() != 1;
+    REQUIRE(wrong == 0);
+}